@@ -14,6 +14,7 @@ MCLANG=$7 # modified compiler
 EXTRA_CFLAGS=$8 # additional compiler flags
 EXTRA_LFLAGS=$9 # additional linker flags
 EXTENSION=${10} # augmentum compiler extension library
+CACHE=${11} # object cache directory, enables cached build mode if set (optional)
 
 if [ ! -d $HOME ] ; then
     echo "ERROR: Specified benchmark home directory does not exist $HOME"
@@ -45,6 +46,10 @@ if [ ! -z "$EXTENSION" ] && [ ! -f $EXTENSION ] ; then
     exit 1
 fi
 
+if [ ! -z "$CACHE" ] ; then
+    mkdir -p $CACHE || exit 1
+fi
+
 SYS=$HOME/sys
 COMMON=$HOME/common
 DIR=$HOME/${NAME^^} # upper case name for benchmark source directory
@@ -64,6 +69,108 @@ function execute {
     $CMD
 }
 
+# maximum number of compile jobs running at the same time, sequential by default
+# as the driver runs many builds side by side
+JOBS=${BUILD_JOBS:-1}
+
+# run command in the background, failures are recorded in $FAILED
+function spawn {
+    while [ $(jobs -rp | wc -l) -ge $JOBS ]; do
+        wait -n
+    done
+    ( "$@" || touch $FAILED ) &
+}
+
+# compile source file with the vanilla compiler or copy it from the object cache
+# objects are identified by compiler version, flags and preprocessed source
+function cached_compile {
+    FILE=$1
+    INCLUDES=$2
+    OBJ=$(basename ${FILE%.c}).o
+
+    KEY=$({ echo "$VCLANG_VERSION $CFLAGS"
+            $VCLANG $CFLAGS $INCLUDES -E -P $FILE || echo "FAILED $BASHPID"
+          } | sha256sum | cut -d' ' -f1)
+    CACHED=$CACHE/$KEY.o
+
+    if [ ! -f $CACHED ]; then
+        # compile to a temporary file so that concurrent builds never see partial objects,
+        # named by the pid of the spawned job as $$ is shared by all of them
+        execute "$VCLANG $CFLAGS -c $INCLUDES $FILE -o $CACHED.$BASHPID" || return 1
+        mv -f $CACHED.$BASHPID $CACHED
+    else
+        echo "using cached $OBJ for $FILE"
+    fi
+    cp -f $CACHED $BLD/$OBJ
+}
+
+# wait for spawned jobs and report whether any of them failed
+function wait_spawned {
+    wait
+
+    if [ -f $FAILED ]; then
+        rm -f $FAILED
+        echo "ERROR: Building objects failed"
+        return 1
+    fi
+}
+
+# All objects are built in parallel.
+function build_objects {
+    SRC=$1 # list of benchmark source files
+    CMN=$2 # list of common source files
+    VFY=$3 # list of source files used for verification
+
+    FAILED=$BLD/.build_failed
+    rm -f $FAILED
+
+    printf "\nbuilding benchmark objects ...\n"
+    for file in $SRC; do
+        spawn execute "$MCLANG $CFLAGS $EXT_FLAGS -c -I$COMMON -I$DIR $DIR/$file"
+    done
+
+    printf "\nbuilding common objects ...\n"
+    for file in $CMN; do
+        spawn execute "$MCLANG $CFLAGS $EXT_FLAGS -c -I$COMMON $COMMON/$file"
+    done
+
+    # verification files are not build using a modified compiler
+    printf "\nbuilding external verification objects ...\n"
+    for file in $VFY; do
+        spawn execute "$VCLANG $CFLAGS -c -I$DIR $DIR/$file"
+    done
+
+    wait_spawned
+}
+
+# Only benchmark sources are compiled with the modified compiler.
+# Common and verification objects are compiled with the vanilla compiler
+# and reused across builds. All objects are built in parallel.
+function build_objects_cached {
+    SRC=$1 # list of benchmark source files
+    CMN=$2 # list of common source files
+    VFY=$3 # list of source files used for verification
+
+    VCLANG_VERSION=$($VCLANG --version | head -n 1)
+    FAILED=$BLD/.build_failed
+    rm -f $FAILED
+
+    printf "\nbuilding benchmark objects ...\n"
+    for file in $SRC; do
+        spawn execute "$MCLANG $CFLAGS $EXT_FLAGS -c -I$COMMON -I$DIR $DIR/$file"
+    done
+
+    printf "\nbuilding cached common and external verification objects ...\n"
+    for file in $CMN; do
+        spawn cached_compile $COMMON/$file "-I$COMMON"
+    done
+    for file in $VFY; do
+        spawn cached_compile $DIR/$file "-I$DIR"
+    done
+
+    wait_spawned
+}
+
 function build_benchmark {
     SRC=$1 # list of benchmark source files
     CMN=$2 # list of common source files
@@ -80,22 +187,10 @@ function build_benchmark {
     execute "../sys/setparams $NAME $CLASS"
     execute "cd $BLD"
 
-    printf "\nbuilding benchmark objects ...\n"
-    for file in $SRC; do
-        execute "$MCLANG $CFLAGS $EXT_FLAGS -c -I$COMMON -I$DIR $DIR/$file"
-    done
-
-    printf "\nbuilding common objects ...\n"
-    for file in $CMN; do
-        execute "$MCLANG $CFLAGS $EXT_FLAGS -c -I$COMMON $COMMON/$file"
-    done
-
-    # verification files are not build using a modified compiler
-    printf "\nbuilding external verification objects ...\n"
-    if [[ ! -z $VFY ]]; then
-        for file in $VFY; do
-            execute "$VCLANG $CFLAGS -c -I$DIR $DIR/$file"
-        done
+    if [[ ! -z "$CACHE" ]]; then
+        build_objects_cached "$SRC" "$CMN" "$VFY" || exit 1
+    else
+        build_objects "$SRC" "$CMN" "$VFY" || exit 1
     fi
 
     TARGET=$BIN/$NAME.$CLASS.x
@@ -36,7 +36,7 @@ gcc -o $SYS/setparams $SYS/setparams.c
 printf "========= BUILDING AUGMENTUM TARGETS ==========================================\n"
 for t in $TARGETS; do
     printf "\n\nBuilding augmentum binaries for $t and class $CLASS\n"
-    ./build.sh $t $CLASS $HOME $MBIN $BLD $VCLANG $MCLANG "$CFLAGS" "$LFLAGS" "$EXTENSION"
+    ./build.sh $t $CLASS $HOME $MBIN $BLD $VCLANG $MCLANG "$CFLAGS" "$LFLAGS" "$EXTENSION" "$OBJECT_CACHE"
 done
 
 
@@ -9,6 +9,11 @@
  */
 /* polybench.c: this file is part of PolyBench/C */
 
+#ifdef POLYBENCH_DUMP_DIGEST
+/* fopencookie */
+# define _GNU_SOURCE
+#endif
+
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
@@ -567,3 +572,56 @@ void* polybench_alloc_data(unsigned long long int n, int elt_size)
 
   return ret;
 }
+
+
+#ifdef POLYBENCH_DUMP_DIGEST
+/* 64 bit FNV-1a hash over the text printed for the current array. Values
+   are hashed as printed, i.e. quantised by the format they are printed
+   with, which gives the same result as comparing full array dumps. */
+static unsigned long long polybench_digest_hash;
+static unsigned long long polybench_digest_bytes;
+static FILE* polybench_digest_stream = NULL;
+
+static ssize_t
+polybench_digest_write(void* cookie, const char* buf, size_t size)
+{
+  size_t i;
+  for (i = 0; i < size; i++)
+    {
+      polybench_digest_hash ^= (unsigned char) buf[i];
+      polybench_digest_hash *= 1099511628211ULL;
+    }
+  polybench_digest_bytes += size;
+  return size;
+}
+
+FILE* polybench_digest_target()
+{
+  if (polybench_digest_stream == NULL)
+    {
+      cookie_io_functions_t io = { NULL, polybench_digest_write, NULL, NULL };
+      polybench_digest_stream = fopencookie (NULL, "w", io);
+      if (polybench_digest_stream == NULL)
+	{
+	  fprintf (stderr, "[PolyBench] digest stream: cannot open\n");
+	  exit (1);
+	}
+      setvbuf (polybench_digest_stream, NULL, _IOFBF, 1 << 16);
+    }
+  return polybench_digest_stream;
+}
+
+void polybench_digest_begin(const char* name)
+{
+  fflush (polybench_digest_target());
+  polybench_digest_hash = 14695981039346656037ULL;
+  polybench_digest_bytes = 0;
+}
+
+void polybench_digest_end(const char* name)
+{
+  fflush (polybench_digest_target());
+  fprintf (stderr, "digest: %s %llu %016llx\n", name,
+	   polybench_digest_bytes, polybench_digest_hash);
+}
+#endif
@@ -161,11 +161,26 @@
 #  define POLYBENCH_DCE_ONLY_CODE
 # endif
 
-#define POLYBENCH_DUMP_TARGET stderr
-#define POLYBENCH_DUMP_START    fprintf(POLYBENCH_DUMP_TARGET, "==BEGIN DUMP_ARRAYS==\n")
-#define POLYBENCH_DUMP_FINISH   fprintf(POLYBENCH_DUMP_TARGET, "==END   DUMP_ARRAYS==\n")
-#define POLYBENCH_DUMP_BEGIN(s) fprintf(POLYBENCH_DUMP_TARGET, "begin dump: %s", s)
-#define POLYBENCH_DUMP_END(s)   fprintf(POLYBENCH_DUMP_TARGET, "\nend   dump: %s\n", s)
+/* Digest mode: arrays are printed into a stream that only hashes the
+   printed text. One line per array with byte count and digest is written
+   to stderr instead of the array contents. See polybench.c */
+#ifdef POLYBENCH_DUMP_DIGEST
+# include <stdio.h>
+extern FILE* polybench_digest_target();
+extern void polybench_digest_begin(const char* name);
+extern void polybench_digest_end(const char* name);
+# define POLYBENCH_DUMP_TARGET polybench_digest_target()
+# define POLYBENCH_DUMP_START    fprintf(stderr, "==BEGIN DUMP_DIGESTS==\n")
+# define POLYBENCH_DUMP_FINISH   fprintf(stderr, "==END   DUMP_DIGESTS==\n")
+# define POLYBENCH_DUMP_BEGIN(s) polybench_digest_begin(s)
+# define POLYBENCH_DUMP_END(s)   polybench_digest_end(s)
+#else
+# define POLYBENCH_DUMP_TARGET stderr
+# define POLYBENCH_DUMP_START    fprintf(POLYBENCH_DUMP_TARGET, "==BEGIN DUMP_ARRAYS==\n")
+# define POLYBENCH_DUMP_FINISH   fprintf(POLYBENCH_DUMP_TARGET, "==END   DUMP_ARRAYS==\n")
+# define POLYBENCH_DUMP_BEGIN(s) fprintf(POLYBENCH_DUMP_TARGET, "begin dump: %s", s)
+# define POLYBENCH_DUMP_END(s)   fprintf(POLYBENCH_DUMP_TARGET, "\nend   dump: %s\n", s)
+#endif
 
 # define polybench_prevent_dce(func)		\
   POLYBENCH_DCE_ONLY_CODE			\
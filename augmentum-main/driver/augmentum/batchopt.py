@@ -0,0 +1,209 @@
+# Copyright (c) 2021, Björn Franke
+#
+# This source code is licensed under the MIT license found in the
+# LICENSE file in the root directory of this source tree.
+
+"""
+Client for the batch optimiser in tools/batchopt.
+
+The batch optimiser parses a bitcode file once and then optimises it for one
+probe extension after another without starting a new opt process each time.
+"""
+
+import logging
+import os
+import resource
+import select
+import signal
+import subprocess
+from pathlib import Path
+from subprocess import TimeoutExpired
+from time import monotonic as timer
+from typing import List, Optional, Tuple
+
+logger = logging.getLogger(__name__)
+
+RESPONSE_PREFIX = "@batchopt"
+
+OPT_LEVELS = ("0", "1", "2", "3", "s", "z")
+
+
+def batchopt_opt_level(opt_flags: str) -> Optional[str]:
+    """
+    Return the batch optimiser level equivalent to the given opt flags
+    or None if the flags are not supported by the batch optimiser.
+    """
+    flags = opt_flags.split()
+    if len(flags) == 1 and flags[0] in (f"-O{level}" for level in OPT_LEVELS):
+        return flags[0][2:]
+    return None
+
+
+class BatchOptimiser:
+    """
+    Persistent batch optimiser process for a single bitcode file.
+
+    The process is started on first use and restarted whenever it failed,
+    timed out or is requested with a different library path or memory limit.
+    """
+
+    def __init__(
+        self,
+        batchopt_bin: Path,
+        bitcode: Path,
+        opt_level: str,
+        verbose: bool = False,
+    ):
+        self.batchopt_bin = batchopt_bin
+        self.bitcode = bitcode
+        self.opt_level = opt_level
+        self.verbose = verbose
+
+        self.process: Optional[subprocess.Popen] = None
+        self.config: Optional[Tuple[Path, Optional[int]]] = None
+        self.pending = b""
+
+    def __getstate__(self):
+        # running processes are not transferable
+        state = self.__dict__.copy()
+        state["process"] = None
+        state["config"] = None
+        state["pending"] = b""
+        return state
+
+    def command(self) -> List[str]:
+        return [
+            str(self.batchopt_bin),
+            f"-opt-level={self.opt_level}",
+            str(self.bitcode),
+        ]
+
+    def start(self, sysprog_lib: Path, memory_limit: Optional[int]):
+        def prepare():
+            os.setsid()
+            if memory_limit is not None:
+                _, hard = resource.getrlimit(resource.RLIMIT_AS)
+                limit = int(memory_limit * 1024 * 1024)
+                resource.setrlimit(resource.RLIMIT_AS, (limit, hard))
+
+        # run against the libraries of the instrumented system program
+        env = os.environ.copy()
+        env["LD_LIBRARY_PATH"] = os.pathsep.join(
+            p for p in (str(sysprog_lib), env.get("LD_LIBRARY_PATH", "")) if p
+        )
+
+        if self.verbose:
+            logger.debug(" ".join(self.command()))
+
+        self.process = subprocess.Popen(
+            self.command(),
+            stdin=subprocess.PIPE,
+            stdout=subprocess.PIPE,
+            stderr=None if self.verbose else subprocess.DEVNULL,
+            env=env,
+            preexec_fn=prepare,
+        )
+        self.config = (sysprog_lib, memory_limit)
+        self.pending = b""
+
+    def close(self):
+        """Stop the batch optimiser process, it exits once its input is closed."""
+        if self.process is None:
+            return
+        try:
+            self.process.stdin.close()
+        except BrokenPipeError:
+            pass
+        try:
+            self.process.wait(timeout=1)
+        except TimeoutExpired:
+            try:
+                os.killpg(os.getpgid(self.process.pid), signal.SIGTERM)
+            except ProcessLookupError:
+                pass
+            self.process.wait()
+        self.process.stdout.close()
+        self.process = None
+        self.config = None
+
+    def read_response(self, deadline: Optional[float]) -> Optional[str]:
+        """
+        Read the next response line of the batch optimiser.
+        Returns None if the process terminated.
+        """
+        assert self.process is not None
+        fd = self.process.stdout.fileno()
+        while True:
+            while b"\n" in self.pending:
+                line, self.pending = self.pending.split(b"\n", 1)
+                text = line.decode("utf-8", "backslashreplace")
+                if text.startswith(RESPONSE_PREFIX):
+                    return text[len(RESPONSE_PREFIX) :].strip()
+                elif self.verbose:
+                    logger.debug(text)
+
+            time_left = None if deadline is None else deadline - timer()
+            if time_left is not None and time_left <= 0:
+                raise TimeoutExpired(self.command(), 0)
+            ready, _, _ = select.select([fd], [], [], time_left)
+            if not ready:
+                continue
+            data = os.read(fd, 4096)
+            if not data:
+                return None
+            self.pending += data
+
+    def optimise(
+        self,
+        extension_lib: Optional[Path],
+        output: Path,
+        sysprog_lib: Path,
+        timeout: Optional[float] = None,
+        memory_limit: Optional[int] = None,
+    ) -> bool:
+        """
+        Optimise the bitcode with the given extension loaded and
+        write the result to output.
+
+        Throws TimeoutExpired exception if the timeout expires, in which case
+        the batch optimiser is restarted for the next request.
+        """
+        deadline = None if timeout is None else timer() + timeout
+
+        config = (sysprog_lib, memory_limit)
+        if self.process is not None and (
+            self.process.poll() is not None or self.config != config
+        ):
+            self.close()
+
+        try:
+            if self.process is None:
+                self.start(sysprog_lib, memory_limit)
+                ready = self.read_response(deadline)
+                if ready is None or not ready.startswith("READY"):
+                    logger.warning(
+                        f"Batch optimiser failed to start for {self.bitcode}"
+                    )
+                    self.close()
+                    return False
+
+            extension = str(extension_lib) if extension_lib is not None else "-"
+            self.process.stdin.write(f"{extension}\t{output}\n".encode("utf-8"))
+            self.process.stdin.flush()
+
+            response = self.read_response(deadline)
+        except TimeoutExpired:
+            self.close()
+            raise TimeoutExpired(self.command(), timeout)
+        except BrokenPipeError:
+            response = None
+
+        if response is None:
+            # crashed while optimising, a new process is started next time
+            self.close()
+            return False
+        if not response.startswith("OK"):
+            if self.verbose:
+                logger.debug(f"Batch optimiser: {response}")
+            return False
+        return True
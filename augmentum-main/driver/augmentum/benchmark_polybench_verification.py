@@ -11512,22 +11512,51 @@ free\(0x[0-9a-f]+\)
 #END OF AUTOGENERATED CONTENT
 
 import re
+from functools import lru_cache
+
+# array dumps of the regular output as printed with POLYBENCH_DUMP_ARRAYS
+DUMP_PATTERN = re.compile(r"begin dump: (?P<name>[^\n]*?)(?P<data>.*?)\nend   dump: (?P=name)\n", re.DOTALL)
+
+def polybench_digest(data : str) -> str:
+    """64 bit FNV-1a digest and byte count of printed array data, as computed by polybench.c"""
+    digest = 14695981039346656037
+    for b in data.encode("utf-8"):
+        digest = ((digest ^ b) * 1099511628211) & 0xFFFFFFFFFFFFFFFF
+    return f"{len(data.encode('utf-8'))} {digest:016x}"
+
+@lru_cache(maxsize=None)
+def polybench_digest_output(benchmark : str) -> str:
+    """Expected output of a benchmark built with POLYBENCH_DUMP_DIGEST derived from its regular output."""
+    regular = POLYBENCH_OUT[benchmark]["REGULAR"]
+    digests = DUMP_PATTERN.sub(lambda m: f"digest: {m.group('name')} {polybench_digest(m.group('data'))}\n", regular)
+    return digests.replace("==BEGIN DUMP_ARRAYS==\n", "==BEGIN DUMP_DIGESTS==\n").replace("==END   DUMP_ARRAYS==\n", "==END   DUMP_DIGESTS==\n")
 
 class Polybench_Verifier:
-    """Verify polybench benchmark output using corresponding regex"""
-    def __init__(self, stl_wrap : bool = False):
+    """Verify polybench benchmark output using corresponding regex
+
+    If digest is set, the output is expected to contain one digest per array
+    instead of the full array dump.
+    """
+    def __init__(self, stl_wrap : bool = False, digest : bool = False):
         self.__stl_wrap = stl_wrap
+        self.__digest = digest
+
+    def expected_output(self, benchmark : str) -> str:
+        if self.__digest:
+            return polybench_digest_output(benchmark)
+        return POLYBENCH_OUT[benchmark]["REGULAR"]
     
     def verify(self, benchmark : str, output : str) -> bool:
         """Verify this benchmark for the given output."""       
+        expected = self.expected_output(benchmark)
 
         if self.__stl_wrap:
-            match_regular = output.find(POLYBENCH_OUT[benchmark]["REGULAR"])
-            output = output.replace(POLYBENCH_OUT[benchmark]["REGULAR"], "")
+            match_regular = output.find(expected)
+            output = output.replace(expected, "")
             match_wrapper = re.match(POLYBENCH_OUT[benchmark]["WRAPPER"], output, re.MULTILINE)
 
             return match_regular != -1 and match_wrapper is not None
        
         else:
-            return output.find(POLYBENCH_OUT[benchmark]["REGULAR"]) != -1
+            return output.find(expected) != -1
 
@@ -4,17 +4,19 @@
 # LICENSE file in the root directory of this source tree.
 
 import logging
-import shutil
 from abc import ABC, abstractmethod
 from enum import Enum
 from pathlib import Path
 from subprocess import TimeoutExpired
+from time import monotonic as timer
 from typing import Any, Dict, Iterable, Optional, Type
 
+from augmentum.batchopt import BatchOptimiser, batchopt_opt_level
 from augmentum.benchmark_LLVM_verification import LLVMOutputVerifier
 from augmentum.benchmark_polybench_verification import Polybench_Verifier
 from augmentum.benchmark_SNU_make_conf import get_SNU_make_conf
 from augmentum.benchmark_SNU_verification import build_nas_verifier
+from augmentum.scratch import clone_tree
 from augmentum.sysUtils import build_path_or_fail, run_command
 from augmentum.timer import Timer
 
@@ -106,6 +108,11 @@ class TestCase(ABC):
         Verify a previous execution result for correctness.
         """
 
+    def close(self):
+        """
+        Release resources held by the test case between compilations.
+        """
+
     @abstractmethod
     def __str__(self) -> str:
         """Return string representation of this benchmark test case"""
@@ -326,6 +333,9 @@ class SNUNPB_BC_TestCase(TestCase):
 
     opt_and_link_cmd_template = """
 {sysprog_bins}/opt {extension_flags} {opt_flags} {benchmark_dir}/{benchmark_bc} -o {benchmark_dir}/opt_{benchmark_bc} &&
+{compiler_bins}/clang {link_flags} {benchmark_dir}/opt_{benchmark_bc} {verify_module} -o {test_bin}
+    """
+    link_cmd_template = """
 {compiler_bins}/clang {link_flags} {benchmark_dir}/opt_{benchmark_bc} {verify_module} -o {test_bin}
     """
     clean_cmd_template = """
@@ -344,6 +354,7 @@ rm -f {benchmark_dir}/opt_{benchmark_bc} {test_bin}
         program_config: Optional[Dict[str, Any]],
         wl_class: str,
         verbose=False,
+        batchopt_bin: Optional[Path] = None,
     ):
         super().__init__(benchmark_config, benchmark_src_dir, verbose)
 
@@ -387,6 +398,19 @@ rm -f {benchmark_dir}/opt_{benchmark_bc} {test_bin}
         if "linker_flags" in benchmark_config:
             self.linker_flags = benchmark_config["linker_flags"]
 
+        # optimise in a persistent process if available and flags permit
+        self.__batch_optimiser: Optional[BatchOptimiser] = None
+        opt_level = batchopt_opt_level(getattr(self, "compiler_flags", ""))
+        if batchopt_bin is not None and opt_level is not None:
+            self.__batch_optimiser = BatchOptimiser(
+                batchopt_bin, self.__test_bitcode, opt_level, verbose
+            )
+        elif batchopt_bin is not None:
+            logger.warning(
+                f"Batch optimiser not used for {self}, "
+                f"unsupported flags: {self.compiler_flags}"
+            )
+
     def prepare_output(self, outdir: Path):
         outdir.mkdir(exist_ok=True)
 
@@ -394,6 +418,10 @@ rm -f {benchmark_dir}/opt_{benchmark_bc} {test_bin}
     def test_binary(self) -> Path:
         return self.__test_binary
 
+    def close(self):
+        if self.__batch_optimiser is not None:
+            self.__batch_optimiser.close()
+
     def clean(self) -> bool:
         clean_cmd = SNUNPB_BC_TestCase.clean_cmd_template.format(
             benchmark_dir=self._benchmark_dir,
@@ -422,6 +450,11 @@ rm -f {benchmark_dir}/opt_{benchmark_bc} {test_bin}
         if not self.clean():
             return ExecutionResult.COMPILE_FAIL
 
+        if self.__batch_optimiser is not None:
+            return self.compile_batched(
+                sysprog_bins, extension_lib, link_flags, memory_limit
+            )
+
         extension_flags = f"-load {extension_lib}" if extension_lib is not None else ""
 
         opt_and_link_cmd = SNUNPB_BC_TestCase.opt_and_link_cmd_template.format(
@@ -452,6 +485,55 @@ rm -f {benchmark_dir}/opt_{benchmark_bc} {test_bin}
             ExecutionResult.SUCCESS if returncode == 0 else ExecutionResult.COMPILE_FAIL
         )
 
+    def compile_batched(
+        self,
+        sysprog_bins: Path,
+        extension_lib: Optional[Path],
+        link_flags: str,
+        memory_limit: Optional[int],
+    ) -> ExecutionResult:
+        """
+        Optimise with the persistent batch optimiser instead of opt
+        and link as usual.
+        """
+        assert self.__batch_optimiser is not None
+        start = timer()
+        try:
+            optimised = self.__batch_optimiser.optimise(
+                extension_lib,
+                self._benchmark_dir / f"opt_{self.__test_bitcode.name}",
+                sysprog_bins.parent / "lib",
+                timeout=self.compile_timeout_secs,
+                memory_limit=memory_limit,
+            )
+        except TimeoutExpired:
+            return ExecutionResult.COMPILE_TIMEOUT
+        if not optimised:
+            return ExecutionResult.COMPILE_FAIL
+
+        link_cmd = SNUNPB_BC_TestCase.link_cmd_template.format(
+            compiler_bins=self.__vanilla_compiler_bins,
+            benchmark_dir=self._benchmark_dir,
+            benchmark_bc=self.__test_bitcode.name,
+            verify_module=self.__test_verify,
+            link_flags=link_flags,
+            test_bin=self.test_binary,
+        )
+
+        try:
+            returncode, _ = run_command(
+                link_cmd,
+                timeout=max(self.compile_timeout_secs - (timer() - start), 1),
+                verbose=self.verbose,
+                memory_limit=memory_limit,
+            )
+        except TimeoutExpired:
+            return ExecutionResult.COMPILE_TIMEOUT
+
+        return (
+            ExecutionResult.SUCCESS if returncode == 0 else ExecutionResult.COMPILE_FAIL
+        )
+
     def run(self, memory_limit: Optional[int] = None) -> ExecutionResult:
         try:
             returncode, stdout = run_command(
@@ -501,6 +583,7 @@ rm -f {benchmark_dir}/opt_{benchmark_bc} {test_bin}
         test_cases = dict()
 
         vanilla_compiler_bins = Path(tools["compiler_bin"])
+        batchopt_bin = Path(tools["batchopt"]) if tools.get("batchopt") else None
 
         for b in b_cfg["benchmarks"]:
             classes = b_cfg["default_classes"]
@@ -519,6 +602,7 @@ rm -f {benchmark_dir}/opt_{benchmark_bc} {test_bin}
                     prog_conf,
                     c,
                     verbose,
+                    batchopt_bin,
                 )
                 assert (
                     str(case) not in test_cases
@@ -536,7 +620,7 @@ class SNUNPB_DIRECT_TestCase(TestCase):
     """
 
     compile_cmd_template = """
-{benchmark_dir}/direct_build/build.sh {benchmark_name} {benchmark_class} {benchmark_dir}/NPB3.3-SER-C {binary_dir} {build_dir} {compiler_bins}/clang {sysprog_bins}/clang {compile_flags} {link_flags} {extension_lib}
+{benchmark_dir}/direct_build/build.sh {benchmark_name} {benchmark_class} {benchmark_dir}/NPB3.3-SER-C {binary_dir} {build_dir} {compiler_bins}/clang {sysprog_bins}/clang {compile_flags} {link_flags} {extension_lib} {object_cache}
     """
 
     clean_cmd_template = """
@@ -588,6 +672,11 @@ rm -rf {binary_dir}/*.x {build_dir}/*.o
         if "linker_flags" in benchmark_config:
             self.linker_flags = benchmark_config["linker_flags"]
 
+        # reuse vanilla compiled common and verification objects across builds
+        self.__object_cache: Optional[Path] = None
+        if benchmark_config.get("cache_vanilla_objects", False):
+            self.__object_cache = self.__build_dir.parent / "object_cache"
+
     def prepare_output(self):
         """Prepare required output directories and files"""
         bin_base = self._benchmark_dir / "direct_build" / "bin"
@@ -645,6 +734,9 @@ rm -rf {binary_dir}/*.x {build_dir}/*.o
             compile_flags=compile_flags,
             link_flags=link_flags,
             extension_lib=extension_lib if extension_lib is not None else '""',
+            object_cache=(
+                self.__object_cache if self.__object_cache is not None else ""
+            ),
         )
 
         try:
@@ -778,7 +870,9 @@ rm -rf {binary_dir}/*.x {build_dir}/*.o
         # the workload class to be used for the benchmark suite
         self.__wl_class = wl_class
 
-        self.__verifier = Polybench_Verifier()
+        # print one digest per output array instead of the array contents
+        self.__verify_digests = benchmark_config.get("verify_digests", False)
+        self.__verifier = Polybench_Verifier(digest=self.__verify_digests)
 
         self.prepare_output()
 
@@ -843,7 +937,10 @@ rm -rf {binary_dir}/*.x {build_dir}/*.o
         extension_lib: Optional[Path],
         memory_limit: Optional[int] = None,
     ) -> ExecutionResult:
-        compile_flags = f'"{self.compiler_flags}"'
+        compile_flags = self.compiler_flags
+        if self.__verify_digests:
+            compile_flags += " -DPOLYBENCH_DUMP_DIGEST"
+        compile_flags = f'"{compile_flags}"'
         link_flags = f'"{self.linker_flags}"'
 
         if not self.clean():
@@ -1304,10 +1401,13 @@ class BenchmarkFactory:
         self.bfilter = bfilter
         self.verbose = verbose
 
-    def setup_benchmark_instance(self, working_dir: Path) -> Dict[str, TestCase]:
+    def setup_benchmark_instance(
+        self, working_dir: Path, hardlink: bool = False
+    ) -> Dict[str, TestCase]:
         """
         Copy benchmark sources to specified working directory
         and build configured test cases.
+        Read-only source files are hardlinked if hardlink is set, see TreeCloner.
         """
         benchmarks = dict()
         with Timer():
@@ -1318,8 +1418,8 @@ class BenchmarkFactory:
                 original_src = build_path_or_fail(b_cfg["benchmark_dir"])
                 benchmark_src_dir = working_dir / "benchmarks_src" / b_name
 
-                logger.info(f"Copying directory tree {original_src}...")
-                shutil.copytree(original_src, benchmark_src_dir, symlinks=True)
+                logger.info(f"Cloning directory tree {original_src}...")
+                clone_tree(original_src, benchmark_src_dir, hardlink)
 
                 b_instances = self.load_test_cases(benchmark_src_dir, b_cfg)
                 logger.info(f"{len(b_instances)} tests created for {b_name}.")
@@ -0,0 +1,98 @@
+# Copyright (c) 2021, Björn Franke
+#
+# This source code is licensed under the MIT license found in the
+# LICENSE file in the root directory of this source tree.
+
+"""Persistent checkpoints of prior models for tasks still being evaluated"""
+
+import logging
+import os
+import pickle
+from pathlib import Path
+from typing import Any, Dict, FrozenSet, Iterable, Optional, Tuple
+
+from augmentum.priors import Prior
+from augmentum.workqueue import task_digest
+
+logger = logging.getLogger(__name__)
+
+# bump whenever the on-disk layout of checkpoints changes
+CHECKPOINT_FORMAT_VERSION = 1
+
+
+class PriorCheckpoints:
+    """
+    Prior models of in-flight tasks persisted across driver sessions.
+
+    Each task, identified by module, function and path, has a single checkpoint
+    file holding the latest prior model and objective improvement flag for
+    every set of test cases it is evaluated with. Workers save a checkpoint
+    after each probe round and the driver discards it once the task results
+    are recorded in the heuristic database. A task dispatched again after a
+    crash resumes from its checkpoint instead of starting from scratch.
+    """
+
+    def __init__(self, checkpoint_dir: Path):
+        self.checkpoint_dir = checkpoint_dir
+
+    def task_file(self, m_name: str, fn_name: str, p_name: str) -> Path:
+        return self.checkpoint_dir / f"{task_digest(m_name, fn_name, p_name)}.pickle"
+
+    def _read(self, m_name: str, fn_name: str, p_name: str) -> Dict[str, Any]:
+        """Read checkpoint of a task, return an empty one if missing or invalid."""
+        task = (m_name, fn_name, p_name)
+        empty = {"version": CHECKPOINT_FORMAT_VERSION, "task": task, "priors": dict()}
+
+        task_file = self.task_file(m_name, fn_name, p_name)
+        if not task_file.exists():
+            return empty
+
+        try:
+            with task_file.open("rb") as infile:
+                data = pickle.load(infile)
+        except (OSError, EOFError, pickle.UnpicklingError) as e:
+            logger.warning(f"Ignoring unreadable prior checkpoint {task_file}: {e}")
+            return empty
+
+        if data.get("version") != CHECKPOINT_FORMAT_VERSION or data.get("task") != task:
+            logger.warning(
+                f"Prior checkpoint {task_file} was created for a different task "
+                "or format. Ignoring it."
+            )
+            return empty
+
+        return data
+
+    def load(
+        self, m_name: str, fn_name: str, p_name: str, test_cases: Iterable[str]
+    ) -> Optional[Tuple[Prior, bool]]:
+        """Return prior model and objective improvement saved for the given tests."""
+        priors: Dict[FrozenSet[str], Tuple[Prior, bool]] = self._read(
+            m_name, fn_name, p_name
+        )["priors"]
+        return priors.get(frozenset(test_cases))
+
+    def save(
+        self,
+        m_name: str,
+        fn_name: str,
+        p_name: str,
+        test_cases: Iterable[str],
+        prior_model: Prior,
+        obj_improvement: bool,
+    ):
+        data = self._read(m_name, fn_name, p_name)
+        data["priors"][frozenset(test_cases)] = (prior_model, obj_improvement)
+
+        # write to temporary file first so a crash never leaves a partial checkpoint
+        task_file = self.task_file(m_name, fn_name, p_name)
+        tmp_file = task_file.with_name(f"{task_file.name}.{os.getpid()}.tmp")
+        with tmp_file.open("wb") as outfile:
+            pickle.dump(data, outfile, protocol=pickle.HIGHEST_PROTOCOL)
+        os.replace(tmp_file, task_file)
+
+    def discard(self, m_name: str, fn_name: str, p_name: str):
+        try:
+            self.task_file(m_name, fn_name, p_name).unlink()
+        except FileNotFoundError:
+            pass
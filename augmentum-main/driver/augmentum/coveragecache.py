@@ -0,0 +1,163 @@
+# Copyright (c) 2021, Björn Franke
+#
+# This source code is licensed under the MIT license found in the
+# LICENSE file in the root directory of this source tree.
+
+"""Persistent cache of which test cases execute which target functions"""
+
+import hashlib
+import json
+import logging
+import os
+import pickle
+from pathlib import Path
+from typing import Any, Dict, Iterable, Optional, Set
+
+logger = logging.getLogger(__name__)
+
+# bump whenever the on-disk layout of the cache changes
+CACHE_FORMAT_VERSION = 1
+
+
+def hash_files(files: Iterable[Path], chunk_size: int = 1 << 20) -> str:
+    """Return a sha256 digest over the content of the given files."""
+    digest = hashlib.sha256()
+    for f in files:
+        digest.update(str(f.name).encode("utf-8"))
+        with f.open("rb") as infile:
+            for chunk in iter(lambda: infile.read(chunk_size), b""):
+                digest.update(chunk)
+    return digest.hexdigest()
+
+
+def hash_config(config: Any) -> str:
+    """Return a sha256 digest over a json serialisable configuration."""
+    return hashlib.sha256(
+        json.dumps(config, sort_keys=True, default=str).encode("utf-8")
+    ).hexdigest()
+
+
+class CoverageCache:
+    """
+    Function to test case coverage map persisted across driver sessions.
+
+    Coverage only depends on the compiler build and the benchmark
+    configuration, so entries are keyed by a hash of both. If the key of an
+    existing cache file does not match, the stored coverage is discarded.
+
+    Targets are recorded as traced even if no test executes them, so that
+    uncovered functions are not traced again in later sessions.
+    """
+
+    def __init__(self, cache_file: Path, build_hash: str, benchmark_hash: str):
+        self.cache_file = cache_file
+        self.key = (build_hash, benchmark_hash)
+
+        # module_name -> {function_name -> {test_case_name, ...}}
+        self.coverage: Dict[str, Dict[str, Set[str]]] = dict()
+        # module_name -> {function_name, ...}
+        self.traced: Dict[str, Set[str]] = dict()
+
+        data = self._read()
+        if data is not None:
+            self.coverage = data["coverage"]
+            self.traced = data["traced"]
+            logger.info(
+                f"Loaded test coverage for {self.traced_count()} functions "
+                f"from {self.cache_file}."
+            )
+
+    def _read(self) -> Optional[Dict[str, Any]]:
+        """Read cache file, return None if missing or created for a different key."""
+        if not self.cache_file.exists():
+            return None
+
+        with self.cache_file.open("rb") as infile:
+            data = pickle.load(infile)
+
+        if data.get("version") != CACHE_FORMAT_VERSION or data.get("key") != self.key:
+            logger.warning(
+                f"Test coverage cache {self.cache_file} was created for a different "
+                "compiler build or benchmark configuration. Ignoring it."
+            )
+            return None
+
+        return data
+
+    def traced_count(self) -> int:
+        return sum([len(fns) for fns in self.traced.values()])
+
+    def untraced(self, target_fns: Dict[str, Set[str]]) -> Dict[str, Set[str]]:
+        """Return the subset of target functions never traced before."""
+        missing = dict()
+        for m_name, functions in target_fns.items():
+            known = self.traced.get(m_name, set())
+            fns = functions.difference(known)
+            if len(fns) > 0:
+                missing[m_name] = fns
+        return missing
+
+    def lookup(
+        self, target_fns: Dict[str, Set[str]]
+    ) -> Dict[str, Dict[str, Set[str]]]:
+        """Return cached coverage restricted to the given target functions."""
+        selected_tests: Dict[str, Dict[str, Set[str]]] = dict()
+        for m_name, functions in target_fns.items():
+            m_coverage = self.coverage.get(m_name)
+            if m_coverage is None:
+                continue
+            for fn_name in functions:
+                if fn_name in m_coverage:
+                    if m_name not in selected_tests:
+                        selected_tests[m_name] = dict()
+                    selected_tests[m_name][fn_name] = set(m_coverage[fn_name])
+        return selected_tests
+
+    def update(
+        self,
+        traced_fns: Dict[str, Set[str]],
+        selected_tests: Dict[str, Dict[str, Set[str]]],
+    ):
+        """Record coverage of freshly traced target functions and persist it."""
+        self._merge(traced_fns, selected_tests)
+
+        # merge with whatever parallel jobs sharing this cache stored meanwhile
+        data = self._read()
+        if data is not None:
+            self._merge(data["traced"], data["coverage"])
+
+        self.save()
+
+    def _merge(
+        self,
+        traced_fns: Dict[str, Set[str]],
+        selected_tests: Dict[str, Dict[str, Set[str]]],
+    ):
+        for m_name, functions in traced_fns.items():
+            self.traced.setdefault(m_name, set()).update(functions)
+
+        for m_name, fns in selected_tests.items():
+            m_coverage = self.coverage.setdefault(m_name, dict())
+            for fn_name, tcs in fns.items():
+                m_coverage.setdefault(fn_name, set()).update(tcs)
+
+    def save(self):
+        logger.info(
+            f"Caching test coverage for {self.traced_count()} functions "
+            f"to {self.cache_file} ..."
+        )
+        # write to temporary file first so readers never observe a partial cache
+        tmp_file = self.cache_file.with_name(
+            f"{self.cache_file.name}.{os.getpid()}.tmp"
+        )
+        with tmp_file.open("wb") as outfile:
+            pickle.dump(
+                {
+                    "version": CACHE_FORMAT_VERSION,
+                    "key": self.key,
+                    "traced": self.traced,
+                    "coverage": self.coverage,
+                },
+                outfile,
+            )
+        os.replace(tmp_file, self.cache_file)
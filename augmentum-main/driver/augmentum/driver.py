@@ -5,26 +5,40 @@
 
 import csv
 import logging
-import pickle
+import time
+from collections import deque
 from pathlib import Path
-from typing import Any, Dict, Iterable, Optional, Tuple, Union
+from typing import Any, Deque, Dict, Iterable, Optional, Tuple, Union
 
 import augmentum.paths as a2p
+from augmentum.checkpoints import PriorCheckpoints
+from augmentum.coveragecache import CoverageCache, hash_config, hash_files
 from augmentum.function import Function, Module, build_modules
 from augmentum.functionfilter import FunctionFilter
 from augmentum.heuristicDB import HeuristicDB
+from augmentum.inventory import FunctionInventory
+from augmentum.memmonitor import MemoryAdmission
 from augmentum.objectives import ObjectiveMetric
+from augmentum.pathranking import PathRanker
 from augmentum.pathworker import PathWorker, Task, TaskCounter, WorkerResult
+from augmentum.scratch import ScratchSpace
 from augmentum.sysProg import InstrumentationScope, SysProg
+from augmentum.sysUtils import get_memory
 from augmentum.targetfilter import TargetFilter
 from augmentum.testcasemanager import TestCaseManager
 from augmentum.timer import Timer
+from augmentum.workqueue import SharedWorkQueue, task_digest
 from mptools import EventMessage, MainContext, MPQueue
 
 from augmentum.benchmarks import BenchmarkFactory, TestCase
 
 logger = logging.getLogger(__name__)
 
+# seconds to wait before checking again for paths leased by other drivers
+SHARED_QUEUE_POLL_SECS = 10.0
+# seconds between merges of the results of drivers sharing the work queue
+SHARED_QUEUE_MERGE_SECS = 30.0
+
 
 class Driver:
     def __init__(
@@ -44,8 +58,17 @@ class Driver:
         instr_chunk: int,
         function_cache: Optional[Path] = None,
         baseline_cache: Optional[Path] = None,
+        test_selection_cache: Optional[Path] = None,
+        checkpoint_dir: Optional[Path] = None,
         keep_probes: bool = False,
         probe_mem_limit: Optional[int] = None,
+        mem_budget: Optional[float] = None,
+        scratch_dir: Optional[Path] = None,
+        scratch_size: Optional[float] = None,
+        shared_queue: Optional[Path] = None,
+        lease_timeout: float = SharedWorkQueue.LEASE_TIMEOUT,
+        queue_main: bool = False,
+        rank_paths: bool = False,
         worker_mul: float = 1.0,
         exact_cpu_map: bool = False,
         dry_run: bool = False,
@@ -67,11 +90,34 @@ class Driver:
         self.instr_scope = instr_scope
         self.instr_chunk = instr_chunk
         self.function_cache = function_cache
+        self.function_inventory: Optional[FunctionInventory] = None
         self.baseline_cache = baseline_cache
 
         self.keep_probes = keep_probes
         self.probe_mem_limit = probe_mem_limit
 
+        # tasks are handed to workers only while their projected memory fits the budget
+        self.mem_budget = mem_budget
+        self.mem_admission: Optional[MemoryAdmission] = None
+        self.pending_tasks: Deque[Task] = deque()
+
+        # scratch space of each worker, e.g. on a tmpfs, shared by all runs
+        self.scratch_dir = scratch_dir / wd_run.name if scratch_dir else None
+        self.scratch_size = scratch_size
+
+        # tasks are claimed from a work queue shared with other drivers if set
+        self.shared_queue: Optional[SharedWorkQueue] = None
+        if shared_queue is not None:
+            self.shared_queue = SharedWorkQueue(shared_queue, lease_timeout)
+            logger.info(
+                f"Sharing work queue at {shared_queue} as {self.shared_queue.owner}"
+                + (", merging results of all drivers." if queue_main else ".")
+            )
+        self.queue_main = queue_main
+
+        # most promising paths are dispatched first if set
+        self.path_ranker: Optional[PathRanker] = PathRanker() if rank_paths else None
+
         self.test_cases: Dict[
             str, TestCase
         ] = self.benchmark_factory.setup_benchmark_instance(self.wd_workers)
@@ -79,6 +125,8 @@ class Driver:
             self.tools, self.wd_workers, keep_probes=self.keep_probes
         )
         self.objective_metric = objective_metric
+        self.coverage_cache = self.setup_coverage_cache(test_selection_cache)
+        self.checkpoints = self.setup_checkpoints(checkpoint_dir)
 
         self.worker_mul = worker_mul
         self.exact_cpu_map = exact_cpu_map
@@ -94,6 +142,51 @@ class Driver:
 
         self.heuristicDB = self.setup_heuristic_dbs(heuristicURL, wd_run)
 
+    def setup_coverage_cache(
+        self, cache_file: Optional[Path]
+    ) -> Optional[CoverageCache]:
+        """
+        Load test coverage cache keyed by the current compiler build
+        and benchmark configuration if a cache file is specified.
+        """
+        if cache_file is None:
+            return None
+
+        build_hash = hash_files(
+            [
+                self.sys_prog.target_function_data_path,
+                self.sys_prog.named_structs_path,
+                Path(self.tools["augmentum_pass"]),
+            ]
+        )
+        benchmark_hash = hash_config(
+            {
+                "configs": self.benchmark_factory.configs,
+                "filter": self.benchmark_factory.bfilter,
+                "test_cases": sorted(self.test_cases.keys()),
+            }
+        )
+        return CoverageCache(cache_file, build_hash, benchmark_hash)
+
+    def setup_checkpoints(
+        self, checkpoint_dir: Optional[Path]
+    ) -> Optional[PriorCheckpoints]:
+        """
+        Prepare checkpoints of in-flight prior models if a checkpoint directory
+        is specified. Checkpoints of tasks interrupted in a previous session
+        are resumed when the task is dispatched again.
+        """
+        if checkpoint_dir is None:
+            return None
+
+        checkpoint_dir.mkdir(parents=True, exist_ok=True)
+        pending = len(list(checkpoint_dir.glob("*.pickle")))
+        if pending > 0:
+            logger.info(
+                f"Found {pending} prior model checkpoints to resume in {checkpoint_dir}."
+            )
+        return PriorCheckpoints(checkpoint_dir)
+
     def setup_heuristic_dbs(
         self, dbURL: Optional[str], wd_run: Path
     ) -> Union[Dict[str, HeuristicDB], HeuristicDB]:
@@ -128,6 +221,12 @@ class Driver:
     def clean_up(self):
         """Clean up left over resources"""
         self.sys_prog.clear_existing_extension_pts()
+        if self.shared_queue is not None:
+            if self.queue_main:
+                self.merge_shared_results()
+            self.shared_queue.close()
+        if self.function_inventory is not None:
+            self.function_inventory.close()
 
     def send_event(self, source: str, type: str):
         if type in ["END", "DISPATCH"]:
@@ -140,28 +239,28 @@ class Driver:
         """
         Collect target functions, deserialise and filter them.
 
-        Use cached version if available.
+        Use function inventory if available or create it first.
         """
 
-        if self.function_cache is not None and self.function_cache.exists():
+        if self.function_cache is not None:
+            if not self.function_cache.exists():
+                self.sys_prog.create_function_inventory(self.function_cache)
+
             logger.info(
-                "Loading cached target functions from "
+                "Loading target functions from inventory "
                 + str(self.function_cache)
                 + " ..."
             )
-            with self.function_cache.open("rb") as infile:
-                target_functions = pickle.load(infile)
+            # inventory stays open, functions deserialise their types on demand
+            self.function_inventory = FunctionInventory(self.function_cache)
+            with Timer():
+                target_functions = self.function_inventory.get_functions(
+                    self.function_filter
+                )
         else:
             # deserialises them and builds corresponding functions.
             target_functions = self.sys_prog.get_functions(self.function_filter)
 
-            if self.function_cache is not None:
-                logger.info(
-                    "Caching target functions to " + str(self.function_cache) + " ..."
-                )
-                with self.function_cache.open("wb") as outfile:
-                    pickle.dump(target_functions, outfile)
-
         return target_functions
 
     def build_evaluation_targets(
@@ -194,11 +293,9 @@ class Driver:
                 fn_paths = fn.get_paths()
                 if self.target_filter is not None:
                     # generate possible function paths and apply target filter
-                    fn_paths = [
-                        p
-                        for p in fn_paths
-                        if self.target_filter.should_evaluate(m_name, fn_name, str(p))
-                    ]
+                    fn_paths = self.target_filter.filter_paths(
+                        m_name, fn_name, fn_paths
+                    )
 
                 # if the function has no paths to be evaluated, mark it and move on to the next function
                 if len(fn_paths) == 0:
@@ -245,6 +342,16 @@ class Driver:
 
         return m_count, fn_count, p_count
 
+    def bootstrap_path_ranker(self, modules: Dict[str, Module]):
+        """Train path ranking on paths evaluated in previous runs."""
+        if self.independent_test_cases:
+            dbs = list(self.heuristicDB.values())
+        else:
+            dbs = [self.heuristicDB]
+
+        for db in dbs:
+            self.path_ranker.bootstrap(modules, db.get_path_results())
+
     def select_tasks(
         self,
         modules: Dict[str, Module],
@@ -252,24 +359,58 @@ class Driver:
     ) -> Iterable[Task]:
         logger.debug(f"Selecting tasks from {self.instr_chunk} {self.instr_scope}...")
 
+        if self.path_ranker is not None:
+            targets = self.path_ranker.rank(modules, evaluation_targets)
+        else:
+            targets = [
+                (m_name, fn_name, path)
+                for m_name, fns in evaluation_targets.items()
+                for fn_name, paths in fns.items()
+                for path in paths.values()
+            ]
+
         tasks = []
         counter = self.instr_chunk
+        # functions and modules selected so far, all their paths are included
+        selected_fns = set()
+        selected_mods = set()
 
-        for m_name, fns in evaluation_targets.items():
-            if counter == 0:
+        for m_name, fn_name, path in targets:
+            if self.instr_scope == InstrumentationScope.PATH and counter == 0:
                 break
-            for fn_name, paths in fns.items():
-                if counter == 0:
-                    break
-                for _, path in paths.items():
-                    if counter == 0:
-                        break
-                    tasks.append(Task(modules[m_name].functions[fn_name], path))
-                    if self.instr_scope == InstrumentationScope.PATH:
-                        counter -= 1
-                if self.instr_scope == InstrumentationScope.FUNCTION:
-                    counter -= 1
-            if self.instr_scope == InstrumentationScope.MODULE:
+            if (
+                self.instr_scope == InstrumentationScope.FUNCTION
+                and (m_name, fn_name) not in selected_fns
+                and counter == 0
+            ):
+                continue
+            if (
+                self.instr_scope == InstrumentationScope.MODULE
+                and m_name not in selected_mods
+                and counter == 0
+            ):
+                continue
+
+            claimed = self.shared_queue is None or self.shared_queue.try_claim(
+                m_name, fn_name, str(path)
+            )
+            if not claimed:
+                continue  # leased by another driver
+            tasks.append(Task(modules[m_name].functions[fn_name], path))
+
+            if self.instr_scope == InstrumentationScope.PATH:
+                counter -= 1
+            elif (
+                self.instr_scope == InstrumentationScope.FUNCTION
+                and (m_name, fn_name) not in selected_fns
+            ):
+                selected_fns.add((m_name, fn_name))
+                counter -= 1
+            elif (
+                self.instr_scope == InstrumentationScope.MODULE
+                and m_name not in selected_mods
+            ):
+                selected_mods.add(m_name)
                 counter -= 1
 
         return tasks
@@ -287,11 +428,28 @@ class Driver:
         MODULE : select all paths from all functions from the next chunk of modules
         ALL : select all paths from all functions in all modules (chunk size ignored)
 
+        With path ranking, paths, functions and modules are selected in the order
+        of their most promising path instead of the order they were found in.
+
         Instrument the system program for all functions corresponding to selected paths
         and select executed test cases.
         """
+        if self.shared_queue is not None:
+            self.prune_finished_targets(evaluation_targets)
+
         tasks = self.select_tasks(modules, evaluation_targets)
-        if len(tasks) == 0:
+        if (
+            len(tasks) == 0
+            and len(evaluation_targets) > 0
+            and self.shared_queue is not None
+        ):
+            # remaining paths are leased by other drivers, their leases may expire
+            counts = self.count_evaluation_targets(evaluation_targets)
+            logger.info(f"Waiting for {counts[2]} paths leased by other drivers ...")
+            self.main_ctx.shutdown_event.wait(SHARED_QUEUE_POLL_SECS)
+            self.send_event("dispatch_path_tasks", "DISPATCH")
+            return TaskCounter(0)
+        elif len(tasks) == 0:
             logger.warning("No futher tasks available for dispatch. Shutting down ...")
             self.send_event("dispatch_path_tasks", "END")
             return TaskCounter(0)
@@ -305,13 +463,14 @@ class Driver:
         if self.active_instrumentation:
             self.sys_prog.instrument(target_fns)
         selected_tests = self.tc_manager.select_tests(
-            target_fns.keys(), self.sys_prog, self.test_cases
+            target_fns, self.sys_prog, self.test_cases, self.coverage_cache
         )
 
         logger.debug("Dispatching tasks ...")
         for t in tasks:
             t.set_test_cases(selected_tests)
-            task_q.safe_put(t)
+            self.pending_tasks.append(t)
+        self.admit_tasks(task_q)
 
         counts = self.count_evaluation_targets(evaluation_targets)
         logger.info(
@@ -320,6 +479,32 @@ class Driver:
 
         return TaskCounter(len(tasks))
 
+    def admit_tasks(self, task_q: MPQueue):
+        """
+        Hand pending tasks to the workers. If a memory budget is set, tasks are
+        admitted only as long as their projected peak memory fits, so that the
+        number of concurrently evaluated tasks follows their memory demand.
+        """
+        while len(self.pending_tasks) > 0:
+            task = self.pending_tasks[0]
+
+            # tasks without tests finish right away without running anything
+            if self.mem_admission is not None and len(task.fn_test_cases) > 0:
+                projection = self.mem_admission.try_admit(
+                    task.function.module, task.function.name, get_memory() * 1024
+                )
+                if projection is None:
+                    logger.debug(
+                        f"Holding back {len(self.pending_tasks)} tasks, "
+                        f"{len(self.mem_admission.active)} tasks active with "
+                        f"{self.mem_admission.committed() // (1024 * 1024)} MB "
+                        f"of {self.mem_budget} MB projected."
+                    )
+                    return
+                task.mem_projection = projection
+
+            task_q.safe_put(self.pending_tasks.popleft())
+
     def record_results_to_db(
         self,
         m_name: str,
@@ -365,6 +550,7 @@ class Driver:
         eval_targets: Dict[str, Dict[str, Dict[str, a2p.Path]]],
         active_tasks: TaskCounter,
         event: EventMessage,
+        task_q: MPQueue,
     ):
         # remove completed tasks from evaluation targets
         task: Task = event.msg
@@ -374,6 +560,64 @@ class Driver:
 
         logger.info(f"Task processed for - '{task}'")
 
+        if self.mem_admission is not None and task.mem_projection is not None:
+            self.mem_admission.finished(
+                m_name, fn_name, task.mem_projection, task.peak_rss
+            )
+            self.admit_tasks(task_q)
+
+        if self.remove_target(eval_targets, m_name, fn_name, p_name):
+            active_tasks.counter -= 1
+        else:
+            logger.warning(f"Task finished which is no longer in task list {task}")
+
+        if self.path_ranker is not None:
+            self.learn_path_rank(task)
+
+        if self.shared_queue is not None:
+            # results reach the database through the main driver merging all shards
+            self.shared_queue.complete(m_name, fn_name, p_name, task)
+            if self.queue_main:
+                self.merge_shared_results()
+        else:
+            self.record_task_results(task)
+
+        # results are persisted, the task does not need to be resumed anymore
+        if self.checkpoints is not None:
+            self.checkpoints.discard(m_name, fn_name, p_name)
+
+        if len(eval_targets) == 0:
+            self.send_event("process_task_results", "END")
+        elif active_tasks.counter == 0:
+            self.send_event("process_task_results", "DISPATCH")
+
+    def learn_path_rank(self, task: Task):
+        """Update path ranking with the result of a finished task."""
+        if isinstance(task.result, WorkerResult):
+            wresults = [task.result]
+        elif task.result is not None:
+            wresults = list(task.result.values())
+        else:
+            wresults = []
+
+        if len(wresults) == 0:
+            return  # no test covers the target, nothing to learn from
+
+        self.path_ranker.learn_result(
+            task.function,
+            str(task.path),
+            any(r.prior_model.prior_result().success for r in wresults),
+            any(r.obj_improvement for r in wresults),
+        )
+
+    def remove_target(
+        self,
+        eval_targets: Dict[str, Dict[str, Dict[str, a2p.Path]]],
+        m_name: str,
+        fn_name: str,
+        p_name: str,
+    ) -> bool:
+        """Remove a finished path from evaluation targets, False if not present."""
         if (
             m_name in eval_targets
             and fn_name in eval_targets[m_name]
@@ -388,10 +632,53 @@ class Driver:
                 if len(eval_targets[m_name]) == 0:
                     logger.info(f"Module finished {m_name}")
                     del eval_targets[m_name]
+            return True
+        return False
 
-            active_tasks.counter -= 1
+    def prune_finished_targets(
+        self, eval_targets: Dict[str, Dict[str, Dict[str, a2p.Path]]]
+    ):
+        """Remove paths other drivers of the shared work queue finished."""
+        done = self.shared_queue.done_tasks()
+        finished = [
+            (m_name, fn_name, p_name)
+            for m_name, fns in eval_targets.items()
+            for fn_name, paths in fns.items()
+            for p_name in paths.keys()
+            if task_digest(m_name, fn_name, p_name) in done
+        ]
+        for m_name, fn_name, p_name in finished:
+            self.remove_target(eval_targets, m_name, fn_name, p_name)
+
+        if len(finished) > 0:
+            logger.info(f"Skipping {len(finished)} paths finished by other drivers.")
+
+    def merge_shared_results(self):
+        """Record results of all drivers not yet in the heuristic database."""
+        tasks = self.shared_queue.read_results()
+        if len(tasks) == 0:
+            return
+
+        if self.independent_test_cases:
+            # all test case databases are updated together, so any is representative
+            db = self.heuristicDB[next(iter(self.heuristicDB))]
         else:
-            logger.warning(f"Task finished which is no longer in task list {task}")
+            db = self.heuristicDB
+        finished_path_lookup = db.get_evaluated_paths()
+
+        merged = 0
+        for task in tasks:
+            m_name = task.function.module
+            fn_name = task.function.name
+            if db.get_lookup_string(m_name, fn_name, task.path) in finished_path_lookup:
+                continue
+            self.record_task_results(task)
+            merged += 1
+        logger.info(f"Merged {merged} task results from the shared work queue.")
+
+    def record_task_results(self, task: Task):
+        m_name = task.function.module
+        fn_name = task.function.name
 
         if self.independent_test_cases:
             for tc_name, db in self.heuristicDB.items():
@@ -412,11 +699,6 @@ class Driver:
                 len(task.fn_test_cases),
             )
 
-        if len(eval_targets) == 0:
-            self.send_event("process_task_results", "END")
-        elif active_tasks.counter == 0:
-            self.send_event("process_task_results", "DISPATCH")
-
     def emit_targets(
         self, evaluation_targets: Dict[str, Dict[str, Dict[str, a2p.Path]]]
     ):
@@ -452,6 +734,10 @@ class Driver:
                 f"Building evaluation targets for {str(len(functions))} functions in {str(len(modules))} modules ..."
             )
 
+            if self.path_ranker is not None:
+                # before building targets drops the functions of evaluated paths
+                self.bootstrap_path_ranker(modules)
+
             evaluation_targets: Dict[str, Dict[str, Dict[str, a2p.Path]]] = dict()
             if self.independent_test_cases:
                 # TODO find a better way than simply using the first in the list
@@ -501,11 +787,40 @@ class Driver:
         else:
             worker_count = int(self.cpus * self.worker_mul)
 
+        if self.mem_budget is not None:
+            logger.info(
+                f"Admitting tasks to up to {worker_count} workers "
+                f"within a memory budget of {self.mem_budget} MB."
+            )
+            self.mem_admission = MemoryAdmission(
+                int(self.mem_budget * 1024 * 1024), worker_count
+            )
+
+        # A fixed address space limit fails probes that legitimately need more
+        # than their share, while admission already keeps the total in budget.
+        probe_mem_limit = self.probe_mem_limit
+        if self.mem_admission is not None and probe_mem_limit is not None:
+            logger.info(
+                f"Ignoring probe memory limit of {probe_mem_limit} MB, "
+                "memory is managed by the memory budget."
+            )
+            probe_mem_limit = None
+
+        scratch_capacity = None
+        if self.scratch_size is not None:
+            scratch_capacity = int(self.scratch_size * 1024 * 1024)
+
         logger.info(f"Starting {worker_count} path worker processes ...")
         for i in range(worker_count):
             worker_name = f"PATH_WORKER_{i}"
             working_dir = self.wd_workers / worker_name
             working_dir.mkdir(exist_ok=False)
+
+            scratch = None
+            if self.scratch_dir is not None:
+                scratch = ScratchSpace(
+                    self.scratch_dir / worker_name, working_dir, scratch_capacity
+                )
             self.main_ctx.Proc(
                 worker_name,
                 PathWorker,
@@ -516,15 +831,30 @@ class Driver:
                 self.objective_metric,
                 working_dir,
                 self.keep_probes,
-                self.probe_mem_limit,
+                probe_mem_limit,
                 self.skip_immutables,
                 self.independent_test_cases,
+                self.checkpoints,
+                scratch,
             )
 
         self.send_event("evaluate_program", "DISPATCH")
 
+        if self.shared_queue is not None:
+            # leases are refreshed while the main loop blocks, e.g. instrumenting
+            self.shared_queue.start_heartbeat()
+        last_merge = time.monotonic()
+
         active_tasks = TaskCounter(0)
         while not self.main_ctx.shutdown_event.is_set():
+            if (
+                self.shared_queue is not None
+                and self.queue_main
+                and time.monotonic() - last_merge >= SHARED_QUEUE_MERGE_SECS
+            ):
+                self.merge_shared_results()
+                last_merge = time.monotonic()
+
             event = self.main_ctx.event_queue.safe_get()
             if not event:
                 continue
@@ -534,7 +864,9 @@ class Driver:
                 )
                 logger.info(f"Dispatched {active_tasks} tasks")
             elif event.msg_type == "PATH_DONE":
-                self.process_task_results(evaluation_targets, active_tasks, event)
+                self.process_task_results(
+                    evaluation_targets, active_tasks, event, task_q
+                )
             elif event.msg_type == "FATAL":
                 logger.info(f"Fatal Event received: {event.msg}")
                 break
@@ -278,23 +278,31 @@ class Function:
         self.type = type
         self.function_stats = function_stats
 
-    def get_paths(self) -> Iterable[augmentum.paths.Path]:
-        paths = self.type.get_paths(ctx=augmentum.paths.PathContext.FUNCTION)
+    def iter_path_codes(self) -> Generator[augmentum.paths.PathCode, None, None]:
+        """
+        Lazily enumerate integer encoded paths of this function.
+        Path codes are memoised by the function type.
+        """
+        codes = self.type.path_codes(augmentum.paths.PathContext.FUNCTION)
 
         # filter out const arguments based on demangled name
         if self.demangled_name != "NA":
-            const_args = get_const_args_from_demangled_name(self.demangled_name)
-
-            result = []
-            for p in paths:
-                if str(p).startswith("A") and str(p).split(".")[0] in const_args:
-                    continue
-                else:
-                    result.append(p)
+            const_args = {
+                augmentum.paths.make_step(augmentum.paths.STEP_ARG, int(a[1:]))
+                for a in get_const_args_from_demangled_name(self.demangled_name)
+            }
+            for c in codes:
+                if c[0] not in const_args:
+                    yield c
         else:
-            result = paths
+            yield from codes
 
-        return result
+    def iter_paths(self) -> Generator[augmentum.paths.Path, None, None]:
+        for c in self.iter_path_codes():
+            yield augmentum.paths.decode_path(self.type, c)
+
+    def get_paths(self) -> Iterable[augmentum.paths.Path]:
+        return list(self.iter_paths())
 
     @property
     def demangled_name(self):
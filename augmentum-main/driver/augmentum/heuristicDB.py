@@ -4,7 +4,7 @@
 # LICENSE file in the root directory of this source tree.
 
 import pathlib
-from typing import Dict, Iterable, Optional, Set
+from typing import Dict, Iterable, Optional, Set, Tuple
 
 import sqlalchemy as db
 from augmentum.paths import Path
@@ -384,3 +384,18 @@ class HeuristicDB:
 
         # map result set to lookup set
         return {self.get_lookup_string(e[0], e[1], e[2]) for e in resultSet}
+
+    def get_path_results(self) -> Iterable[Tuple[str, str, str, str, bool]]:
+        """Return module, function, path, prior success and objective improvement
+        of all evaluated paths in the database."""
+        query = db.select(
+            [
+                self.pheu_tbl.c["module"],
+                self.pheu_tbl.c["function"],
+                self.pheu_tbl.c["path"],
+                self.pheu_tbl.c["prior_success"],
+                self.pheu_tbl.c["obj_improvement"],
+            ]
+        ).where(self.pheu_tbl.c["prior_success"] != "NA")
+        resultProxy = self.connection.execute(query)
+        return [tuple(e) for e in resultProxy.fetchall()]
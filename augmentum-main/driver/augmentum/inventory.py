@@ -0,0 +1,325 @@
+# Copyright (c) 2021, Björn Franke
+#
+# This source code is licensed under the MIT license found in the
+# LICENSE file in the root directory of this source tree.
+
+"""
+Compact on-disk inventory of available functions and named structs.
+
+The inventory is a single binary file that is memory mapped when opened.
+Strings (module names, function names, serialised types, ...) are interned
+into a string table and functions and named structs are stored as fixed size
+records referring to that table. Lookups use sorted indices so that single
+functions can be found without reading the whole inventory and Function objects
+only deserialise their type when it is first accessed.
+
+Layout (little endian):
+    header
+    string index     n_strings   x (blob offset, byte length)
+    function records n_functions x (module, name, demangled, type,
+                                    instruction count, can instrument)
+    function index   n_functions x record id sorted by (module, name)
+    struct records   n_structs   x (module, struct name, type, llvm name, extra)
+                                   sorted by key
+    string blob
+"""
+
+import logging
+import mmap
+import struct
+from pathlib import Path
+from typing import (
+    Dict,
+    Generator,
+    Iterable,
+    Iterator,
+    List,
+    Mapping,
+    Optional,
+    Tuple,
+)
+
+from augmentum.function import Function, FunctionData, NamedStructData
+from augmentum.functionfilter import FunctionFilter
+from augmentum.type_descs import FunctionTypeDesc
+from augmentum.type_serialisation import DeserialisationContext, TypeDeserialiser
+
+logger = logging.getLogger(__name__)
+
+INVENTORY_MAGIC = b"AUGMINV\0"
+INVENTORY_VERSION = 1
+
+HEADER = struct.Struct("<8sIIII")
+STRING_ENTRY = struct.Struct("<QI")
+FUNCTION_RECORD = struct.Struct("<IIIIII")
+INDEX_ENTRY = struct.Struct("<I")
+STRUCT_RECORD = struct.Struct("<IIIII")
+
+
+class StringInterner:
+    """Assign a unique id to each distinct string."""
+
+    def __init__(self):
+        self.ids: Dict[str, int] = dict()
+        self.strings: List[bytes] = []
+
+    def intern(self, s: str) -> int:
+        if s not in self.ids:
+            self.ids[s] = len(self.strings)
+            self.strings.append(s.encode("utf-8"))
+        return self.ids[s]
+
+
+def write_function_inventory(
+    function_data: Iterable[FunctionData],
+    named_structs: Mapping[str, NamedStructData],
+    inventory_file: Path,
+):
+    """Write function and named struct data to a binary inventory file."""
+    interner = StringInterner()
+
+    records: List[Tuple[int, ...]] = []
+    for fd in function_data:
+        records.append(
+            (
+                interner.intern(fd.module_name),
+                interner.intern(fd.function_name),
+                interner.intern(fd.function_name_demangled),
+                interner.intern(fd.serialised_type),
+                interner.intern(str(fd.instruction_count)),
+                interner.intern(fd.can_instrument),
+            )
+        )
+
+    # record ids sorted by module and function name for lookups
+    index = sorted(
+        range(len(records)),
+        key=lambda i: (
+            interner.strings[records[i][0]],
+            interner.strings[records[i][1]],
+        ),
+    )
+
+    struct_records: List[Tuple[int, ...]] = []
+    for key in sorted(named_structs.keys()):
+        sd = named_structs[key]
+        # only the packed flag is retained by NamedStructData
+        packed = "true" if sd.packed else "false"
+        extra = f"named:true#packed:{packed}#literal:false#opaque:false"
+        struct_records.append(
+            (
+                interner.intern(sd.module_name),
+                interner.intern(sd.struct_name),
+                interner.intern(sd.serialised_type),
+                interner.intern(sd.llvm_name),
+                interner.intern(extra),
+            )
+        )
+
+    with inventory_file.open("wb") as out:
+        out.write(
+            HEADER.pack(
+                INVENTORY_MAGIC,
+                INVENTORY_VERSION,
+                len(interner.strings),
+                len(records),
+                len(struct_records),
+            )
+        )
+
+        offset = 0
+        for s in interner.strings:
+            out.write(STRING_ENTRY.pack(offset, len(s)))
+            offset += len(s)
+
+        for r in records:
+            out.write(FUNCTION_RECORD.pack(*r))
+        for i in index:
+            out.write(INDEX_ENTRY.pack(i))
+        for r in struct_records:
+            out.write(STRUCT_RECORD.pack(*r))
+
+        for s in interner.strings:
+            out.write(s)
+
+
+class InventoryStructTable(Mapping[str, NamedStructData]):
+    """Read only named struct lookup backed by the inventory."""
+
+    def __init__(self, inventory: "FunctionInventory"):
+        self.inventory = inventory
+        self.cache: Dict[int, NamedStructData] = dict()
+
+    def _record(self, idx: int) -> NamedStructData:
+        if idx not in self.cache:
+            self.cache[idx] = NamedStructData(
+                *(
+                    self.inventory.string(s_id)
+                    for s_id in self.inventory.struct_record(idx)
+                )
+            )
+        return self.cache[idx]
+
+    def _find(self, key: str) -> Optional[int]:
+        lo = 0
+        hi = self.inventory.n_structs
+        while lo < hi:
+            mid = (lo + hi) // 2
+            mid_key = self._record(mid).key
+            if mid_key < key:
+                lo = mid + 1
+            elif mid_key > key:
+                hi = mid
+            else:
+                return mid
+        return None
+
+    def __getitem__(self, key: str) -> NamedStructData:
+        idx = self._find(key)
+        if idx is None:
+            raise KeyError(key)
+        return self._record(idx)
+
+    def __contains__(self, key: object) -> bool:
+        return isinstance(key, str) and self._find(key) is not None
+
+    def __iter__(self) -> Iterator[str]:
+        for idx in range(self.inventory.n_structs):
+            yield self._record(idx).key
+
+    def __len__(self) -> int:
+        return self.inventory.n_structs
+
+
+class LazyFunction(Function):
+    """Function whose type is deserialised from the inventory on first access."""
+
+    def __init__(self, inventory: "FunctionInventory", function_stats: FunctionData):
+        self.module = function_stats.module_name
+        self.name = function_stats.function_name
+        self.function_stats = function_stats
+        self.__inventory = inventory
+        self.__type: Optional[FunctionTypeDesc] = None
+
+    @property
+    def type(self) -> FunctionTypeDesc:
+        if self.__type is None:
+            self.__type = self.__inventory.deserialise_type(self.function_stats)
+        return self.__type
+
+    def __reduce__(self):
+        # the inventory mapping cannot be shared across processes,
+        # so lazy functions are sent to workers as plain functions
+        return (Function, (self.module, self.name, self.type, self.function_stats))
+
+
+class FunctionInventory:
+    """Memory mapped function inventory produced by write_function_inventory."""
+
+    def __init__(self, inventory_file: Path):
+        self.inventory_file = inventory_file
+        self.file = inventory_file.open("rb")
+        self.data = mmap.mmap(self.file.fileno(), 0, access=mmap.ACCESS_READ)
+
+        if len(self.data) < HEADER.size:
+            self.close()
+            raise RuntimeError(f"Invalid function inventory: {inventory_file}")
+
+        (
+            magic,
+            version,
+            self.n_strings,
+            self.n_functions,
+            self.n_structs,
+        ) = HEADER.unpack_from(self.data, 0)
+        if magic != INVENTORY_MAGIC or version != INVENTORY_VERSION:
+            self.close()
+            raise RuntimeError(
+                f"Unsupported function inventory format in {inventory_file}. "
+                "Delete the file to regenerate it."
+            )
+
+        self.strings_offset = HEADER.size
+        self.records_offset = self.strings_offset + self.n_strings * STRING_ENTRY.size
+        self.index_offset = (
+            self.records_offset + self.n_functions * FUNCTION_RECORD.size
+        )
+        self.structs_offset = self.index_offset + self.n_functions * INDEX_ENTRY.size
+        self.blob_offset = self.structs_offset + self.n_structs * STRUCT_RECORD.size
+
+        self.string_cache: Dict[int, str] = dict()
+        self.named_structs = InventoryStructTable(self)
+        self.deserialiser = TypeDeserialiser(self.named_structs)
+
+    def __enter__(self) -> "FunctionInventory":
+        return self
+
+    def __exit__(self, exc_type, exc_value, traceback):
+        self.close()
+
+    def close(self):
+        self.data.close()
+        self.file.close()
+
+    def __len__(self) -> int:
+        return self.n_functions
+
+    def string(self, s_id: int) -> str:
+        if s_id not in self.string_cache:
+            offset, length = STRING_ENTRY.unpack_from(
+                self.data, self.strings_offset + s_id * STRING_ENTRY.size
+            )
+            start = self.blob_offset + offset
+            self.string_cache[s_id] = self.data[start : start + length].decode("utf-8")
+        return self.string_cache[s_id]
+
+    def struct_record(self, idx: int) -> Tuple[int, ...]:
+        return STRUCT_RECORD.unpack_from(
+            self.data, self.structs_offset + idx * STRUCT_RECORD.size
+        )
+
+    def function_record(self, idx: int) -> Tuple[int, ...]:
+        return FUNCTION_RECORD.unpack_from(
+            self.data, self.records_offset + idx * FUNCTION_RECORD.size
+        )
+
+    def function_data(self, idx: int) -> FunctionData:
+        module, name, demangled, fn_type, instr_count, can_instrument = map(
+            self.string, self.function_record(idx)
+        )
+        return FunctionData(
+            module, name, fn_type, demangled, instr_count, can_instrument
+        )
+
+    def deserialise_type(self, fstats: FunctionData) -> FunctionTypeDesc:
+        return self.deserialiser.deserialise_type(
+            DeserialisationContext(fstats.module_name), fstats.serialised_type
+        )
+
+    def find(self, module: str, name: str) -> Optional[Function]:
+        """Binary search the function index for the given module and function."""
+        key = (module, name)
+        lo = 0
+        hi = self.n_functions
+        while lo < hi:
+            mid = (lo + hi) // 2
+            (idx,) = INDEX_ENTRY.unpack_from(
+                self.data, self.index_offset + mid * INDEX_ENTRY.size
+            )
+            record = self.function_record(idx)
+            mid_key = (self.string(record[0]), self.string(record[1]))
+            if mid_key < key:
+                lo = mid + 1
+            elif mid_key > key:
+                hi = mid
+            else:
+                return LazyFunction(self, self.function_data(idx))
+        return None
+
+    def __iter__(self) -> Generator[Function, None, None]:
+        """Iterate functions in the order they were collected."""
+        for idx in range(self.n_functions):
+            yield LazyFunction(self, self.function_data(idx))
+
+    def get_functions(self, function_filter: FunctionFilter) -> List[Function]:
+        return [fn for fn in self if function_filter.should_instrument(fn)]
@@ -0,0 +1,166 @@
+# Copyright (c) 2021, Björn Franke
+#
+# This source code is licensed under the MIT license found in the
+# LICENSE file in the root directory of this source tree.
+
+"""Memory accounting of path tasks and memory-aware admission of new tasks"""
+
+import logging
+import os
+import resource
+import threading
+from collections import deque
+from pathlib import Path
+from typing import Deque, Dict, List, Optional, Tuple
+
+logger = logging.getLogger(__name__)
+
+PAGE_SIZE = os.sysconf("SC_PAGE_SIZE")
+
+
+def process_tree(pid: int) -> List[int]:
+    """Return the given process and all of its live descendants."""
+    pids = [pid]
+    idx = 0
+    while idx < len(pids):
+        task_dir = Path(f"/proc/{pids[idx]}/task")
+        idx += 1
+        try:
+            for task in task_dir.iterdir():
+                children = (task / "children").read_text().split()
+                pids.extend([int(c) for c in children])
+        except OSError:
+            # process exited meanwhile
+            continue
+    return pids
+
+
+def tree_rss(pid: int) -> int:
+    """Return the resident set size in Bytes summed over a process tree."""
+    rss = 0
+    for p in process_tree(pid):
+        try:
+            with open(f"/proc/{p}/statm", "r") as statm:
+                rss += int(statm.read().split()[1]) * PAGE_SIZE
+        except (OSError, IndexError, ValueError):
+            continue
+    return rss
+
+
+def children_max_rss() -> int:
+    """Return the largest resident set size in Bytes of any waited for child."""
+    return resource.getrusage(resource.RUSAGE_CHILDREN).ru_maxrss * 1024
+
+
+class PeakRSSSampler:
+    """
+    Samples the resident set size of the current process tree on a background
+    thread while active and keeps the peak. Short lived processes peaking
+    between two samples are accounted for by the maximum resident set size
+    the kernel records for terminated children.
+    """
+
+    def __init__(self, interval: float = 0.1):
+        self.interval = interval
+        self.peak = 0
+
+        self.stopped = threading.Event()
+        self.thread: Optional[threading.Thread] = None
+        self.children_max_rss = 0
+
+    def __enter__(self) -> "PeakRSSSampler":
+        self.peak = 0
+        self.children_max_rss = children_max_rss()
+        self.stopped.clear()
+        self.thread = threading.Thread(target=self.run, daemon=True)
+        self.thread.start()
+        return self
+
+    def __exit__(self, exc_type, exc_value, traceback):
+        self.stopped.set()
+        self.thread.join()
+        self.thread = None
+
+        # the recorded maximum is monotonic, it only tells about this task if it grew
+        max_rss = children_max_rss()
+        if max_rss > self.children_max_rss:
+            self.peak = max(self.peak, max_rss)
+
+    def run(self):
+        pid = os.getpid()
+        while True:
+            self.peak = max(self.peak, tree_rss(pid))
+            if self.stopped.wait(self.interval):
+                break
+
+
+class MemoryAdmission:
+    """
+    Decides how many path tasks may run concurrently within a memory budget.
+
+    Every task is projected to need the peak resident set size measured for
+    previous tasks of the same function, or the largest peak of recently
+    finished tasks if the function was not evaluated before. Until the first
+    task finished, the budget is split evenly among the maximum number of
+    concurrent tasks. A new task is admitted if the projections of all running
+    tasks and the new one fit into the budget and the system has enough memory
+    available. At least one task is always admitted to guarantee progress.
+    """
+
+    RECENT_PEAKS = 32
+    HEADROOM = 1.25
+
+    def __init__(self, budget: int, max_active: int):
+        self.budget = budget
+        self.max_active = max_active
+
+        self.recent_peaks: Deque[int] = deque(maxlen=self.RECENT_PEAKS)
+        # (module_name, function_name) -> largest measured peak
+        self.function_peaks: Dict[Tuple[str, str], int] = dict()
+        # projections of admitted tasks which did not finish yet
+        self.active: List[int] = []
+
+    def estimate(self, m_name: str, fn_name: str) -> int:
+        """Return projected peak resident set size in Bytes of a task."""
+        peak = self.function_peaks.get((m_name, fn_name))
+        if peak is None and len(self.recent_peaks) > 0:
+            peak = max(self.recent_peaks)
+        if peak is None:
+            return self.budget // self.max_active
+        return int(peak * self.HEADROOM)
+
+    def committed(self) -> int:
+        return sum(self.active)
+
+    def try_admit(
+        self, m_name: str, fn_name: str, available: Optional[int] = None
+    ) -> Optional[int]:
+        """
+        Admit a task of the given function if it is projected to fit and return
+        its projection, which has to be released again once the task finished.
+        available: memory in Bytes currently available on the system
+        """
+        estimate = self.estimate(m_name, fn_name)
+        if len(self.active) > 0:
+            if len(self.active) >= self.max_active:
+                return None
+            if self.committed() + estimate > self.budget:
+                return None
+            if available is not None and estimate > available:
+                return None
+
+        self.active.append(estimate)
+        return estimate
+
+    def finished(
+        self, m_name: str, fn_name: str, projection: int, peak_rss: Optional[int]
+    ):
+        """Release projection of a finished task and record its measured peak."""
+        self.active.remove(projection)
+
+        if peak_rss is None or peak_rss <= 0:
+            return
+
+        self.recent_peaks.append(peak_rss)
+        key = (m_name, fn_name)
+        self.function_peaks[key] = max(self.function_peaks.get(key, 0), peak_rss)
@@ -0,0 +1,182 @@
+# Copyright (c) 2021, Björn Franke
+#
+# This source code is licensed under the MIT license found in the
+# LICENSE file in the root directory of this source tree.
+
+"""On-line ranking of evaluation targets by their chance of an improvement"""
+
+import logging
+import math
+from typing import Dict, Iterable, List, Optional, Tuple
+
+import augmentum.paths as a2p
+from augmentum.function import Function, Module
+
+logger = logging.getLogger(__name__)
+
+# target value of a path with a working prior but no objective improvement
+PRIOR_SUCCESS_LABEL = 0.5
+
+
+def path_steps(p_name: str) -> Tuple[List[str], str]:
+    """Split a path string, e.g. A0.D.S1.T-i32, into its steps and leaf type."""
+    tokens = p_name.split(".")
+    for i, t in enumerate(tokens):
+        if t.startswith("T-"):
+            # named struct types may contain dots themselves
+            return tokens[:i], ".".join(tokens[i:])[2:]
+    return tokens, ""
+
+
+def leaf_kind(leaf: str) -> str:
+    if leaf.endswith("*"):
+        return "ptr"
+    if leaf.startswith("i") and leaf[1:].isdigit():
+        return "int"
+    if leaf.startswith("f") and leaf[1:].isdigit():
+        return "float"
+    return "other"
+
+
+def path_features(fn: Function, p_name: str) -> Dict[str, float]:
+    """
+    Sparse features of a function path. They describe the function through its
+    instruction count and signature and the path through its shape, i.e. the
+    kind of each step from the function boundary down to the leaf type.
+    """
+    steps, leaf = path_steps(p_name)
+    kinds = [s[0] for s in steps]
+
+    features = {"bias": 1.0}
+
+    try:
+        icount = int(fn.function_stats.instruction_count)
+    except (AttributeError, TypeError, ValueError):
+        icount = None
+    if icount is not None:
+        features["icount"] = math.log2(1 + icount) / 16
+        features[f"icount:{min(icount.bit_length(), 16)}"] = 1.0
+
+    arg_count = len(fn.type.arg_types)
+    features["pcount"] = min(arg_count, 8) / 8
+    features[f"pcount:{min(arg_count, 8)}"] = 1.0
+    features[f"ret:{leaf_kind(str(fn.type.return_type))}"] = 1.0
+
+    if len(steps) > 0:
+        features[f"root:{steps[0] if kinds[0] == 'A' else kinds[0]}"] = 1.0
+    features["depth"] = min(len(steps), 8) / 8
+    features[f"shape:{'.'.join(kinds)}"] = 1.0
+    for k in set(kinds[1:]):
+        features[f"step:{k}"] = 1.0
+
+    features[f"leaf:{leaf}"] = 1.0
+    features[f"leafkind:{leaf_kind(leaf)}"] = 1.0
+    features[f"root_leaf:{kinds[0] if len(kinds) > 0 else ''}:{leaf}"] = 1.0
+    return features
+
+
+class OnlineLogisticModel:
+    """
+    Logistic regression over sparse features trained by stochastic gradient
+    descent with per-feature AdaGrad step sizes, so that rare features still
+    learn quickly while frequent ones settle.
+    """
+
+    def __init__(self, learning_rate: float = 0.5, l2: float = 1e-4):
+        self.learning_rate = learning_rate
+        self.l2 = l2
+        self.weights: Dict[str, float] = dict()
+        self.grad_sq: Dict[str, float] = dict()
+
+    def predict(self, features: Dict[str, float]) -> float:
+        z = sum(self.weights.get(f, 0.0) * v for f, v in features.items())
+        z = max(-30.0, min(30.0, z))
+        return 1.0 / (1.0 + math.exp(-z))
+
+    def update(self, features: Dict[str, float], label: float):
+        error = self.predict(features) - label
+        for f, v in features.items():
+            w = self.weights.get(f, 0.0)
+            g = error * v + self.l2 * w
+            g_sq = self.grad_sq.get(f, 0.0) + g * g
+            self.grad_sq[f] = g_sq
+            self.weights[f] = w - self.learning_rate * g / (math.sqrt(g_sq) + 1e-8)
+
+
+class PathRanker:
+    """
+    Orders pending evaluation targets so that paths most likely to yield a
+    working prior or an objective improvement are dispatched first. The model
+    is bootstrapped from paths already in the heuristic database and updated
+    with the result of every finished task. Ranking only changes the order in
+    which paths are evaluated, every path is still evaluated eventually.
+    """
+
+    def __init__(self):
+        self.model = OnlineLogisticModel()
+        self.observed = 0
+        self.promising = 0
+
+    def score(self, fn: Function, p_name: str) -> float:
+        return self.model.predict(path_features(fn, p_name))
+
+    def learn(self, fn: Function, p_name: str, label: float):
+        self.model.update(path_features(fn, p_name), label)
+        self.observed += 1
+        if label > 0:
+            self.promising += 1
+
+    def learn_result(
+        self,
+        fn: Function,
+        p_name: str,
+        prior_success: Optional[bool],
+        obj_improvement: bool,
+    ):
+        """Learn from a path result, paths without tests carry no information."""
+        if prior_success is None:
+            return
+        if obj_improvement:
+            label = 1.0
+        elif prior_success:
+            label = PRIOR_SUCCESS_LABEL
+        else:
+            label = 0.0
+        self.learn(fn, p_name, label)
+
+    def bootstrap(
+        self,
+        modules: Dict[str, Module],
+        results: Iterable[Tuple[str, str, str, str, bool]],
+    ):
+        """Train on path heuristic rows of the database for known functions."""
+        for m_name, fn_name, p_name, prior_success, obj_improvement in results:
+            if m_name not in modules or fn_name not in modules[m_name].functions:
+                continue
+            self.learn_result(
+                modules[m_name].functions[fn_name],
+                p_name,
+                str(prior_success) in ("1", "True", "true"),
+                bool(obj_improvement),
+            )
+        logger.info(
+            f"Path ranking trained on {self.observed} evaluated paths, "
+            f"{self.promising} of them promising."
+        )
+
+    def rank(
+        self,
+        modules: Dict[str, Module],
+        evaluation_targets: Dict[str, Dict[str, Dict[str, a2p.Path]]],
+    ) -> List[Tuple[str, str, a2p.Path]]:
+        """Return all pending targets, most promising first."""
+        scored = []
+        for m_name, fns in evaluation_targets.items():
+            for fn_name, paths in fns.items():
+                fn = modules[m_name].functions[fn_name]
+                for p_name, path in paths.items():
+                    scored.append((self.score(fn, p_name), m_name, fn_name, path))
+
+        # stable sort keeps the original order among equally scored paths
+        scored.sort(key=lambda s: s[0], reverse=True)
+        return [(m_name, fn_name, path) for _, m_name, fn_name, path in scored]
@@ -4,8 +4,9 @@
 # LICENSE file in the root directory of this source tree.
 
 from enum import Enum
+from typing import Tuple
 
-from augmentum.type_descs import TypeDesc
+from augmentum.type_descs import IntTypeDesc, TypeDesc
 
 
 class Path:
@@ -93,3 +94,70 @@ class PathContext(Enum):
     RESULT = (1,)
     ARG = (2,)
     DEREFFED = 3
+
+
+# Compact path encoding: a path is a tuple of integer steps from a root type
+# down to a leaf type. Each step stores its kind in the lowest bits and
+# an optional index (argument or struct element) in the remaining bits.
+STEP_BITS = 3
+STEP_MASK = (1 << STEP_BITS) - 1
+
+STEP_RESULT = 0
+STEP_ARG = 1
+STEP_STRUCT_ELEM = 2
+STEP_SPLIT_LEFT = 3
+STEP_SPLIT_RIGHT = 4
+STEP_DEREF = 5
+
+PathCode = Tuple[int, ...]
+
+
+def make_step(kind: int, i: int = 0) -> int:
+    return (i << STEP_BITS) | kind
+
+
+def step_kind(step: int) -> int:
+    return step & STEP_MASK
+
+
+def step_index(step: int) -> int:
+    return step >> STEP_BITS
+
+
+def decode_path(root: TypeDesc, code: PathCode) -> Path:
+    """Build the path object for a path code relative to the given root type."""
+    # walk down the type graph to find the leaf type
+    t = root
+    for step in code:
+        kind = step_kind(step)
+        if kind == STEP_RESULT:
+            t = t.return_type
+        elif kind == STEP_ARG:
+            t = t.arg_types[step_index(step)]
+        elif kind == STEP_STRUCT_ELEM:
+            t = t.elem_types[step_index(step)]
+        elif kind == STEP_SPLIT_LEFT or kind == STEP_SPLIT_RIGHT:
+            t = IntTypeDesc(t.bits // 2)
+        elif kind == STEP_DEREF:
+            t = t.pointee
+        else:
+            raise ValueError(f"Unknown path step {step}")
+
+    # wrap leaf in reverse order of steps
+    path: Path = LeafPath(t)
+    for step in reversed(code):
+        kind = step_kind(step)
+        if kind == STEP_RESULT:
+            path = ResultPath(path)
+        elif kind == STEP_ARG:
+            path = ArgumentPath(step_index(step), path)
+        elif kind == STEP_STRUCT_ELEM:
+            path = StructElementPath(step_index(step), path)
+        elif kind == STEP_SPLIT_LEFT:
+            path = SplitIntLeftPath(path)
+        elif kind == STEP_SPLIT_RIGHT:
+            path = SplitIntRightPath(path)
+        else:
+            path = DerefPath(path)
+
+    return path
@@ -5,11 +5,14 @@
 
 import logging
 import shutil
+from contextlib import contextmanager
 from dataclasses import dataclass
-from typing import Dict, Optional, Set, Union
+from pathlib import Path
+from typing import Dict, Iterator, Optional, Set, Tuple, Union
 
 import augmentum.paths as a2p
 from augmentum.function import Function
+from augmentum.memmonitor import PeakRSSSampler
 from augmentum.priors import Prior, build_priors
 from augmentum.probes import NullProbe
 from augmentum.sysUtils import try_create_dir
@@ -33,6 +36,10 @@ class Task:
         self.path = p
         self.fn_test_cases = set()
 
+        # projected and measured peak resident set size in Bytes
+        self.mem_projection: Optional[int] = None
+        self.peak_rss: Optional[int] = None
+
         self.result: Optional[Union[WorkerResult, Dict[str, WorkerResult]]] = None
 
     def set_test_cases(self, selected_tests: Dict[str, Dict[str, Set[str]]]):
@@ -69,17 +76,33 @@ class PathWorker(QueueProcWorker):
             self.mem_limit,
             self.skip_immutables,
             self.independent_test_cases,
+            self.checkpoints,
+            self.scratch,
         ) = args
 
         # skip_immutables: skip paths that are not modified by the original code when executing null priors
         # independent_test_cases: if true, individual test cases are evaluated independently of each other
         #                         with a prior model for each
+        # checkpoints: if set, prior models are saved after each probe round and resumed from there
+        # scratch: if set, probes and benchmark copies are placed in this scratch space
 
     def startup(self):
         logger.info(f"Path Worker started {self.name}")
-        self.test_cases: Dict[
-            str, TestCase
-        ] = self.benchmark_factory.setup_benchmark_instance(self.working_dir)
+        benchmark_dir = self.working_dir
+        if self.scratch is not None:
+            logger.info(f"Using scratch space at {self.scratch.root}")
+            self.scratch.setup()
+            benchmark_dir = self.scratch.benchmark_dir
+
+        # scratch space is scarce and its copies are private to this worker, so
+        # read-only files are hardlinked there
+        self.test_cases: Dict[str, TestCase] = (
+            self.benchmark_factory.setup_benchmark_instance(
+                benchmark_dir, hardlink=self.scratch is not None
+            )
+        )
+        if self.scratch is not None:
+            self.scratch.add_benchmark_copies()
 
         if self.mem_limit is not None:
             logger.info(
@@ -89,6 +112,12 @@ class PathWorker(QueueProcWorker):
     def shutdown(self):
         logger.info(f"Path Worker shutting down {self.name}")
 
+        for test_case in self.test_cases.values():
+            test_case.close()
+
+        if self.scratch is not None:
+            self.scratch.close()
+
         # clean up working dir
         if self.working_dir.exists() and not self.keep_probes:
             try:
@@ -104,45 +133,78 @@ class PathWorker(QueueProcWorker):
             self.event_q.put(EventMessage(self.name, "PATH_DONE", task))
             return
 
-        if self.independent_test_cases:
-            logger.info(
-                f"Evaluating {len(task.fn_test_cases)} test cases individually ..."
-            )
-
-            worker_results: Dict[str, WorkerResult] = dict()
-            for tc_id, tc_name in enumerate(task.fn_test_cases):
+        with PeakRSSSampler() as sampler:
+            if self.independent_test_cases:
                 logger.info(
-                    f"Evaluating test case {tc_name} {tc_id + 1} / {len(task.fn_test_cases)} ..."
+                    f"Evaluating {len(task.fn_test_cases)} test cases individually ..."
                 )
-                worker_results[tc_name] = self.evaluate_prior_model_for_tests(
-                    task, {tc_name}
+
+                worker_results: Dict[str, WorkerResult] = dict()
+                for tc_id, tc_name in enumerate(task.fn_test_cases):
+                    logger.info(
+                        f"Evaluating test case {tc_name} {tc_id + 1} / {len(task.fn_test_cases)} ..."
+                    )
+                    worker_results[tc_name] = self.evaluate_prior_model_for_tests(
+                        task, {tc_name}
+                    )
+                task.set_result(worker_results)
+
+            else:
+                logger.info(
+                    f"Evaluating {len(task.fn_test_cases)} test cases together ..."
                 )
-            task.set_result(worker_results)
+                wres = self.evaluate_prior_model_for_tests(task, task.fn_test_cases)
+                task.set_result(wres)
 
-        else:
-            logger.info(f"Evaluating {len(task.fn_test_cases)} test cases together ...")
-            wres = self.evaluate_prior_model_for_tests(task, task.fn_test_cases)
-            task.set_result(wres)
+        task.peak_rss = sampler.peak
+        logger.info(f"Peak memory of task {round(task.peak_rss / (1024 * 1024), 2)} MB")
 
         self.event_q.put(EventMessage(self.name, "PATH_DONE", task))
 
+    @contextmanager
+    def probe_dir(self) -> Iterator[Path]:
+        """
+        Provide the working directory of the next probe. Directories from the
+        scratch space are recycled by it, others are removed by the bound probe.
+        """
+        if self.scratch is not None:
+            with self.scratch.probe_dir(self.keep_probes) as probe_wd:
+                yield probe_wd
+            return
+
+        probe_wd = try_create_dir(self.working_dir / "probe_out", use_time=True)
+        if not probe_wd:
+            raise RuntimeError(
+                f"Creating probe working directory failed for {probe_wd}."
+            )
+        yield probe_wd
+
     def evaluate_prior_model_for_tests(
         self, task: Task, fn_test_cases: Set[str]
     ) -> WorkerResult:
-        # create a prior model based on a selected path
-        prior_model = build_priors(task.function, task.path, self.skip_immutables)
-        obj_improvement = False
+        checkpoint_key = (task.function.module, task.function.name, str(task.path))
+        restored: Optional[Tuple[Prior, bool]] = None
+        if self.checkpoints is not None:
+            restored = self.checkpoints.load(*checkpoint_key, fn_test_cases)
+
+        if restored is not None:
+            prior_model, obj_improvement = restored
+            logger.info(
+                f"Resuming prior model from checkpoint after "
+                f"{len(prior_model.get_probe_log())} probe results."
+            )
+        else:
+            # create a prior model based on a selected path
+            prior_model = build_priors(task.function, task.path, self.skip_immutables)
+            obj_improvement = False
+
         while not prior_model.is_done():
             probe = prior_model.select_next_probe()
 
-            probe_wd = try_create_dir(self.working_dir / "probe_out", use_time=True)
-            if not probe_wd:
-                raise RuntimeError(
-                    f"Creating probe working directory failed for {probe_wd}."
-                )
-
             # extension library is generated depending on the type of the given probe
-            with self.sys_prog.bind(probe, probe_wd, self.keep_probes) as bound_probe:
+            with self.probe_dir() as probe_wd, self.sys_prog.bind(
+                probe, probe_wd, self.keep_probes or self.scratch is not None
+            ) as bound_probe:
                 for tc_name in fn_test_cases:
                     test_case = self.test_cases[tc_name]
 
@@ -187,4 +249,10 @@ class PathWorker(QueueProcWorker):
 
                     logger.info(f"Probe Result: {probe_result}")
 
+            # save after all tests updated the prior, the next probe depends on them
+            if self.checkpoints is not None:
+                self.checkpoints.save(
+                    *checkpoint_key, fn_test_cases, prior_model, obj_improvement
+                )
+
         return WorkerResult(prior_model, obj_improvement)
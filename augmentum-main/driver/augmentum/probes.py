@@ -8,11 +8,24 @@ from abc import ABC, abstractmethod
 from collections import deque
 from numbers import Number
 from pathlib import Path
-from typing import Dict, Generic, Iterable, Optional, Protocol, Set, Tuple, TypeVar
+from typing import (
+    Dict,
+    Generic,
+    Iterable,
+    List,
+    Optional,
+    Protocol,
+    Sequence,
+    Set,
+    Tuple,
+    TypeVar,
+)
 
 import augmentum.paths
 from augmentum.function import Function
 from augmentum.paths import ResultPath
+from augmentum.sharedcounters import shared_counter_name
+from augmentum.telemetry import telemetry_name
 from augmentum.type_descs import (
     ArrayTypeDesc,
     FunctionTypeDesc,
@@ -32,6 +45,13 @@ STRUCT_NAME_REX = r"^(?P<kind>class|struct|union)\.(?P<type>.+)"
 
 PROBE_LOG_DELIMITER = ";"
 
+# module name of extension points shared by all copies of an ODR function,
+# see coalesced_module_name in augmentum_llvmpass.cpp
+COALESCED_MODULE_NAME = "<linkonce_odr>"
+
+# common includes of all generated extensions, see augmentum_probe.h
+PROBE_PREFIX_HEADER = "augmentum_probe.h"
+
 T = TypeVar("T")
 
 
@@ -59,7 +79,8 @@ def generate_register_extension_point(
     mod_identifier: str,
 ) -> str:
     return f"""
-        if (pt.get_module_name() == "{sys_prog_src}/{mod_name}" &&
+        if ((pt.get_module_name() == "{sys_prog_src}/{mod_name}" ||
+             pt.get_module_name() == "{COALESCED_MODULE_NAME}") &&
             pt.get_name() == "{fn_name}") {{
             if (pt.is_replaced()) {{
                 throw std::runtime_error("Attempt to register more than one extension point.");
@@ -118,30 +139,14 @@ def fill_extension_template(
     modified_fn: str,
 ) -> str:
     return f"""
-#include <cstdint>
-#include <stdexcept>
-#include <filesystem>
-#include <fstream>
-#include <mutex>
-#include <unordered_map>
-#include "augmentum.h"
+#include "{PROBE_PREFIX_HEADER}"
 
 using namespace augmentum;
 
 {forward_decl}
 
-template <typename A, typename B>
-struct std::hash<std::pair<A,B>> {{
-    size_t operator()(const std::pair<A,B>& p) const {{
-        size_t h1 = std::hash<A>()(p.first);
-        size_t h2 = std::hash<B>()(p.second);
-        return h1 ^ (h2 << 1);
-    }}
-}};
-
-// remember which functions you have seen already
-std::unordered_map<std::pair<{probe_type},{probe_type}>,size_t> cache;
-std::mutex log_mutex;  // protects cache and disc write
+// counts original and probed value pairs, per thread and without locking
+ValueCounter<{probe_type}> value_counts;
 
 void write_probe_log({probe_type} original_value, {probe_type} probed, size_t freq) {{
     std::filesystem::path outputFile = "{log_file}";
@@ -155,12 +160,7 @@ void write_probe_log({probe_type} original_value, {probe_type} probed, size_t fr
 }}
 
 void log_entry({probe_type} original_value, {probe_type} probed) {{
-    const std::lock_guard<std::mutex> lock(log_mutex);
-    auto p = std::make_pair(original_value, probed);
-    if (cache.find(p) == cache.end()) {{
-        cache[p] = 0;
-    }}
-    cache[p] += 1;
+    value_counts.record(original_value, probed);
 }}
 
 {modified_fn}
@@ -174,15 +174,20 @@ struct ProbeListener: Listener {{
         if (pt.is_replaced()) {{
             pt.reset();
 
-            // whenever an extension point is unregistered, empty cache to file
-            const std::lock_guard<std::mutex> lock(log_mutex);
-            if (cache.size() > 0) {{
-                for (auto&[k,v] : cache) {{
-                    write_probe_log(k.first, k.second, v);
+            // whenever an extension point is unregistered, empty counts to the shared
+            // counter region of the driver while it has room left, stream them to its
+            // telemetry collector or write them to file otherwise
+            std::unique_ptr<SharedCounterRegion> region = SharedCounterRegion::attach("{shared_counter_name(Path(log_file))}");
+            std::unique_ptr<TelemetryChannel> channel = TelemetryChannel::connect("{telemetry_name(Path(log_file))}");
+            value_counts.drain([&region, &channel]({probe_type} original_value, {probe_type} probed, size_t freq) {{
+                if (region && region->add(0, original_value, probed, freq)) {{
+                    return;
                 }}
-                cache.clear();
-            }}
-
+                if (channel && channel->value_count(0, original_value, probed, freq)) {{
+                    return;
+                }}
+                write_probe_log(original_value, probed, freq);
+            }});
         }}
     }}
 }};
@@ -513,15 +518,17 @@ def generate_path_code(
     return path_code, path_type, null_check_id
 
 
-def generate_extension_code(
-    log_file: Path,
-    sys_prog_src: Path,
+def generate_probe_target(
     function: Function,
     path: Path,
     generate_body: GenerateBodyCall,
     value_op: Optional[str] = None,
     path_code_id: str = "probed",
-) -> str:
+) -> Tuple[str, str]:
+    """
+    Generate the modified function probing the given path and return it
+    together with the type its values are counted as.
+    """
     path_code, probed_type, null_check_id = generate_path_code(
         path, function, path_code_id
     )
@@ -537,14 +544,33 @@ def generate_extension_code(
         value_op,
     )
 
+    counted_type = (
+        probed_type.get_cpp_type().get_type_string()
+        if isinstance(probed_type, RealTypeDesc)
+        else "int64_t"
+    )
+    return modified_function, counted_type
+
+
+def generate_extension_code(
+    log_file: Path,
+    sys_prog_src: Path,
+    function: Function,
+    path: Path,
+    generate_body: GenerateBodyCall,
+    value_op: Optional[str] = None,
+    path_code_id: str = "probed",
+) -> str:
+    modified_function, counted_type = generate_probe_target(
+        function, path, generate_body, value_op, path_code_id
+    )
+
     extension_code = fill_extension_template(
         function.module,
         function.name,
         str(log_file),
         str(sys_prog_src),
-        probed_type.get_cpp_type().get_type_string()
-        if isinstance(probed_type, RealTypeDesc)
-        else "int64_t",
+        counted_type,
         get_struct_definitions_from_fntype(function.type),
         modified_function,
     )
@@ -552,6 +578,140 @@ def generate_extension_code(
     return extension_code
 
 
+def generate_combined_extension_code(
+    log_file: Path, sys_prog_src: Path, probes: Sequence["PriorProbe"]
+) -> str:
+    """
+    Generate a single extension applying all given probes.
+    The code of each probe lives in its own namespace and its values are
+    counted with its index in the list of probes. A single listener finds the
+    probes of an extension point by module and function, probes of the same
+    function are chained in list order.
+    """
+    target_code = []
+    targets: Dict[Tuple[str, str], List[str]] = dict()
+    for i, probe in enumerate(probes):
+        modified_function, counted_type = generate_probe_target(
+            probe.function,
+            probe.path,
+            probe.get_extension_body,
+            probe.value_op(),
+            probe.path_code_id(),
+        )
+        target_code.append(f"""
+namespace target_{i} {{
+{get_struct_definitions_from_fntype(probe.function.type)}
+
+ValueCounter<{counted_type}> value_counts;
+
+void log_entry({counted_type} original_value, {counted_type} probed) {{
+    value_counts.record(original_value, probed);
+}}
+
+{modified_function}
+
+void drain(SharedCounterRegion* region, TelemetryChannel* channel) {{
+    value_counts.drain([region, channel]({counted_type} original_value, {counted_type} probed, size_t freq) {{
+        if (region && region->add({i}, original_value, probed, freq)) {{
+            return;
+        }}
+        if (channel && channel->value_count({i}, original_value, probed, freq)) {{
+            return;
+        }}
+        write_probe_log({i}, original_value, probed, freq);
+    }});
+}}
+}}
+""")
+
+        key = (f"{sys_prog_src}/{probe.function.module}", probe.function.name)
+        targets.setdefault(key, []).append(
+            f"{{(Fn) &target_{i}::modified_function, "
+            f"[](Fn f) {{ target_{i}::original_function = (target_{i}::original_t) f; }}, "
+            f"&target_{i}::drain}}"
+        )
+
+    target_entries = ",\n".join(
+        f'    {{{{"{m_name}", "{fn_name}"}}, {{{", ".join(entries)}}}}}'
+        for (m_name, fn_name), entries in targets.items()
+    )
+    target_code = "".join(target_code)
+
+    return f"""
+#include "{PROBE_PREFIX_HEADER}"
+
+using namespace augmentum;
+
+template <typename T>
+void write_probe_log(size_t target, T original_value, T probed, size_t freq) {{
+    std::filesystem::path outputFile = "{log_file}";
+    std::ofstream out(outputFile.c_str(), std::ios::out | std::ios::app);
+    if (out.good()) {{
+        out << target << "{PROBE_LOG_DELIMITER}" << original_value << "{PROBE_LOG_DELIMITER}" << probed << "{PROBE_LOG_DELIMITER}" << freq << std::endl;
+    }} else {{
+        throw std::runtime_error("Writing probe log to file failed: " + outputFile.string());
+    }}
+    out.close();
+}}
+{target_code}
+struct ProbeTarget {{
+    Fn modified;
+    void (*set_original)(Fn);
+    void (*drain)(SharedCounterRegion*, TelemetryChannel*);
+}};
+
+// probe targets by module and function name
+const std::unordered_map<std::pair<std::string, std::string>, std::vector<ProbeTarget>> probe_targets = {{
+{target_entries}
+}};
+
+const std::vector<ProbeTarget>* find_probe_targets(const FnExtensionPoint& pt) {{
+    auto it = probe_targets.find({{pt.get_module_name(), pt.get_name()}});
+    if (it == probe_targets.end() && pt.get_module_name() == "{COALESCED_MODULE_NAME}") {{
+        it = std::find_if(probe_targets.begin(), probe_targets.end(),
+                          [&pt](const auto& entry) {{ return entry.first.second == pt.get_name(); }});
+    }}
+    return it != probe_targets.end() ? &it->second : nullptr;
+}}
+
+struct ProbeListener: Listener {{
+    void on_extension_point_register(FnExtensionPoint& pt) {{
+        const std::vector<ProbeTarget>* targets = find_probe_targets(pt);
+        if (targets == nullptr) {{
+            return;
+        }}
+        if (pt.is_replaced()) {{
+            throw std::runtime_error("Attempt to register more than one extension point.");
+        }}
+
+        // each target calls the one before it, the first calls the original
+        Fn current = pt.original_direct();
+        for (const ProbeTarget& target : *targets) {{
+            target.set_original(current);
+            current = target.modified;
+        }}
+        pt.replace(current);
+    }}
+
+    void on_extension_point_unregister(FnExtensionPoint& pt) {{
+        const std::vector<ProbeTarget>* targets = find_probe_targets(pt);
+        if (targets == nullptr || !pt.is_replaced()) {{
+            return;
+        }}
+        pt.reset();
+
+        // empty counts the same way as single probe extensions do
+        std::unique_ptr<SharedCounterRegion> region = SharedCounterRegion::attach("{shared_counter_name(Path(log_file))}");
+        std::unique_ptr<TelemetryChannel> channel = TelemetryChannel::connect("{telemetry_name(Path(log_file))}");
+        for (const ProbeTarget& target : *targets) {{
+            target.drain(region.get(), channel.get());
+        }}
+    }}
+}};
+ListenerLifeCycle<ProbeListener> probeListener;
+"""
+
+
 class ProbeBase(ABC):
     @abstractmethod
     def extension_code(self, log_file: Path, sys_prog_src: Optional[Path]) -> str:
@@ -564,6 +724,20 @@ class ProbeBase(ABC):
         """Description for this probe"""
         raise NotImplementedError
 
+    def counts_values(self) -> bool:
+        """
+        Check if the extension counts probed values and attaches to the shared
+        counter region of its log file if one exists.
+        """
+        return False
+
+    def log_target_index(self) -> bool:
+        """
+        Check if log entries of the extension start with the index of the
+        probe target they were recorded for.
+        """
+        return False
+
 
 class BaselineProbe(ProbeBase):
     """
@@ -593,21 +767,18 @@ class TracerProbe(ProbeBase):
 
     def extension_code(self, log_file: Path, sys_prog_src: Optional[Path]) -> str:
         return f"""
-#include <functional>
-#include <iostream>
-#include <stdexcept>
-#include <filesystem>
-#include <fstream>
-
-#include <unordered_set>
-#include <mutex>
-#include <string>
-
-#include "augmentum.h"
+#include "{PROBE_PREFIX_HEADER}"
 
 using namespace augmentum;
 
+// streams executed functions to the telemetry collector of the driver if there is one
+std::unique_ptr<TelemetryChannel> telemetry = TelemetryChannel::connect("{telemetry_name(log_file)}");
+
 void write_probe_log(std::string mname, std::string fname) {{
+    if (telemetry && telemetry->trace(mname, fname)) {{
+        return;
+    }}
+
     std::filesystem::path outputFile = "{str(log_file)}";
     std::ofstream out(outputFile.c_str(), std::ios::out | std::ios::app);
     if (out.good()) {{
@@ -667,6 +838,44 @@ class PriorProbe(ProbeBase, ABC):
         """Return probe value if any"""
         return None
 
+    def counts_values(self) -> bool:
+        return True
+
+    @abstractmethod
+    def get_extension_body(
+        self,
+        return_type: str,
+        arg_vals: str,
+        path_code: str,
+        probed_type: str,
+        null_check_id: Optional[str],
+        value_op: Optional[str] = None,
+    ) -> str:
+        """Return the body of the modified function."""
+
+    def value_op(self) -> Optional[str]:
+        """Operator combining the original value with the probe value, if any."""
+        return None
+
+    def path_code_id(self) -> str:
+        """Identifier of the probed value in the generated path code."""
+        return "probed"
+
+    def extension_code(self, log_file: Path, sys_prog_src: Optional[Path]) -> str:
+        assert (
+            sys_prog_src is not None
+        ), "Given system program source path must not be None."
+
+        return generate_extension_code(
+            log_file,
+            sys_prog_src,
+            self.function,
+            self.path,
+            self.get_extension_body,
+            value_op=self.value_op(),
+            path_code_id=self.path_code_id(),
+        )
+
 
 class NullProbe(PriorProbe):
     # Placeholder for value identifier in a path decoding
@@ -714,19 +923,8 @@ class NullProbe(PriorProbe):
 
         return extension_code
 
-    def extension_code(self, log_file: Path, sys_prog_src: Optional[Path]) -> str:
-        assert (
-            sys_prog_src is not None
-        ), "Given system program source path must not be None."
-
-        return generate_extension_code(
-            log_file,
-            sys_prog_src,
-            self.function,
-            self.path,
-            self.get_extension_body,
-            path_code_id=NullProbe.ID_TMPL,
-        )
+    def path_code_id(self) -> str:
+        return NullProbe.ID_TMPL
 
     def get_description(self) -> str:
         return (
@@ -808,15 +1006,6 @@ class StaticProbe(ParameterProbe):
     def get_value_description(self) -> str:
         return "Static"
 
-    def extension_code(self, log_file: Path, sys_prog_src: Optional[Path]) -> str:
-        assert (
-            sys_prog_src is not None
-        ), "Given system program source path must not be None."
-
-        return generate_extension_code(
-            log_file, sys_prog_src, self.function, self.path, self.get_extension_body
-        )
-
 
 class OffsetProbe(StaticProbe, Generic[T]):
     """Run function and return original value offset by given value for the given path"""
@@ -824,19 +1013,8 @@ class OffsetProbe(StaticProbe, Generic[T]):
     def get_value_description(self) -> str:
         return "Offset"
 
-    def extension_code(self, log_file: Path, sys_prog_src: Optional[Path]) -> str:
-        assert (
-            sys_prog_src is not None
-        ), "Given system program source path must not be None."
-
-        return generate_extension_code(
-            log_file,
-            sys_prog_src,
-            self.function,
-            self.path,
-            self.get_extension_body,
-            value_op="+",
-        )
+    def value_op(self) -> Optional[str]:
+        return "+"
 
 
 class ScaleProbe(StaticProbe, Generic[T]):
@@ -845,16 +1023,47 @@ class ScaleProbe(StaticProbe, Generic[T]):
     def get_value_description(self) -> str:
         return "Scale"
 
+    def value_op(self) -> Optional[str]:
+        return "*"
+
+
+class CombinedProbe(ProbeBase):
+    """
+    Apply several prior probes together in one extension, e.g. to evaluate a
+    combination of tunings with a single build and run instead of one per probe.
+    Log entries start with the index of the probe they were recorded for.
+    """
+
+    def __init__(self, probes: Sequence[PriorProbe]):
+        assert len(probes) > 0, "Combined probe requires at least one probe."
+        self.probes = probes
+
     def extension_code(self, log_file: Path, sys_prog_src: Optional[Path]) -> str:
         assert (
             sys_prog_src is not None
         ), "Given system program source path must not be None."
 
-        return generate_extension_code(
-            log_file,
-            sys_prog_src,
-            self.function,
-            self.path,
-            self.get_extension_body,
-            value_op="*",
+        return generate_combined_extension_code(log_file, sys_prog_src, self.probes)
+
+    def get_description(self) -> str:
+        return "\n\n".join(
+            f"Target {i}: {p.get_description()}" for i, p in enumerate(self.probes)
         )
+
+    def counts_values(self) -> bool:
+        return True
+
+    def log_target_index(self) -> bool:
+        return True
+
+    def split_exec_log(
+        self, exec_log: Iterable[Sequence[str]]
+    ) -> List[List[Sequence[str]]]:
+        """Split an execution log of this probe into the logs of its probes."""
+        logs: List[List[Sequence[str]]] = [[] for _ in self.probes]
+        for entry in exec_log:
+            logs[int(entry[0])].append(entry[1:])
+        return logs
+
+    def __str__(self) -> str:
+        return "Combined Probe of " + ", ".join(str(p) for p in self.probes)
@@ -0,0 +1,234 @@
+# Copyright (c) 2021, Björn Franke
+#
+# This source code is licensed under the MIT license found in the
+# LICENSE file in the root directory of this source tree.
+
+"""Scratch space for probe working directories and benchmark copies"""
+
+import errno
+import fcntl
+import logging
+import os
+import shutil
+import stat
+from contextlib import contextmanager
+from pathlib import Path
+from typing import Dict, Iterator, List, Optional
+
+from augmentum.sysUtils import try_create_dir
+
+logger = logging.getLogger(__name__)
+
+# ioctl request to share the extents of a file (FICLONE in linux/fs.h)
+FICLONE = 0x40049409
+
+
+def _reflink(src: str, dst: str):
+    with open(src, "rb") as fsrc, open(dst, "wb") as fdst:
+        fcntl.ioctl(fdst.fileno(), FICLONE, fsrc.fileno())
+    shutil.copystat(src, dst)
+
+
+class TreeCloner:
+    """
+    Copy function for shutil.copytree which clones files instead of copying
+    their content where the file system allows it. If enabled, read-only files
+    are hardlinked, since neither side can modify their content in place. Their
+    metadata is still shared, e.g. a chmod or touch in the clone reaches the
+    original, so hardlinking is opt-in. It never applies to root, which
+    ignores permissions. Writable files are reflinked so that writes stay
+    private to the clone.
+    Everything else is copied. Once a method fails because the file systems
+    do not support it, it is not tried again.
+    """
+
+    UNSUPPORTED = (errno.EXDEV, errno.EOPNOTSUPP, errno.ENOTTY, errno.EINVAL)
+
+    def __init__(self, hardlink: bool = False, reflink: bool = True):
+        self.hardlink = hardlink and os.geteuid() != 0
+        self.reflink = reflink
+        self.linked = 0
+        self.reflinked = 0
+        self.copied = 0
+
+    def __call__(self, src: str, dst: str) -> str:
+        if self.hardlink and not os.stat(src).st_mode & (
+            stat.S_IWUSR | stat.S_IWGRP | stat.S_IWOTH
+        ):
+            try:
+                os.link(src, dst)
+                self.linked += 1
+                return dst
+            except OSError as e:
+                if e.errno not in self.UNSUPPORTED + (errno.EPERM, errno.EMLINK):
+                    raise
+                self.hardlink = False
+
+        if self.reflink:
+            try:
+                _reflink(src, dst)
+                self.reflinked += 1
+                return dst
+            except OSError as e:
+                if e.errno not in self.UNSUPPORTED:
+                    raise
+                self.reflink = False
+
+        shutil.copy2(src, dst)
+        self.copied += 1
+        return dst
+
+
+def clone_tree(src: Path, dst: Path, hardlink: bool = False):
+    """Clone a directory tree, hardlinking read-only files if set, see TreeCloner."""
+    cloner = TreeCloner(hardlink=hardlink)
+    shutil.copytree(src, dst, symlinks=True, copy_function=cloner)
+    logger.info(
+        f"Cloned {src}: {cloner.linked} hardlinked, "
+        f"{cloner.reflinked} reflinked, {cloner.copied} copied files."
+    )
+
+
+def tree_size(path: Path) -> int:
+    """Return the space in Bytes allocated by all files below path."""
+    size = 0
+    for root, _, files in os.walk(path):
+        for f in files:
+            try:
+                size += os.lstat(os.path.join(root, f)).st_blocks * 512
+            except OSError:
+                continue
+    return size
+
+
+def clear_dir(path: Path):
+    """Remove all contents of a directory but keep the directory itself."""
+    with os.scandir(path) as entries:
+        for entry in entries:
+            if entry.is_dir(follow_symlinks=False):
+                shutil.rmtree(entry.path)
+            else:
+                os.unlink(entry.path)
+
+
+class ScratchSpace:
+    """
+    Working directories of a path worker on a fast scratch file system,
+    usually a tmpfs, to keep file metadata operations of probes off the disk.
+
+    Probe directories are recycled through a small pool instead of being
+    created and removed for every probe. The space taken by each probe is
+    measured when its directory is released. If the projected use of the
+    next probe would exceed the capacity of this scratch space or the free
+    space of the scratch file system, probes fall back to directories in the
+    persistent working directory. Kept probes are moved there as well.
+    The space in use is counted along the way rather than measured by
+    walking the scratch space, which would add the metadata operations it is
+    meant to avoid.
+    """
+
+    POOL_SIZE = 4
+
+    def __init__(
+        self, scratch_dir: Path, persistent_dir: Path, capacity: Optional[int] = None
+    ):
+        self.root = scratch_dir
+        self.persistent_dir = persistent_dir
+        self.capacity = capacity
+
+        self.pool: List[Path] = []
+        self.next_id = 0
+        self.largest_probe = 0
+        self.full = False
+
+        # Bytes taken by benchmark copies and projected for acquired probes
+        self.used = 0
+        # acquired probe directory -> Bytes projected for it
+        self.reserved: Dict[Path, int] = dict()
+
+    def setup(self):
+        self.root.mkdir(parents=True, exist_ok=True)
+
+    def close(self):
+        """Remove the scratch space including all remaining directories."""
+        self.pool.clear()
+        if self.root.exists():
+            shutil.rmtree(self.root, ignore_errors=True)
+
+    @property
+    def benchmark_dir(self) -> Path:
+        return self.root
+
+    def add_benchmark_copies(self):
+        """Account for the benchmark copies made in the benchmark directory."""
+        self.used += tree_size(self.benchmark_dir)
+
+    def has_room(self) -> bool:
+        """Check if the next probe is projected to fit into the scratch space."""
+        projected = self.largest_probe
+        # benchmark copies share the capacity
+        if self.capacity is not None and self.used + projected > self.capacity:
+            return False
+        return shutil.disk_usage(self.root).free > projected
+
+    def acquire(self) -> Path:
+        """Return an empty probe working directory."""
+        if not self.has_room():
+            if not self.full:
+                logger.warning(
+                    f"Scratch space {self.root} is full, "
+                    "creating probe directories in working directory instead."
+                )
+            self.full = True
+            probe_wd = try_create_dir(self.persistent_dir / "probe_out", use_time=True)
+            if not probe_wd:
+                raise RuntimeError(
+                    f"Creating probe working directory failed for {probe_wd}."
+                )
+            return probe_wd
+
+        self.full = False
+        if len(self.pool) > 0:
+            probe_wd = self.pool.pop()
+        else:
+            probe_wd = self.root / f"probe_{self.next_id}"
+            self.next_id += 1
+            probe_wd.mkdir()
+
+        self.reserved[probe_wd] = self.largest_probe
+        self.used += self.largest_probe
+        return probe_wd
+
+    def release(self, probe_wd: Path, keep: bool = False):
+        """Hand a probe directory back, keep its contents if requested."""
+        if probe_wd.parent != self.root:
+            # fallback directory on persistent storage
+            if not keep:
+                shutil.rmtree(probe_wd, ignore_errors=True)
+            return
+
+        # the directory is emptied, moved or removed below
+        self.used -= self.reserved.pop(probe_wd, 0)
+        self.largest_probe = max(self.largest_probe, tree_size(probe_wd))
+
+        if keep:
+            kept = try_create_dir(self.persistent_dir / "probe_out", use_time=True)
+            if kept:
+                kept.rmdir()
+                shutil.move(str(probe_wd), str(kept))
+                return
+            logger.error(f"Keeping probe directory {probe_wd} failed.")
+
+        if len(self.pool) < self.POOL_SIZE:
+            clear_dir(probe_wd)
+            self.pool.append(probe_wd)
+        else:
+            shutil.rmtree(probe_wd, ignore_errors=True)
+
+    @contextmanager
+    def probe_dir(self, keep: bool = False) -> Iterator[Path]:
+        probe_wd = self.acquire()
+        try:
+            yield probe_wd
+        finally:
+            self.release(probe_wd, keep)
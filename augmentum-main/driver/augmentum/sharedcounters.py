@@ -0,0 +1,133 @@
+# Copyright (c) 2021, Björn Franke
+#
+# This source code is licensed under the MIT license found in the
+# LICENSE file in the root directory of this source tree.
+
+"""
+Driver side of the shared counter regions of libaugmentum.
+
+A region is a named shared memory block of atomic counters for pairs of
+probed values. Probe extensions loaded into any number of compiler processes
+add their counts to it directly, so the driver reads a single merged result
+after a build instead of parsing one log per process.
+The layout has to match extensions/augmentum/shared_counters.h.
+"""
+
+import hashlib
+import logging
+import struct
+from multiprocessing import shared_memory
+from pathlib import Path
+from typing import Iterator, Tuple
+
+logger = logging.getLogger(__name__)
+
+MAGIC = 0x31524E5443475541  # "AUGCTNR1"
+VERSION = 1
+
+HEADER = struct.Struct("<4Q32x")  # magic, version, capacity, used
+SLOT = struct.Struct("<6Q")  # state, kind, point, first, second, count
+
+SLOT_READY = 2
+
+KIND_SIGNED = 1
+KIND_UNSIGNED = 2
+KIND_FLOAT = 3
+KIND_DOUBLE = 4
+
+DEFAULT_CAPACITY = 1 << 14
+
+
+def shared_counter_name(log_file: Path) -> str:
+    """
+    Name of the counter region belonging to a probe log. Extensions derive
+    the region to attach to from the log they would write otherwise.
+    """
+    digest = hashlib.sha1(str(log_file).encode("utf-8")).hexdigest()
+    return f"augmentum_{digest[:24]}"
+
+
+def decode_value(kind: int, bits: int) -> str:
+    """Format value bits the way the probe log would print them."""
+    if kind == KIND_SIGNED:
+        return str(struct.unpack("<q", struct.pack("<Q", bits))[0])
+    elif kind == KIND_UNSIGNED:
+        return str(bits)
+    elif kind == KIND_FLOAT:
+        return f"{struct.unpack('<f', struct.pack('<I', bits & 0xFFFFFFFF))[0]:g}"
+    elif kind == KIND_DOUBLE:
+        return f"{struct.unpack('<d', struct.pack('<Q', bits))[0]:g}"
+    raise ValueError(f"Unknown value kind {kind}")
+
+
+class SharedCounterRegion:
+    """
+    Shared counter region owned by the driver. It is created empty and
+    removed again on close.
+    """
+
+    def __init__(self, name: str, capacity: int = DEFAULT_CAPACITY):
+        assert capacity > 0 and capacity & (capacity - 1) == 0
+        self.name = name
+        self.capacity = capacity
+
+        size = HEADER.size + capacity * SLOT.size
+        try:
+            self.shm = shared_memory.SharedMemory(name, create=True, size=size)
+        except FileExistsError:
+            # left behind by an earlier run that did not terminate cleanly
+            logger.warning(f"Replacing stale shared counter region {name}")
+            stale = shared_memory.SharedMemory(name)
+            stale.close()
+            stale.unlink()
+            self.shm = shared_memory.SharedMemory(name, create=True, size=size)
+
+        HEADER.pack_into(self.shm.buf, 0, MAGIC, VERSION, capacity, 0)
+
+    def __enter__(self) -> "SharedCounterRegion":
+        return self
+
+    def __exit__(self, exc_type, exc_value, traceback):
+        self.close()
+
+    def entries(self) -> Iterator[Tuple[int, int, int, int, int]]:
+        """
+        Yield kind, point, first value bits, second value bits and count of all
+        counters. Only meaningful while no writers are attached.
+        """
+        buf = self.shm.buf
+        for i in range(self.capacity):
+            state, kind, point, first, second, count = SLOT.unpack_from(
+                buf, HEADER.size + i * SLOT.size
+            )
+            if state == SLOT_READY and count > 0:
+                yield kind, point, first, second, count
+
+    def log_entries(self, with_point: bool = False) -> Iterator[Tuple[str, ...]]:
+        """
+        Yield all counters in the format of probe log entries, led by the
+        extension point index if with_point is set.
+        """
+        for kind, point, first, second, count in self.entries():
+            entry = (decode_value(kind, first), decode_value(kind, second), str(count))
+            yield (str(point),) + entry if with_point else entry
+
+    def is_full(self) -> bool:
+        """Check if new keys were possibly rejected and written elsewhere."""
+        _, _, _, used = HEADER.unpack_from(self.shm.buf, 0)
+        return used * 4 >= self.capacity * 3
+
+    def reset(self):
+        """Clear all counters."""
+        self.shm.buf[HEADER.size :] = bytes(self.capacity * SLOT.size)
+        HEADER.pack_into(self.shm.buf, 0, MAGIC, VERSION, self.capacity, 0)
+
+    def close(self):
+        if self.shm is None:
+            return
+        self.shm.close()
+        try:
+            self.shm.unlink()
+        except FileNotFoundError:
+            pass
+        self.shm = None
@@ -21,10 +21,13 @@ from augmentum.function import (
     named_struct_stats_id,
 )
 from augmentum.functionfilter import FunctionFilter
+from augmentum.inventory import write_function_inventory
 from augmentum.objectives import ObjectiveMetric
 from augmentum.priors import ProbeResult
-from augmentum.probes import PROBE_LOG_DELIMITER, ProbeBase
+from augmentum.probes import PROBE_LOG_DELIMITER, PROBE_PREFIX_HEADER, ProbeBase
+from augmentum.sharedcounters import SharedCounterRegion, shared_counter_name
 from augmentum.sysUtils import run_command, touch_existing_file
+from augmentum.telemetry import TelemetryCollector, telemetry_name
 from augmentum.timer import Timer
 from augmentum.type_serialisation import DeserialisationContext, TypeDeserialiser
 
@@ -35,16 +38,51 @@ logger = logging.getLogger(__name__)
 
 class ProbeExtension:
     extension_compile_cmd = (
-        "{cxx} -O3 -std=c++17 -fPIC -I{augmentum_inc} -c {extend_path}/{extend_file}.cpp -o {extend_path}/{extend_file}.o && "
+        "{launcher}{cxx} -O3 -std=c++17 -fPIC {pch_flags}-I{augmentum_inc} -c {extend_path}/{extend_file}.cpp -o {extend_path}/{extend_file}.o && "
         "{cxx} -shared -fPIC -laugmentum -L{augmentum_lib} -Wl,-rpath,{augmentum_lib} {extend_path}/{extend_file}.o -o {extend_path}/lib{extend_file}.so"
     )
     extension_lib_target = "{extend_path}/lib{extend_file}.so"
 
+    # compile flags have to match extension_compile_cmd for the header to be usable,
+    # the .gch suffix is picked up by -include for gcc as well as clang
+    precompiled_header_cmd = "cp {augmentum_inc}/{header} {prefix} && {cxx} -O3 -std=c++17 -fPIC -I{augmentum_inc} -x c++-header {prefix} -o {prefix}.gch"
+
     """Extension code needed for a specific probe"""
 
     def __init__(self, code: str):
         self.code = code
 
+    @staticmethod
+    def build_precompiled_header(
+        working_dir: Path, tools: Dict[str, Any]
+    ) -> Optional[Path]:
+        """
+        Precompile the common prefix header of generated extensions into the
+        working directory and register the header as augmentum_pch in the given
+        tools. Extensions include it as prefix header which picks up the
+        precompiled version next to it.
+        Returns None and leaves tools unchanged if precompilation failed.
+        """
+        prefix = working_dir / PROBE_PREFIX_HEADER
+        returncode, stdout = run_command(
+            ProbeExtension.precompiled_header_cmd.format(
+                cxx=tools["cxx"],
+                augmentum_inc=tools["augmentum_headers"],
+                header=PROBE_PREFIX_HEADER,
+                prefix=str(prefix),
+            ),
+            verbose=True,
+        )
+        if returncode != 0:
+            logger.warning(
+                "Precompiling probe extension header failed, "
+                "extensions are compiled without it.\n" + stdout
+            )
+            return None
+
+        tools["augmentum_pch"] = str(prefix)
+        return prefix
+
     def build_library(self, working_dir: Path, tools: Dict[str, Any]) -> Path:
         """Compile the extension code into a dynamic library and return corresponding path"""
 
@@ -55,9 +93,15 @@ class ProbeExtension:
         with open(src_file, "w") as f:
             f.write(self.code)
 
+        # optional launcher to compile through a persistent compile server, e.g. sccache
+        launcher = tools.get("compiler_launcher")
+        pch = tools.get("augmentum_pch")
+
         returncode, stdout = run_command(
             ProbeExtension.extension_compile_cmd.format(
+                launcher=f"{launcher} " if launcher else "",
                 cxx=tools["cxx"],
+                pch_flags=f"-include {pch} " if pch else "",
                 augmentum_inc=tools["augmentum_headers"],
                 augmentum_lib=tools["augmentum_library"],
                 extend_path=str(src_file.parent),
@@ -104,6 +148,18 @@ class BoundProbe:
         self.wd_path = working_dir
         self.log_file = self.wd_path / "probe.log"
 
+        # counts of all compiler processes are merged in shared memory if enabled
+        self.counter_region: Optional[SharedCounterRegion] = None
+        if build_extension and tools.get("shared_counters") and probe.counts_values():
+            self.counter_region = SharedCounterRegion(
+                shared_counter_name(self.log_file)
+            )
+
+        # extensions stream their log entries to the collector if enabled
+        self.telemetry: Optional[TelemetryCollector] = None
+        if build_extension and tools.get("telemetry"):
+            self.telemetry = TelemetryCollector(telemetry_name(self.log_file))
+
         self.write_path_description()
 
         self.extension_lib = self.build_extension() if build_extension else None
@@ -113,6 +169,13 @@ class BoundProbe:
 
     def __exit__(self, exc_type, exc_value, traceback):
         """Clean up probe folder"""
+        if self.counter_region is not None:
+            self.counter_region.close()
+            self.counter_region = None
+        if self.telemetry is not None:
+            self.telemetry.close()
+            self.telemetry = None
+
         if self.wd_path.exists() and not self.keep_probes:
             try:
                 shutil.rmtree(self.wd_path)
@@ -179,9 +242,17 @@ class BoundProbe:
                 result.ext_path = self.extension_lib
 
             self.consume_probe_log(result.exec_log, self.log_file)
+            if self.counter_region is not None:
+                self.consume_counter_region(result.exec_log, self.counter_region)
+            if self.telemetry is not None:
+                self.consume_telemetry(result.exec_log, self.telemetry)
 
         # clean up probe execution log before returning
         self.log_file.unlink(missing_ok=True)
+        if self.counter_region is not None:
+            self.counter_region.reset()
+        if self.telemetry is not None:
+            self.telemetry.take_events()
 
         return result
 
@@ -198,6 +269,31 @@ class BoundProbe:
                         entry = line.strip().split(PROBE_LOG_DELIMITER)
                         exec_log.append(entry)
 
+    def consume_counter_region(
+        self, exec_log: Iterable[Iterable[str]], region: SharedCounterRegion
+    ):
+        """
+        Add the counters merged in the shared counter region to the result entry,
+        in the same format as entries of the probe log. Counters that did not fit
+        into the region have been written to the probe log instead.
+        """
+        if region.is_full():
+            logger.debug(f"Shared counter region {region.name} overflowed to log.")
+        for entry in region.log_entries(self.probe.log_target_index()):
+            exec_log.append(list(entry))
+
+    def consume_telemetry(
+        self, exec_log: Iterable[Iterable[str]], telemetry: TelemetryCollector
+    ):
+        """
+        Add the log entries streamed to the telemetry collector to the result entry.
+        Entries that could not be delivered have been written to the probe log instead.
+        """
+        for event in telemetry.take_events():
+            entry = event.log_entry(self.probe.log_target_index())
+            if entry is not None:
+                exec_log.append(list(entry))
+
 
 class InstrumentationScope(Enum):
     PATH = (
@@ -305,6 +401,23 @@ class SysProg:
 
         return target_fns
 
+    def create_function_inventory(self, inventory_file: Path):
+        """Store all available functions and named structs in an inventory file"""
+
+        with Timer():
+            logger.info(
+                "Creating function inventory from:\n"
+                + str(self.target_function_data_path)
+                + "\n"
+                + str(self.named_structs_path)
+                + " ..."
+            )
+            write_function_inventory(
+                load_target_function_stats(self.target_function_data_path),
+                load_named_structs(self.named_structs_path),
+                inventory_file,
+            )
+
     def deserialise_functions(
         self,
         function_filter: FunctionFilter,
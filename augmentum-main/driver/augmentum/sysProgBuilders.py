@@ -9,7 +9,7 @@ import logging
 import shutil
 from abc import ABC, abstractmethod
 from pathlib import Path
-from typing import Any, Dict, Optional, Set
+from typing import Any, Dict, Optional, Set, Tuple
 
 from augmentum.function import parse_collected_function_stats, use_relative_src_path
 from augmentum.sysUtils import run_command
@@ -25,15 +25,21 @@ class InstrumenterInterface:
 
     delimiter = ";"
     target_fun_header = ["MODULE", "FUNCTION"]
+    target_data_header = ["MODULE", "KIND", "NAME", "VALUE"]
 
-    def __init__(self, comm_file: Path, src_path: Path):
+    def __init__(self, comm_file: Path, src_path: Path, data_file: Path):
         self.__comm_file = comm_file
         self.__src_path = src_path
+        self.__data_file = data_file
 
     @property
     def comm_file(self) -> Path:
         return self.__comm_file
 
+    @property
+    def data_file(self) -> Path:
+        return self.__data_file
+
     def set_extension_pt_targets(self, extension_pts: Dict[str, Set[str]]):
         """Configure extension points to be added during the next instrumentation run"""
 
@@ -50,6 +56,23 @@ class InstrumenterInterface:
         """Remove all extension point targets for the next instrumentation run"""
         self.set_extension_pt_targets(dict())
 
+    def set_data_pt_targets(self, data_pts: Dict[str, Set[Tuple[str, str, str]]]):
+        """
+        Configure data extension points to be added during the next instrumentation
+        run. Targets of a module are given as (kind, name, value), either
+        ("global", symbol, "") for loads of a global or ("constant", function,
+        value) for an immediate compared in the given function.
+        """
+
+        with open(self.data_file, "w") as sOut:
+            data_writer = csv.writer(sOut, delimiter=InstrumenterInterface.delimiter)
+            data_writer.writerow(InstrumenterInterface.target_data_header)
+
+            for module, targets in data_pts.items():
+                absolute_module = self.__src_path / Path(module)
+                for kind, name, value in sorted(targets):
+                    data_writer.writerow([str(absolute_module), kind, name, value])
+
 
 class SysProgBuilder(ABC):
     instr_args_collect_template = (
@@ -59,6 +82,11 @@ class SysProgBuilder(ABC):
 
     instr_args_target_template = "   -mllvm -target-functions={target_functions}"
 
+    instr_args_data_template = "   -mllvm -target-data={target_data}"
+
+    # one extension point for all copies of linkonce_odr and weak_odr functions
+    instr_args_coalesce_odr = "   -mllvm -augmentum-coalesce-odr"
+
     def __init__(
         self,
         tools: Dict[str, Any],
@@ -74,11 +102,12 @@ class SysProgBuilder(ABC):
         self.statistics_p = self.build_path / "statistics"
         self.instrumented_p = self.build_path / "instrumented"
         self.target_functions_p = self.build_path / "target_functions.csv"
+        self.target_data_p = self.build_path / "target_data.csv"
 
         self.instrument_module = ""
 
         self.instr_interface = InstrumenterInterface(
-            self.target_functions_p, self.src_path
+            self.target_functions_p, self.src_path, self.target_data_p
         )
         self.verbose = verbose
 
@@ -138,9 +167,15 @@ class SysProgBuilder(ABC):
         else:
             return None
 
-    def instrument(self, extension_pts: Dict[str, Set[str]]) -> bool:
+    def instrument(
+        self,
+        extension_pts: Dict[str, Set[str]],
+        data_pts: Optional[Dict[str, Set[Tuple[str, str, str]]]] = None,
+    ) -> bool:
         """
         Run instrumentation for the corresponding system program.
+        Optionally, loads of globals and constants are routed through data
+        extension points, see InstrumenterInterface.set_data_pt_targets.
 
         Return True if successful.
         """
@@ -150,6 +185,13 @@ class SysProgBuilder(ABC):
         instr_args = LLVMBuilder.instr_args_target_template.format(
             target_functions=str(self.target_functions_p)
         )
+        if data_pts:
+            self.instr_interface.set_data_pt_targets(data_pts)
+            instr_args += LLVMBuilder.instr_args_data_template.format(
+                target_data=str(self.target_data_p)
+            )
+        if self.tools.get("coalesce_odr"):
+            instr_args += LLVMBuilder.instr_args_coalesce_odr
 
         return self.run_build_cmd(instr_args, clean_up=False)
 
@@ -164,6 +206,7 @@ class SysProgBuilder(ABC):
             shutil.rmtree(str(self.instrumented_p))
 
         self.target_functions_p.unlink(missing_ok=True)
+        self.target_data_p.unlink(missing_ok=True)
 
     def setup(self):
         """
@@ -7,7 +7,12 @@
 
 import csv
 import re
-from typing import Iterable
+from typing import Dict, Iterable, List, Optional, Pattern, Tuple, TypeVar
+
+P = TypeVar("P")
+
+# regex features that break when patterns are combined into a single alternation
+BACKREF_REX = re.compile(r"\\[1-9]|\(\?P=")
 
 
 class FilterEntry:
@@ -38,19 +43,19 @@ class FilterEntry:
         matches = []
         if self.mod is not None:
             if self.use_regex:
-                matches.append(re.fullmatch(self.mod, module))
+                matches.append(self.mod.fullmatch(module) is not None)
             else:
                 matches.append(self.mod == module)
 
         if self.fn is not None:
             if self.use_regex:
-                matches.append(re.fullmatch(self.fn, function))
+                matches.append(self.fn.fullmatch(function) is not None)
             else:
                 matches.append(self.fn == function)
 
         if self.path is not None:
             if self.use_regex:
-                matches.append(re.fullmatch(self.path, path))
+                matches.append(self.path.fullmatch(path) is not None)
             else:
                 matches.append(self.path == path)
 
@@ -66,6 +71,85 @@ class FilterEntry:
         return self.__str__()
 
 
+class FieldMatcher:
+    """
+    Match a single target field (module, function or path) against all entries
+    of a rule list at once.
+
+    The result is a bit mask with bit i set if entry i accepts the given value.
+    Entries without a constraint for the field accept every value, exact values
+    are resolved with a hash lookup and regular expressions are only evaluated
+    individually if their combined alternation matches. Results are memoised
+    per value since modules, functions and paths repeat across targets.
+    """
+
+    def __init__(self, specs: Iterable[Tuple[Optional[object], bool]]):
+        self.wildcard_mask = 0
+        self.exact: Dict[str, int] = dict()
+        self.regexes: List[Tuple[Pattern, int]] = []
+        self.cache: Dict[str, int] = dict()
+
+        for i, (spec, use_regex) in enumerate(specs):
+            bit = 1 << i
+            if spec is None:
+                self.wildcard_mask |= bit
+            elif use_regex:
+                self.regexes.append((spec, bit))
+            else:
+                self.exact[spec] = self.exact.get(spec, 0) | bit
+
+        self.combined = None
+        patterns = [r.pattern for r, _ in self.regexes]
+        if len(patterns) > 1 and not any(BACKREF_REX.search(p) for p in patterns):
+            try:
+                self.combined = re.compile("|".join(f"(?:{p})" for p in patterns))
+            except re.error:
+                # e.g. global inline flags are only valid at the start of a pattern
+                self.combined = None
+
+    def mask(self, value: str) -> int:
+        if value not in self.cache:
+            mask = self.wildcard_mask | self.exact.get(value, 0)
+            if len(self.regexes) != 0 and (
+                self.combined is None or self.combined.fullmatch(value) is not None
+            ):
+                for regex, bit in self.regexes:
+                    if regex.fullmatch(value) is not None:
+                        mask |= bit
+            self.cache[value] = mask
+        return self.cache[value]
+
+
+class CompiledRules:
+    """All entries of a block or allow list compiled into per field matchers."""
+
+    def __init__(self, entries: Iterable[FilterEntry]):
+        entries = list(entries)
+        self.size = len(entries)
+        self.mod = FieldMatcher((e.mod, e.use_regex) for e in entries)
+        self.fn = FieldMatcher((e.fn, e.use_regex) for e in entries)
+        self.path = FieldMatcher((e.path, e.use_regex) for e in entries)
+
+        # entries without any constraint never match
+        self.active_mask = 0
+        for i, e in enumerate(entries):
+            if e.mod is not None or e.fn is not None or e.path is not None:
+                self.active_mask |= 1 << i
+
+    def function_mask(self, module: str, function: str) -> int:
+        """Entries matching the given module and function regardless of the path."""
+        if self.active_mask == 0:
+            return 0
+        return self.active_mask & self.mod.mask(module) & self.fn.mask(function)
+
+    def match_any_path(self, fn_mask: int) -> bool:
+        """True if any of the given entries matches every path."""
+        return (fn_mask & self.path.wildcard_mask) != 0
+
+    def match_path(self, fn_mask: int, path: str) -> bool:
+        return fn_mask != 0 and (fn_mask & self.path.mask(path)) != 0
+
+
 class TargetFilter:
     """Filter evaluation targets according to BLOCK and ALLOW specifications."""
 
@@ -88,20 +172,39 @@ class TargetFilter:
             else:
                 raise ValueError(f"Unknown filter type {row[0]}")
 
-    def should_evaluate(self, module: str, function: str, path: str) -> bool:
-        """Determine if given evaluation target is to be blocked or allowed."""
+        self.block_rules = CompiledRules(self.block_list)
+        self.allow_rules = CompiledRules(self.allow_list)
 
-        for b_entry in self.block_list:
-            if b_entry.match(module, function, path):
-                return False
+    def filter_paths(self, module: str, function: str, paths: Iterable[P]) -> List[P]:
+        """Return the paths of the given function that are to be evaluated."""
+        paths = list(paths)
 
-        # if no ALLOW rules are specified, allow everything that is not blocked
-        if len(self.allow_list) == 0:
-            return True
+        block_mask = self.block_rules.function_mask(module, function)
+        if self.block_rules.match_any_path(block_mask):
+            return []
 
-        for a_entry in self.allow_list:
-            if a_entry.match(module, function, path):
-                return True
+        # if no ALLOW rules are specified, allow everything that is not blocked
+        check_allow = self.allow_rules.size != 0
+        allow_mask = self.allow_rules.function_mask(module, function)
+        if check_allow and allow_mask == 0:
+            return []
+
+        if block_mask == 0 and (
+            not check_allow or self.allow_rules.match_any_path(allow_mask)
+        ):
+            return paths
+
+        result = []
+        for p in paths:
+            p_str = str(p)
+            if self.block_rules.match_path(block_mask, p_str):
+                continue
+            # if ALLOW rules exist, block everything that is not explicitely allowed
+            if check_allow and not self.allow_rules.match_path(allow_mask, p_str):
+                continue
+            result.append(p)
+        return result
 
-        # if ALLOW rules exist, block everything that is not explicitely allowed
-        return False
+    def should_evaluate(self, module: str, function: str, path: str) -> bool:
+        """Determine if given evaluation target is to be blocked or allowed."""
+        return len(self.filter_paths(module, function, [path])) != 0
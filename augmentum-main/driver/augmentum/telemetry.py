@@ -0,0 +1,205 @@
+# Copyright (c) 2021, Björn Franke
+#
+# This source code is licensed under the MIT license found in the
+# LICENSE file in the root directory of this source tree.
+
+"""
+Collector for the telemetry channel of libaugmentum.
+
+Instrumented processes send framed binary events as datagrams to a Unix domain
+socket in the abstract namespace. Every frame starts with a header of magic,
+version, event type, sender pid and payload length followed by the payload:
+
+  ATTACH       no payload, sent once when a process connects
+  VALUE_COUNT  value kind, extension point, first and second value bits, count
+  TRACE        null terminated module and function name
+
+The layout has to match extensions/augmentum/telemetry.h.
+The collector can also run as a small local daemon printing all events:
+
+  python3 -m augmentum.telemetry <name>
+"""
+
+import argparse
+import hashlib
+import logging
+import select
+import socket
+import struct
+import sys
+import threading
+from dataclasses import dataclass
+from pathlib import Path
+from typing import Callable, List, Optional, Set, Tuple
+
+from augmentum.sharedcounters import decode_value
+
+logger = logging.getLogger(__name__)
+
+MAGIC = 0x54475541  # "AUGT"
+VERSION = 1
+
+FRAME_HEADER = struct.Struct("<IHHII")  # magic, version, type, pid, length
+VALUE_COUNT = struct.Struct("<5Q")  # kind, point, first, second, count
+
+EVENT_ATTACH = 1
+EVENT_VALUE_COUNT = 2
+EVENT_TRACE = 3
+
+MAX_FRAME_SIZE = 1 << 16
+RECEIVE_BUFFER_SIZE = 1 << 22
+
+
+def telemetry_name(log_file: Path) -> str:
+    """
+    Name of the collector socket belonging to a probe log. Extensions derive
+    the collector to connect to from the log they would write otherwise.
+    """
+    digest = hashlib.sha1(str(log_file).encode("utf-8")).hexdigest()
+    return f"augmentum_telemetry_{digest[:24]}"
+
+
+@dataclass
+class TelemetryEvent:
+    type: int
+    pid: int
+    payload: bytes
+
+    def log_entry(self, with_point: bool = False) -> Optional[Tuple[str, ...]]:
+        """
+        Return the event in the format of probe log entries if it has one.
+        Value counts are led by the extension point index if with_point is set.
+        """
+        if self.type == EVENT_VALUE_COUNT:
+            kind, point, first, second, count = VALUE_COUNT.unpack(self.payload)
+            entry = (decode_value(kind, first), decode_value(kind, second), str(count))
+            return (str(point),) + entry if with_point else entry
+        elif self.type == EVENT_TRACE:
+            module_name, name = self.payload.split(b"\0")[:2]
+            return module_name.decode("utf-8"), name.decode("utf-8")
+        return None
+
+
+def parse_frame(frame: bytes) -> Optional[TelemetryEvent]:
+    """Parse a single datagram, returns None for malformed frames."""
+    if len(frame) < FRAME_HEADER.size:
+        return None
+    magic, version, type, pid, length = FRAME_HEADER.unpack_from(frame)
+    payload = frame[FRAME_HEADER.size :]
+    if magic != MAGIC or version != VERSION or length != len(payload):
+        return None
+    if type == EVENT_VALUE_COUNT and length != VALUE_COUNT.size:
+        return None
+    if type == EVENT_TRACE and payload.count(b"\0") < 2:
+        return None
+    return TelemetryEvent(type, pid, payload)
+
+
+class TelemetryCollector:
+    """
+    Receives events of all processes connecting to the given name on a
+    background thread. Events are kept until taken with `take_events`.
+    An optional handler is called for each event as it arrives, e.g. to observe
+    the progress of a running build.
+    """
+
+    def __init__(
+        self,
+        name: str,
+        handler: Optional[Callable[[TelemetryEvent], None]] = None,
+    ):
+        self.name = name
+        self.handler = handler
+
+        self.sock = socket.socket(socket.AF_UNIX, socket.SOCK_DGRAM)
+        self.sock.setsockopt(socket.SOL_SOCKET, socket.SO_RCVBUF, RECEIVE_BUFFER_SIZE)
+        self.sock.bind("\0" + name)
+        self.sock.setblocking(False)
+
+        self.lock = threading.Lock()  # protects the receiving state below
+        self.events: List[TelemetryEvent] = []
+        self.processes: Set[int] = set()
+        self.dropped = 0
+
+        self.stopped = threading.Event()
+        self.thread = threading.Thread(target=self.run, daemon=True)
+        self.thread.start()
+
+    def __enter__(self) -> "TelemetryCollector":
+        return self
+
+    def __exit__(self, exc_type, exc_value, traceback):
+        self.close()
+
+    def run(self):
+        while not self.stopped.is_set():
+            ready, _, _ = select.select([self.sock], [], [], 0.1)
+            if ready:
+                self.receive_pending()
+
+    def receive_pending(self):
+        """Receive all events queued on the socket without blocking."""
+        with self.lock:
+            while self.sock is not None:
+                try:
+                    frame = self.sock.recv(MAX_FRAME_SIZE)
+                except BlockingIOError:
+                    return
+                event = parse_frame(frame)
+                if event is None:
+                    self.dropped += 1
+                    continue
+
+                self.processes.add(event.pid)
+                if event.type != EVENT_ATTACH:
+                    self.events.append(event)
+                if self.handler is not None:
+                    self.handler(event)
+
+    def take_events(self) -> List[TelemetryEvent]:
+        """
+        Return and forget all events received so far, including those still
+        queued on the socket.
+        """
+        self.receive_pending()
+        with self.lock:
+            events, self.events = self.events, []
+            self.processes = set()
+            if self.dropped > 0:
+                logger.warning(f"Dropped {self.dropped} malformed telemetry frames.")
+                self.dropped = 0
+        return events
+
+    def close(self):
+        if self.sock is None:
+            return
+        self.stopped.set()
+        self.thread.join()
+        with self.lock:
+            self.sock.close()
+            self.sock = None
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description="Print the telemetry events of instrumented processes."
+    )
+    parser.add_argument("name", help="name of the collector socket")
+    args = parser.parse_args()
+
+    def print_event(event: TelemetryEvent):
+        entry = event.log_entry()
+        description = " ".join(entry) if entry is not None else "attached"
+        print(f"{event.pid}: {description}", flush=True)
+
+    with TelemetryCollector(args.name, print_event):
+        try:
+            while True:
+                select.select([], [], [])
+        except KeyboardInterrupt:
+            pass
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
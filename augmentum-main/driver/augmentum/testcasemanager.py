@@ -10,6 +10,7 @@ import pickle
 from pathlib import Path
 from typing import Any, Dict, Optional, Set
 
+from augmentum.coveragecache import CoverageCache
 from augmentum.objectives import ObjectiveMetric
 from augmentum.priors import ProbeResult
 from augmentum.probes import BaselineProbe, TracerProbe
@@ -113,17 +114,51 @@ class TestCaseManager:
 
     def select_tests(
         self,
-        target_modules: Set[str],
+        target_fns: Dict[str, Set[str]],
         sys_prog: SysProg,
         test_cases: Dict[str, TestCase],
+        coverage_cache: Optional[CoverageCache] = None,
     ) -> Dict[str, Dict[str, Set[str]]]:
         """
-        Select tests cases for target functions in a set of given modules
+        Select tests cases for given target functions (module_name -> {function_name})
         that actually execute corresponding functions.
 
+        If a coverage cache is given, tracing is skipped if all target functions
+        have been traced before and newly traced coverage is added to the cache.
+
         To successfully execute this function, all relevant functions for
         test case selection should have been instrumented beforehand.
         """
+        if coverage_cache is not None:
+            untraced_fns = coverage_cache.untraced(target_fns)
+            if len(untraced_fns) == 0:
+                logger.info(
+                    "Selecting test cases for target functions from coverage cache ..."
+                )
+                return coverage_cache.lookup(target_fns)
+
+            logger.info(
+                f"{sum([len(f) for (_, f) in untraced_fns.items()])} target functions "
+                "not found in coverage cache."
+            )
+
+        selected_tests = self.trace_tests(set(target_fns.keys()), sys_prog, test_cases)
+
+        if coverage_cache is not None:
+            coverage_cache.update(target_fns, selected_tests)
+
+        return selected_tests
+
+    def trace_tests(
+        self,
+        target_modules: Set[str],
+        sys_prog: SysProg,
+        test_cases: Dict[str, TestCase],
+    ) -> Dict[str, Dict[str, Set[str]]]:
+        """
+        Run each test case with a tracer probe and record which instrumented
+        functions in the given modules are executed by it.
+        """
         logger.info(
             "Selecting test cases for target functions in instrumented module ..."
         )
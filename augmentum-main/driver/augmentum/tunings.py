@@ -0,0 +1,346 @@
+# Copyright (c) 2021, Björn Franke
+#
+# This source code is licensed under the MIT license found in the
+# LICENSE file in the root directory of this source tree.
+
+"""
+Compile a table of tuning targets into a tuning file for libaugmentum.
+
+A tuning target is an evaluated function path together with the prior that
+worked for it, in the columns module;function;path;prior;data of the prior
+results table and an optional value column. Each target becomes a tuning
+which sets, offsets or scales the path's value after every call of the
+function. libaugmentum applies all tunings of the file named by
+AUGMENTUM_TUNINGS as extension points are registered, so a tuned
+configuration is deployed without generating and building an extension.
+
+Compiling resolves each path to the byte offsets it takes through the
+function's types, which leaves the runtime with pointer arithmetic and a
+typed store. The layout has to match extensions/augmentum/tunings.h.
+"""
+
+import csv
+import logging
+import math
+import os
+import struct
+from dataclasses import dataclass
+from pathlib import Path
+from typing import Callable, Iterable, List, Optional, Sequence, Tuple
+
+import augmentum.paths as a2p
+from augmentum.function import Function
+from augmentum.type_descs import (
+    ArrayTypeDesc,
+    IntTypeDesc,
+    PointerTypeDesc,
+    RealTypeDesc,
+    StructTypeDesc,
+    TypeDesc,
+)
+
+logger = logging.getLogger(__name__)
+
+MAGIC = 0x31454E5554475541  # "AUGTUNE1"
+VERSION = 1
+
+HEADER = struct.Struct("<QII")  # magic, version, count
+STRING_LENGTH = struct.Struct("<H")
+ENTRY = struct.Struct("<4BIQ")  # root, leaf, bits, action, arg index, value bits
+STEP_COUNT = struct.Struct("<H")
+STEP = struct.Struct("<B3xII")  # op, struct element index, byte offset
+
+ROOT_RESULT = 0
+ROOT_ARG = 1
+
+STEP_DEREF = 0
+STEP_ELEM = 1
+STEP_LEFT = 2
+STEP_RIGHT = 3
+
+LEAF_INT = 1
+LEAF_FLOAT = 2
+
+# leaf sizes libaugmentum can apply tunings to
+INT_BITS = (1, 8, 16, 32, 64)
+FLOAT_BITS = (32, 64)
+
+ACTION_SET = 0
+ACTION_ADD = 1
+ACTION_SCALE = 2
+
+# columns of a tuning target table
+MODULE_IDX = 0
+FUNCTION_IDX = 1
+PATH_IDX = 2
+PRIOR_IDX = 3
+DATA_IDX = 4
+VALUE_IDX = 5
+
+# size of pointers in the system program
+POINTER_SIZE = 8
+
+
+@dataclass
+class Tuning:
+    module: str
+    function: str
+    path: str
+    root: int
+    arg_index: int
+    steps: Tuple[Tuple[int, int, int], ...]  # op, struct element index, offset
+    leaf: int
+    bits: int
+    action: int
+    value: float
+
+    def encode_value(self) -> int:
+        if self.leaf == LEAF_FLOAT or self.action == ACTION_SCALE:
+            return struct.unpack("<Q", struct.pack("<d", self.value))[0]
+        return int(self.value) & 0xFFFFFFFFFFFFFFFF
+
+
+def type_layout(t: TypeDesc) -> Tuple[int, int]:
+    """Size and alignment in bytes of a type on the system program's target."""
+    if isinstance(t, IntTypeDesc):
+        size = 1 if t.bits == 1 else t.bits // 8
+        return size, size
+    if isinstance(t, RealTypeDesc):
+        return t.bits // 8, t.bits // 8
+    if isinstance(t, PointerTypeDesc):
+        return POINTER_SIZE, POINTER_SIZE
+    if isinstance(t, ArrayTypeDesc):
+        size, align = type_layout(t.contained_type)
+        return size * t.num_elems, align
+    if isinstance(t, StructTypeDesc):
+        offsets, size, align = struct_layout(t)
+        return size, align
+    raise ValueError(f"No layout for type {t}")
+
+
+def struct_layout(t: StructTypeDesc) -> Tuple[List[int], int, int]:
+    """Element offsets, size and alignment of a struct."""
+    if t.is_forward():
+        raise ValueError(f"No layout for forward declared struct {t}")
+
+    offsets = []
+    offset = 0
+    struct_align = 1
+    for elem in t.elem_types:
+        size, align = type_layout(elem)
+        if t.is_packed():
+            align = 1
+        offset = (offset + align - 1) // align * align
+        offsets.append(offset)
+        offset += size
+        struct_align = max(struct_align, align)
+
+    size = (offset + struct_align - 1) // struct_align * struct_align
+    return offsets, size, struct_align
+
+
+def prior_action(prior: str) -> int:
+    """Offset and scale priors tune relative to the original value."""
+    if "Offset" in prior:
+        return ACTION_ADD
+    if "Scale" in prior:
+        return ACTION_SCALE
+    return ACTION_SET
+
+
+def choose_value(action: int, data: str, value: Optional[str]) -> float:
+    """
+    Choose the value to apply from an explicit value or from the middle of
+    the range a prior found to work.
+    Offset and scale priors report how far below and above the original
+    value they may go, static priors report the range itself.
+    """
+    if value:
+        return float(value)
+
+    bounds = [float(b) for b in data.split(",")]
+    lower, upper = bounds[0], bounds[-1]
+    if action == ACTION_ADD:
+        return (upper - lower) / 2
+    if action == ACTION_SCALE:
+        return 1 + (upper - lower) / 2
+    return (lower + upper) / 2
+
+
+def compile_tuning(
+    fn: Function, module_name: str, path: str, prior: str, data: str, value: str
+) -> Tuning:
+    """
+    Resolve a tuning target of the given function. module_name is the name
+    libaugmentum registers the function's extension point with.
+    Raises ValueError if the target cannot be applied.
+    """
+    p = next((p for p in fn.get_paths() if str(p) == path), None)
+    if p is None:
+        raise ValueError(f"Path {path} not found for function {fn.name}")
+
+    action = prior_action(prior)
+    tuned_value = choose_value(action, data, value)
+    if not math.isfinite(tuned_value):
+        raise ValueError(f"Value {tuned_value} cannot be applied")
+
+    root = ROOT_RESULT
+    arg_index = 0
+    t: TypeDesc = fn.type
+    steps = []
+    while isinstance(p, a2p.InternalPath):
+        if isinstance(p, a2p.ResultPath):
+            t = t.return_type
+        elif isinstance(p, a2p.ArgumentPath):
+            root = ROOT_ARG
+            arg_index = p.i
+            t = t.arg_types[p.i]
+        elif isinstance(p, a2p.DerefPath):
+            t = t.pointee
+            steps.append((STEP_DEREF, 0, 0))
+        elif isinstance(p, a2p.StructElementPath):
+            offsets, _, _ = struct_layout(t)
+            steps.append((STEP_ELEM, p.i, offsets[p.i]))
+            t = t.elem_types[p.i]
+        elif isinstance(p, a2p.SplitIntLeftPath):
+            t = IntTypeDesc(t.bits // 2)
+            steps.append((STEP_LEFT, 0, 0))
+        elif isinstance(p, a2p.SplitIntRightPath):
+            t = IntTypeDesc(t.bits // 2)
+            steps.append((STEP_RIGHT, 0, t.bits // 8))
+        p = p.path
+
+    leaf_type = p.type
+    if isinstance(leaf_type, RealTypeDesc) and leaf_type.bits in FLOAT_BITS:
+        leaf = LEAF_FLOAT
+    elif isinstance(leaf_type, IntTypeDesc) and leaf_type.bits in INT_BITS:
+        leaf = LEAF_INT
+    else:
+        raise ValueError(f"Cannot tune values of type {leaf_type}")
+
+    return Tuning(
+        module_name,
+        fn.name,
+        path,
+        root,
+        arg_index,
+        tuple(steps),
+        leaf,
+        leaf_type.bits,
+        action,
+        tuned_value,
+    )
+
+
+def read_tuning_targets(file: Path) -> Iterable[Sequence[str]]:
+    """Read the rows of a tuning target table separated by ';' or ','."""
+    with file.open("r", newline="") as f:
+        sample = f.read(4096)
+        f.seek(0)
+        delimiter = ";" if sample.count(";") >= sample.count(",") else ","
+        for row in csv.reader(f, delimiter=delimiter):
+            if not row or row[MODULE_IDX] == "module":
+                continue
+            yield row
+
+
+def compile_tunings(
+    find: Callable[[str, str], Optional[Function]],
+    rows: Iterable[Sequence[str]],
+    src_dir: Path,
+) -> List[Tuning]:
+    """
+    Compile tuning target rows, looking up functions by module and name.
+    Targets which cannot be applied are skipped with a warning.
+    """
+    tunings = []
+    for row in rows:
+        module, function, path, prior, data = row[:VALUE_IDX]
+        value = row[VALUE_IDX] if len(row) > VALUE_IDX else None
+
+        fn = find(module, function)
+        if fn is None:
+            logger.warning(f"Skipping tuning of unknown function {module} {function}")
+            continue
+
+        try:
+            tunings.append(
+                compile_tuning(fn, f"{src_dir}/{module}", path, prior, data, value)
+            )
+        except ValueError as e:
+            logger.warning(f"Skipping tuning of {module} {function} {path}: {e}")
+
+    return tunings
+
+
+def write_tunings(tunings: Sequence[Tuning], file: Path):
+    """Write compiled tunings atomically."""
+
+    def string(s: str) -> bytes:
+        encoded = s.encode("utf-8")
+        return STRING_LENGTH.pack(len(encoded)) + encoded
+
+    data = bytearray(HEADER.pack(MAGIC, VERSION, len(tunings)))
+    for t in tunings:
+        data += string(t.module) + string(t.function) + string(t.path)
+        data += ENTRY.pack(
+            t.root, t.leaf, t.bits, t.action, t.arg_index, t.encode_value()
+        )
+        data += STEP_COUNT.pack(len(t.steps))
+        for step in t.steps:
+            data += STEP.pack(*step)
+
+    tmp_file = file.with_name(file.name + ".tmp")
+    with tmp_file.open("wb") as f:
+        f.write(data)
+    os.replace(tmp_file, file)
+
+
+def read_tunings(file: Path) -> List[Tuning]:
+    """Read a compiled tuning file."""
+    data = file.read_bytes()
+    magic, version, count = HEADER.unpack_from(data)
+    if magic != MAGIC or version != VERSION:
+        raise ValueError(f"Not a tuning file of version {VERSION}: {file}")
+    pos = HEADER.size
+
+    def string() -> str:
+        nonlocal pos
+        (length,) = STRING_LENGTH.unpack_from(data, pos)
+        pos += STRING_LENGTH.size
+        s = data[pos : pos + length].decode("utf-8")
+        pos += length
+        return s
+
+    tunings = []
+    for _ in range(count):
+        module, function, path = string(), string(), string()
+        root, leaf, bits, action, arg_index, value_bits = ENTRY.unpack_from(data, pos)
+        pos += ENTRY.size
+        (num_steps,) = STEP_COUNT.unpack_from(data, pos)
+        pos += STEP_COUNT.size
+        steps = []
+        for _ in range(num_steps):
+            steps.append(STEP.unpack_from(data, pos))
+            pos += STEP.size
+
+        if leaf == LEAF_FLOAT or action == ACTION_SCALE:
+            value = struct.unpack("<d", struct.pack("<Q", value_bits))[0]
+        else:
+            value = struct.unpack("<q", struct.pack("<Q", value_bits))[0]
+
+        tunings.append(
+            Tuning(
+                module,
+                function,
+                path,
+                root,
+                arg_index,
+                tuple(steps),
+                leaf,
+                bits,
+                action,
+                value,
+            )
+        )
+    return tunings
@@ -3,7 +3,7 @@
 # This source code is licensed under the MIT license found in the
 # LICENSE file in the root directory of this source tree.
 
-from typing import Iterable
+from typing import Dict, Iterable, Optional, Tuple
 
 import augmentum.paths
 
@@ -31,8 +31,16 @@ class CppType:
 
 class TypeDesc:
     def get_paths(
-        self, ctx: "augmentum.paths.PathContext"
+        self, ctx: "augmentum.paths.PathContext" = None
     ) -> Iterable["augmentum.paths.Path"]:
+        return [
+            augmentum.paths.decode_path(self, code) for code in self.path_codes(ctx)
+        ]
+
+    def path_codes(
+        self, ctx: "augmentum.paths.PathContext"
+    ) -> Iterable["augmentum.paths.PathCode"]:
+        """Enumerate the integer encoded paths of this type in the given context."""
         raise NotImplementedError
 
     @property
@@ -48,10 +56,10 @@ class TypeDesc:
 
 
 class VoidTypeDesc(TypeDesc):
-    def get_paths(
+    def path_codes(
         self, ctx: "augmentum.paths.PathContext"
-    ) -> Iterable["augmentum.paths.Path"]:
-        return []
+    ) -> Iterable["augmentum.paths.PathCode"]:
+        return ()
 
     def get_cpp_type(self, is_dereffed: bool = False) -> CppType:
         return CppType("void")
@@ -61,39 +69,44 @@ class VoidTypeDesc(TypeDesc):
 
 
 class PrimitiveTypeDesc(TypeDesc):
-    def get_paths(
+    def path_codes(
         self, ctx: "augmentum.paths.PathContext"
-    ) -> Iterable["augmentum.paths.Path"]:
+    ) -> Iterable["augmentum.paths.PathCode"]:
         if ctx == augmentum.paths.PathContext.ARG:
-            return []
-        return [augmentum.paths.LeafPath(self)]
+            return ()
+        return ((),)
+
+
+# memoised path codes for integer types keyed by bits and path context
+_int_path_codes: Dict[Tuple[int, "augmentum.paths.PathContext"], Tuple] = dict()
 
 
 class IntTypeDesc(PrimitiveTypeDesc):
     def __init__(self, bits: int):
         self.bits = bits
 
-    def get_paths(
+    def path_codes(
         self, ctx: "augmentum.paths.PathContext"
-    ) -> Iterable["augmentum.paths.Path"]:
+    ) -> Iterable["augmentum.paths.PathCode"]:
         if ctx == augmentum.paths.PathContext.ARG:
-            return []
-
-        ps = [augmentum.paths.LeafPath(self)]
-        if self.bits == 64 or self.bits == 32 or self.bits == 16:
-            half_type = IntTypeDesc(self.bits // 2)
-            ps.extend(
-                [augmentum.paths.SplitIntLeftPath(p) for p in half_type.get_paths(ctx)]
-            )
-            ps.extend(
-                [augmentum.paths.SplitIntRightPath(p) for p in half_type.get_paths(ctx)]
-            )
-        # TODO currently deactivated until better understood
-        # if self.bits == 32:
-        #     # Sometimes an i32 can be a float
-        #     ps.extend(RealTypeDesc(32).get_paths(ctx))
-
-        return ps
+            return ()
+
+        key = (self.bits, ctx)
+        if key not in _int_path_codes:
+            codes = [()]
+            if self.bits == 64 or self.bits == 32 or self.bits == 16:
+                half_codes = IntTypeDesc(self.bits // 2).path_codes(ctx)
+                left = augmentum.paths.make_step(augmentum.paths.STEP_SPLIT_LEFT)
+                right = augmentum.paths.make_step(augmentum.paths.STEP_SPLIT_RIGHT)
+                codes.extend([(left,) + c for c in half_codes])
+                codes.extend([(right,) + c for c in half_codes])
+            # TODO currently deactivated until better understood
+            # if self.bits == 32:
+            #     # Sometimes an i32 can be a float
+            #     codes.extend(RealTypeDesc(32).path_codes(ctx))
+            _int_path_codes[key] = tuple(codes)
+
+        return _int_path_codes[key]
 
     def get_cpp_type(self, is_dereffed: bool = False) -> CppType:
         if self.bits == 1:
@@ -135,15 +148,13 @@ class PointerTypeDesc(TypeDesc):
     def __init__(self, pointee: TypeDesc):
         self.pointee = pointee
 
-    def get_paths(
+    def path_codes(
         self, ctx: "augmentum.paths.PathContext"
-    ) -> Iterable["augmentum.paths.Path"]:
+    ) -> Iterable["augmentum.paths.PathCode"]:
         if ctx == augmentum.paths.PathContext.ARG:
-            return [
-                augmentum.paths.DerefPath(p)
-                for p in self.pointee.get_paths(augmentum.paths.PathContext.DEREFFED)
-            ]
-        return []
+            deref = augmentum.paths.make_step(augmentum.paths.STEP_DEREF)
+            for c in self.pointee.path_codes(augmentum.paths.PathContext.DEREFFED):
+                yield (deref,) + c
 
     def get_cpp_type(self, is_dereffed: bool = False) -> CppType:
         if is_dereffed:
@@ -163,9 +174,9 @@ class SequentialTypeDesc(TypeDesc):
         self.contained_type = contained_type
         self.num_elems = num_elems
 
-    def get_paths(
+    def path_codes(
         self, ctx: "augmentum.paths.PathContext"
-    ) -> Iterable["augmentum.paths.Path"]:
+    ) -> Iterable["augmentum.paths.PathCode"]:
         raise NotImplementedError
 
     def get_cpp_type(self, is_dereffed: bool = False) -> CppType:
@@ -176,11 +187,11 @@ class ArrayTypeDesc(SequentialTypeDesc):
     def __init__(self, contained_type: TypeDesc, num_elems: int):
         super().__init__(contained_type, num_elems)
 
-    def get_paths(
+    def path_codes(
         self, ctx: "augmentum.paths.PathContext"
-    ) -> Iterable["augmentum.paths.Path"]:
+    ) -> Iterable["augmentum.paths.PathCode"]:
         # TODO PATHS (first three or all if short)
-        return []
+        return ()
 
     def get_cpp_type(self, is_dereffed: bool = False) -> CppType:
         cpp_type = self.contained_type.get_cpp_type(is_dereffed=is_dereffed)
@@ -219,15 +230,35 @@ class StructTypeDesc(TypeDesc):
         self.__forward = forward
         self.__packed = packed
         self.elem_types = elem_types
-
-    def get_paths(
+        # memoised path codes per context, shared by all users of this struct
+        self.__path_codes: Dict[
+            "augmentum.paths.PathContext",
+            Tuple["augmentum.paths.PathCode", ...],
+        ] = dict()
+
+    def __getstate__(self):
+        state = self.__dict__.copy()
+        state["_StructTypeDesc__path_codes"] = dict()
+        return state
+
+    def path_codes(
         self, ctx: "augmentum.paths.PathContext"
-    ) -> Iterable["augmentum.paths.Path"]:
-        return [
-            augmentum.paths.StructElementPath(i, p)
-            for i, t in enumerate(self.elem_types)
-            for p in t.get_paths(ctx)
-        ]
+    ) -> Iterable["augmentum.paths.PathCode"]:
+        if ctx in self.__path_codes:
+            yield from self.__path_codes[ctx]
+            return
+
+        codes = []
+        for i, t in enumerate(self.elem_types):
+            elem = augmentum.paths.make_step(augmentum.paths.STEP_STRUCT_ELEM, i)
+            for c in t.path_codes(ctx):
+                code = (elem,) + c
+                codes.append(code)
+                yield code
+
+        # element types of forward declarations may still change
+        if not self.is_forward():
+            self.__path_codes[ctx] = tuple(codes)
 
     @property
     def name(self) -> str:
@@ -303,31 +334,44 @@ class FunctionTypeDesc(TypeDesc):
     def __init__(self, return_type: TypeDesc, *arg_types: TypeDesc):
         self.return_type = return_type
         self.arg_types = arg_types
+        # memoised path codes, functions with the same signature share this type
+        self.__path_codes: Optional[Tuple["augmentum.paths.PathCode", ...]] = None
 
-    def get_paths(
+    def __getstate__(self):
+        state = self.__dict__.copy()
+        state["_FunctionTypeDesc__path_codes"] = None
+        return state
+
+    def path_codes(
         self, ctx: "augmentum.paths.PathContext" = None
-    ) -> Iterable["augmentum.paths.Path"]:
+    ) -> Iterable["augmentum.paths.PathCode"]:
+        """
+        Lazily enumerate the path codes of this function.
+        Codes are memoised once enumerated completely.
+        """
         # only get paths for function context
-        if ctx == augmentum.paths.PathContext.FUNCTION:
-            ps = []
-            ps.extend(
-                [
-                    augmentum.paths.ResultPath(p)
-                    for p in self.return_type.get_paths(
-                        augmentum.paths.PathContext.RESULT
-                    )
-                ]
-            )
-            for i, t in enumerate(self.arg_types):
-                ps.extend(
-                    [
-                        augmentum.paths.ArgumentPath(i, p)
-                        for p in t.get_paths(augmentum.paths.PathContext.ARG)
-                    ]
-                )
-            return ps
-        else:
-            return []
+        if ctx != augmentum.paths.PathContext.FUNCTION:
+            return
+
+        if self.__path_codes is not None:
+            yield from self.__path_codes
+            return
+
+        codes = []
+        result = augmentum.paths.make_step(augmentum.paths.STEP_RESULT)
+        for c in self.return_type.path_codes(augmentum.paths.PathContext.RESULT):
+            code = (result,) + c
+            codes.append(code)
+            yield code
+
+        for i, t in enumerate(self.arg_types):
+            arg = augmentum.paths.make_step(augmentum.paths.STEP_ARG, i)
+            for c in t.path_codes(augmentum.paths.PathContext.ARG):
+                code = (arg,) + c
+                codes.append(code)
+                yield code
+
+        self.__path_codes = tuple(codes)
 
     def get_cpp_type(self, is_dereffed: bool = False) -> CppType:
         """This is a special case which we do not expect to be used. Hence a simple void is returned."""
@@ -341,10 +385,10 @@ class UnknownTypeDesc(TypeDesc):
     def __init__(self, descriptor: str = "no descriptor"):
         self.__descriptor = descriptor
 
-    def get_paths(
+    def path_codes(
         self, ctx: "augmentum.paths.PathContext" = None
-    ) -> Iterable["augmentum.paths.Path"]:
-        return []
+    ) -> Iterable["augmentum.paths.PathCode"]:
+        return ()
 
     @property
     def descriptor(self):
@@ -0,0 +1,236 @@
+# Copyright (c) 2021, Björn Franke
+#
+# This source code is licensed under the MIT license found in the
+# LICENSE file in the root directory of this source tree.
+
+"""Work queue on a shared directory for drivers cooperating across hosts"""
+
+import hashlib
+import logging
+import os
+import pickle
+import socket
+import struct
+import threading
+import time
+from pathlib import Path
+from typing import Any, Dict, Iterable, List, Optional, Set
+
+logger = logging.getLogger(__name__)
+
+# every result record is prefixed with the length of its pickled payload
+RECORD_HEADER = struct.Struct("<Q")
+
+
+def task_digest(m_name: str, fn_name: str, p_name: str) -> str:
+    """Return a file name safe identifier of a task."""
+    return hashlib.sha256(
+        "\0".join([m_name, fn_name, p_name]).encode("utf-8")
+    ).hexdigest()
+
+
+class SharedWorkQueue:
+    """
+    Coordinates several drivers evaluating the same configuration, possibly on
+    different hosts sharing a directory, e.g. on NFS. All drivers build the
+    same evaluation targets. Before evaluating a path, a driver claims it with
+    a lease file, which is created atomically by hardlinking a private file.
+    Leases are refreshed by heartbeats, sent from a background thread so that
+    long running steps of the driver, e.g. instrumenting the system program,
+    do not let them expire. They may be taken over once their owner stopped
+    refreshing them for longer than the lease timeout. In the rare case
+    that two drivers take over the same stale lease, the path is evaluated twice.
+    The age of a lease is measured against a clock file each driver touches on
+    the shared file system, so that both times come from the file server and
+    skewed host clocks do not matter.
+
+    Each driver appends the results of its tasks to a shard file only it writes
+    to and then marks the task as done. The main driver merges the records of
+    all shards into its heuristic database, other drivers skip done tasks.
+
+    queue_dir
+      - leases   lease file per claimed task
+      - done     marker file per finished task
+      - results  append-only result shard per driver
+      - clocks   clock file per driver
+    """
+
+    LEASE_TIMEOUT = 300.0
+    HEARTBEAT_INTERVAL = 30.0
+
+    def __init__(self, queue_dir: Path, lease_timeout: float = LEASE_TIMEOUT):
+        self.queue_dir = queue_dir
+        self.lease_timeout = lease_timeout
+        self.owner = f"{socket.gethostname()}_{os.getpid()}"
+
+        self.lease_dir = queue_dir / "leases"
+        self.done_dir = queue_dir / "done"
+        self.result_dir = queue_dir / "results"
+        self.clock_dir = queue_dir / "clocks"
+        for d in [self.lease_dir, self.done_dir, self.result_dir, self.clock_dir]:
+            d.mkdir(parents=True, exist_ok=True)
+
+        self.shard_file = self.result_dir / f"{self.owner}.shard"
+        self.shard_offsets: Dict[Path, int] = dict()
+
+        # digests of tasks leased by this driver
+        self.leases: Set[str] = set()
+        self.leases_lock = threading.Lock()  # protects leases and their files
+        self.last_heartbeat = time.monotonic()
+        self.heartbeat_interval = min(self.HEARTBEAT_INTERVAL, lease_timeout / 4)
+
+        self.stopped = threading.Event()
+        self.heartbeat_thread: Optional[threading.Thread] = None
+
+    def lease_file(self, digest: str) -> Path:
+        return self.lease_dir / digest
+
+    def done_tasks(self) -> Set[str]:
+        """Return digests of all tasks finished by any driver."""
+        return set(os.listdir(self.done_dir))
+
+    def shared_time(self) -> float:
+        """Return the current time of the file system holding the queue."""
+        clock = self.clock_dir / self.owner
+        clock.touch()
+        return clock.stat().st_mtime
+
+    def is_stale(self, lease: Path) -> bool:
+        try:
+            return self.shared_time() - lease.stat().st_mtime > self.lease_timeout
+        except FileNotFoundError:
+            return True
+
+    def try_claim(self, m_name: str, fn_name: str, p_name: str) -> bool:
+        """Claim a task, return False if it is done or leased by another driver."""
+        digest = task_digest(m_name, fn_name, p_name)
+        with self.leases_lock:
+            if digest in self.leases:
+                return True
+        if (self.done_dir / digest).exists():
+            return False
+
+        lease = self.lease_file(digest)
+        if lease.exists():
+            if not self.is_stale(lease):
+                return False
+            # move the stale lease out of the way, only one driver succeeds
+            stale = lease.with_name(f"{digest}.{self.owner}.stale")
+            try:
+                os.rename(lease, stale)
+            except FileNotFoundError:
+                return False
+            owner = stale.read_text().strip()
+            stale.unlink()
+            logger.warning(
+                f"Taking over stale lease of {owner} for {m_name} {fn_name} {p_name}"
+            )
+
+        # hardlinking is atomic and fails if the lease exists, also on NFS
+        private = lease.with_name(f"{digest}.{self.owner}.tmp")
+        private.write_text(f"{self.owner}\n")
+        try:
+            os.link(private, lease)
+        except FileExistsError:
+            return False
+        finally:
+            private.unlink()
+
+        with self.leases_lock:
+            self.leases.add(digest)
+
+        # the previous owner may have finished it after we checked, it marks a
+        # task done before releasing the lease
+        if (self.done_dir / digest).exists():
+            self.release(digest)
+            return False
+        return True
+
+    def heartbeat(self, force: bool = False) -> bool:
+        """Refresh leases of this driver if due, return True if they were."""
+        now = time.monotonic()
+        if not force and now - self.last_heartbeat < self.HEARTBEAT_INTERVAL:
+            return False
+
+        self.last_heartbeat = now
+        with self.leases_lock:
+            for digest in self.leases:
+                try:
+                    os.utime(self.lease_file(digest))
+                except FileNotFoundError:
+                    logger.warning(
+                        f"Lease {digest} vanished, another driver may take over."
+                    )
+        return True
+
+    def start_heartbeat(self):
+        """Refresh leases from a background thread until the queue is closed."""
+        if self.heartbeat_thread is not None:
+            return
+        self.heartbeat_thread = threading.Thread(
+            target=self.run_heartbeat, name="lease_heartbeat", daemon=True
+        )
+        self.heartbeat_thread.start()
+
+    def run_heartbeat(self):
+        while not self.stopped.wait(self.heartbeat_interval):
+            self.heartbeat(force=True)
+
+    def complete(self, m_name: str, fn_name: str, p_name: str, record: Any):
+        """Persist the result record of a task, then mark it done and drop its lease."""
+        payload = pickle.dumps(record, protocol=pickle.HIGHEST_PROTOCOL)
+        with self.shard_file.open("ab") as shard:
+            shard.write(RECORD_HEADER.pack(len(payload)) + payload)
+            shard.flush()
+            os.fsync(shard.fileno())
+
+        digest = task_digest(m_name, fn_name, p_name)
+        (self.done_dir / digest).touch()
+        self.release(digest)
+
+    def release(self, digest: str):
+        with self.leases_lock:
+            if digest not in self.leases:
+                return
+            self.leases.remove(digest)
+            try:
+                self.lease_file(digest).unlink()
+            except FileNotFoundError:
+                pass
+
+    def close(self):
+        """Release all leases so that other drivers can take over unfinished tasks."""
+        self.stopped.set()
+        if self.heartbeat_thread is not None:
+            self.heartbeat_thread.join()
+            self.heartbeat_thread = None
+        with self.leases_lock:
+            leases = list(self.leases)
+        for digest in leases:
+            self.release(digest)
+
+    def read_results(self) -> List[Any]:
+        """Return the result records appended to any shard since the last call."""
+        records = []
+        for shard_file in sorted(self.result_dir.glob("*.shard")):
+            records.extend(self._read_shard(shard_file))
+        return records
+
+    def _read_shard(self, shard_file: Path) -> Iterable[Any]:
+        offset = self.shard_offsets.get(shard_file, 0)
+        with shard_file.open("rb") as shard:
+            shard.seek(offset)
+            data = shard.read()
+
+        records = []
+        pos = 0
+        while pos + RECORD_HEADER.size <= len(data):
+            (length,) = RECORD_HEADER.unpack_from(data, pos)
+            end = pos + RECORD_HEADER.size + length
+            if end > len(data):
+                break  # record still being written
+            records.append(pickle.loads(data[pos + RECORD_HEADER.size : end]))
+            pos = end
+
+        self.shard_offsets[shard_file] = offset + pos
+        return records
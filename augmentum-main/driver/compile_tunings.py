@@ -0,0 +1,81 @@
+#!/usr/bin/env python3
+
+# Copyright (c) 2021, Björn Franke
+#
+# This source code is licensed under the MIT license found in the
+# LICENSE file in the root directory of this source tree.
+
+"""
+Compile a table of tuning targets into a tuning file which libaugmentum
+applies at startup when AUGMENTUM_TUNINGS names it.
+"""
+
+import argparse
+import logging
+import pathlib
+
+from augmentum.tunings import compile_tunings, read_tuning_targets, write_tunings
+from generate_extension import open_inventory
+
+
+def parse_args():
+    """Specification and parsing of command line arguments."""
+    parser = argparse.ArgumentParser(
+        description="Compile tuning targets for deployment without extensions."
+    )
+
+    parser.add_argument(
+        "--tunings",
+        metavar="FILE",
+        type=pathlib.Path,
+        required=True,
+        help="Table of tuning targets with the columns "
+        "module;function;path;prior;data and an optional value column, "
+        "e.g. ALL_tuning_targets.csv.",
+    )
+    parser.add_argument(
+        "--src_dir",
+        metavar="DIR",
+        type=pathlib.Path,
+        required=True,
+        help="Source directory the system program was built from.",
+    )
+    parser.add_argument(
+        "--output",
+        metavar="FILE",
+        type=pathlib.Path,
+        required=True,
+        help="Compiled tuning file.",
+    )
+    parser.add_argument(
+        "--config_dir",
+        metavar="DIR",
+        type=pathlib.Path,
+        required=True,
+        help="Directory holding function configuration data.",
+    )
+    parser.add_argument(
+        "--function_cache",
+        metavar="FILE",
+        type=pathlib.Path,
+        help="File path to function inventory. "
+        "If file does not exist, it will be created from the function configuration data.",
+    )
+    return parser.parse_args()
+
+
+def main():
+    logging.basicConfig(level=logging.INFO)
+    args = parse_args()
+
+    with open_inventory(args.config_dir, args.function_cache) as inventory:
+        tunings = compile_tunings(
+            inventory.find, read_tuning_targets(args.tunings), args.src_dir
+        )
+
+    write_tunings(tunings, args.output)
+    print(f"{len(tunings)} tunings written to {args.output}")
+
+
+if __name__ == "__main__":
+    main()
@@ -21,7 +21,7 @@ from augmentum.augmentumUtils import (
 from augmentum.functionfilter import InstrumentDefault, InstrumentFunctionList
 from augmentum.mplogging import LogListener, configure_root_logging
 from augmentum.objectives import CodeSizeObjective
-from augmentum.sysProg import InstrumentationScope, SysProg
+from augmentum.sysProg import InstrumentationScope, ProbeExtension, SysProg
 from augmentum.sysUtils import KVListAction, check_arg_list
 from augmentum.targetfilter import TargetFilter
 from mptools import MainContext, default_signal_handler, init_signals
@@ -99,8 +99,8 @@ def parse_args():
         "--function_cache",
         metavar="FILE",
         type=Path,
-        help="File path to target function cache. "
-        "If file does not exist, a cache will be create after colleting functions.",
+        help="File path to function inventory. "
+        "If file does not exist, an inventory will be created after colleting functions.",
     )
     parser.add_argument(
         "--baseline_cache",
@@ -109,6 +109,20 @@ def parse_args():
         help="File path to baseline statistics cache. "
         "If file does not exist, a cache will be create after measuring baselines.",
     )
+    parser.add_argument(
+        "--test_selection_cache",
+        metavar="FILE",
+        type=Path,
+        help="File path to test coverage cache for target functions. "
+        "The cache is extended with every newly traced function.",
+    )
+    parser.add_argument(
+        "--checkpoint_dir",
+        metavar="DIR",
+        type=Path,
+        help="Directory for checkpoints of prior models of tasks in progress. "
+        "Tasks interrupted in a previous run resume from their last probe round.",
+    )
 
     parser.add_argument(
         "--bmark_filter",
@@ -164,6 +178,12 @@ def parse_args():
         default=1,
         help="Chunk size of for instrumentation scope.",
     )
+    parser.add_argument(
+        "--rank_paths",
+        action="store_true",
+        help="Evaluate paths in the order of their predicted chance of an improvement, "
+        "learned from previous results.",
+    )
 
     parser.add_argument(
         "--keep_probes",
@@ -195,7 +215,52 @@ def parse_args():
         metavar="VALUE",
         type=float,
         default=None,
-        help="Memory limit in MB granted to each probe compilation and probe run.",
+        help="Memory limit in MB granted to each probe compilation and probe run. "
+        "Ignored if a memory budget is set.",
+    )
+    parser.add_argument(
+        "--mem_budget",
+        metavar="VALUE",
+        type=float,
+        default=None,
+        help="Memory budget in MB shared by all workers. Tasks are only started if "
+        "their projected peak memory fits, scaling the number of active workers.",
+    )
+    parser.add_argument(
+        "--scratch_dir",
+        metavar="DIR",
+        type=Path,
+        help="Directory on a fast file system, e.g. a tmpfs, for probe working "
+        "directories and benchmark copies of workers.",
+    )
+    parser.add_argument(
+        "--scratch_size",
+        metavar="VALUE",
+        type=float,
+        default=None,
+        help="Space in MB each worker may use in the scratch directory before "
+        "falling back to the working directory.",
+    )
+    parser.add_argument(
+        "--shared_queue",
+        metavar="DIR",
+        type=Path,
+        help="Directory shared by drivers cooperating on the same evaluation, "
+        "e.g. on several hosts. Paths are claimed through leases in this directory.",
+    )
+    parser.add_argument(
+        "--lease_timeout",
+        metavar="SECS",
+        type=float,
+        default=300.0,
+        help="Seconds after which leases of a driver that stopped refreshing them "
+        "are taken over by other drivers sharing the work queue.",
+    )
+    parser.add_argument(
+        "--queue_main",
+        action="store_true",
+        help="Merge results of all drivers sharing the work queue into the heuristic "
+        "database of this driver.",
     )
     parser.add_argument(
         "--loglevel",
@@ -274,6 +339,9 @@ if __name__ == "__main__":
                 wd_run, general_cfg, sysprog_cfg
             )
 
+            # parse the common includes of generated probe extensions only once
+            ProbeExtension.build_precompiled_header(wd_run, tools_cfg)
+
             cpus = args.cpus
             if cpus <= 0:
                 raise ValueError(f"Given cpu count must be larger zero but is: {cpus}")
@@ -339,8 +407,17 @@ if __name__ == "__main__":
                 instr_chunk,
                 function_cache=args.function_cache,
                 baseline_cache=args.baseline_cache,
+                test_selection_cache=args.test_selection_cache,
+                checkpoint_dir=args.checkpoint_dir,
                 keep_probes=args.keep_probes,
                 probe_mem_limit=args.probe_mem_limit,
+                mem_budget=args.mem_budget,
+                scratch_dir=args.scratch_dir,
+                scratch_size=args.scratch_size,
+                shared_queue=args.shared_queue,
+                lease_timeout=args.lease_timeout,
+                queue_main=args.queue_main,
+                rank_paths=args.rank_paths,
                 worker_mul=args.worker_mul,
                 exact_cpu_map=args.exact_cpu_map,
                 dry_run=args.dry_run,
@@ -11,80 +11,39 @@ Generate extension code for a specified function and path.
 
 import argparse
 import pathlib
-import pickle
 import sys
-from typing import Dict, Generator, Iterable, Optional
-
-from augmentum.function import (
-    Function,
-    FunctionData,
-    NamedStructData,
-    load_named_structs,
-    load_target_function_stats,
-)
-from augmentum.functionfilter import FunctionFilter, InstrumentDefault
+from typing import Optional
+
+from augmentum.function import load_named_structs, load_target_function_stats
+from augmentum.functionfilter import InstrumentDefault
+from augmentum.inventory import FunctionInventory, write_function_inventory
 from augmentum.probes import NullProbe
 from augmentum.timer import Timer
-from augmentum.type_serialisation import DeserialisationContext, TypeDeserialiser
-
-
-def deserialise_functions(
-    function_filter: FunctionFilter,
-    target_function_data: Generator[FunctionData, None, None],
-    named_structs: Dict[str, NamedStructData],
-) -> Iterable[Function]:
-    serialiser = TypeDeserialiser(named_structs)
-    target_functions = []
 
-    for fstats in target_function_data:
-        function_type_desc = serialiser.deserialise_type(
-            DeserialisationContext(fstats.module_name), fstats.serialised_type
-        )
-        fn = Function(
-            fstats.module_name, fstats.function_name, function_type_desc, fstats
-        )
 
-        if function_filter.should_instrument(fn):
-            target_functions.append(fn)
-
-    return target_functions
-
-
-def load_functions(
-    cfg: pathlib.Path,
-    function_filter: FunctionFilter,
-    function_cache: Optional[pathlib.Path],
-) -> Iterable[Function]:
+def open_inventory(
+    cfg: pathlib.Path, function_cache: Optional[pathlib.Path]
+) -> FunctionInventory:
     """
-    Collect target functions, deserialise and filter them.
+    Open function inventory for the given configuration directory.
 
-    Use cached version if available.
+    The inventory is created from the function and named struct stats
+    if it does not exist yet.
     """
+    if function_cache is None:
+        function_cache = cfg / "function_inventory.bin"
 
-    if function_cache is not None and function_cache.exists():
-        print("Loading cached target functions from " + str(function_cache) + " ...")
-        with function_cache.open("rb") as infile:
-            target_functions = pickle.load(infile)
-    else:
-        print("Loading functions ...")
+    if not function_cache.exists():
+        print("Creating function inventory at " + str(function_cache) + " ...")
         with Timer(logger=print):
-            target_function_data = load_target_function_stats(
-                cfg / "function_stats_relative.csv"
+            write_function_inventory(
+                load_target_function_stats(cfg / "function_stats_relative.csv"),
+                load_named_structs(cfg / "named_struct_stats_relative.csv"),
+                function_cache,
             )
-            named_structs = load_named_structs(cfg / "named_struct_stats_relative.csv")
 
-        print("Deserialising funtions ...")
-        with Timer(logger=print):
-            target_functions = deserialise_functions(
-                function_filter, target_function_data, named_structs
-            )
-
-        if function_cache is not None:
-            print("Caching target functions to " + str(function_cache) + " ...")
-            with function_cache.open("wb") as outfile:
-                pickle.dump(target_functions, outfile)
-
-    return target_functions
+    print("Loading function inventory from " + str(function_cache) + " ...")
+    return FunctionInventory(function_cache)
 
 
 def generate_extension(
@@ -95,30 +54,26 @@ def generate_extension(
     cfg: pathlib.Path,
     fn_cache: Optional[pathlib.Path],
 ):
-    functions = load_functions(cfg, InstrumentDefault(), fn_cache)
+    with open_inventory(cfg, fn_cache) as inventory:
+        my_fn = inventory.find(module, function)
+        my_path = None
 
-    my_fn = None
-    my_path = None
-
-    for fn in functions:
-        if fn.name == function and fn.module == module:
-            paths = fn.get_paths()
-            for p in paths:
+        if my_fn is not None and InstrumentDefault().should_instrument(my_fn):
+            for p in my_fn.get_paths():
                 if str(p) == path:
-                    my_fn = fn
                     my_path = p
                     break
-            if p is not None:
-                break
 
-    if my_fn is None or my_path is None:
-        print("ERROR: Function or path not found.")
-        sys.exit(1)
+        if my_fn is None or my_path is None:
+            print("ERROR: Function or path not found.")
+            sys.exit(1)
+
+        my_probe = NullProbe(my_fn, my_path, "Manual Extension Generator")
+        extension_code = my_probe.extension_code(
+            pathlib.Path("this/is/not/required.txt"),
+            pathlib.Path("/this/is/not/required"),
+        )
 
-    my_probe = NullProbe(my_fn, my_path, "Manual Extension Generator")
-    extension_code = my_probe.extension_code(
-        pathlib.Path("this/is/not/required.txt"), pathlib.Path("/this/is/not/required")
-    )
     outfile = pathlib.Path(wd) / "extension.cpp"
     with outfile.open("w") as f:
         f.write(extension_code)
@@ -162,8 +117,8 @@ def parse_args():
         "--function_cache",
         metavar="FILE",
         type=pathlib.Path,
-        help="File path to function cache. "
-        "If file does not exist, a cache will be create after colleting functions.",
+        help="File path to function inventory. "
+        "If file does not exist, it will be created from the function configuration data.",
     )
     return parser.parse_args()
 
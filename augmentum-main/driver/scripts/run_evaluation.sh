@@ -32,8 +32,10 @@ run_driver() {
 
 #        BFILTER="--bmark_filter SNU_NPB#bt"
 
-        FUN_CACHE="--function_cache ${CFG_DIR}/function_cache.pickle"
+        FUN_CACHE="--function_cache ${CFG_DIR}/function_inventory.bin"
         BASE_CACHE="--baseline_cache ${CFG_DIR}/baseline_cache.pickle"
+        TEST_CACHE="--test_selection_cache ${CFG_DIR}/test_selection_cache.pickle"
+        CHECKPOINTS="--checkpoint_dir ${WORKING_DIR}/checkpoints_${JOB_ID}"
         TARGET_FUNS="--target_function ${CFG_DIR}/target_functions.csv"
 #        TARGET_FILTER="--target_filter ${CFG_DIR}/target_filter.csv"
 
@@ -43,6 +45,10 @@ run_driver() {
         CPU_COUNT="--cpus ${CPUS}"
 #        EXACT_MAP="--exact_cpu_map"
         MEM_LIMIT="--probe_mem_limit 2048"
+#        MEM_BUDGET="--mem_budget 65536"
+#        SCRATCH="--scratch_dir /dev/shm/augmentum --scratch_size 4096"
+#        SHARED_QUEUE="--shared_queue /path/to/shared/queue --queue_main"
+#        RANK_PATHS="--rank_paths"
 
         RUN_ID=eval_run_${JOB_ID}_$(date +"%Y-%m-%d_%H-%M-%S")
 
@@ -52,8 +58,12 @@ run_driver() {
                 --config ${CONFIG}
                 --instr_scope ALL
                 --instr_chunk 1
+                ${RANK_PATHS}
                 ${SKIP_IMM}
                 ${MEM_LIMIT}
+                ${MEM_BUDGET}
+                ${SCRATCH}
+                ${SHARED_QUEUE}
                 ${SQL_DB}
                 ${TARGET_FUNS}
                 ${TARGET_FILTER}
@@ -61,6 +71,8 @@ run_driver() {
                 ${CHUNK_OFFSET}
                 ${FUN_CACHE}
                 ${BASE_CACHE}
+                ${TEST_CACHE}
+                ${CHECKPOINTS}
                 ${CPU_COUNT}
                 ${EXACT_MAP}
                 ${DRY_RUN}
@@ -0,0 +1,100 @@
+# Copyright (c) 2021, Björn Franke
+#
+# This source code is licensed under the MIT license found in the
+# LICENSE file in the root directory of this source tree.
+
+import os
+import stat
+import sys
+import tempfile
+import unittest
+from pathlib import Path
+from subprocess import TimeoutExpired
+
+from augmentum.batchopt import BatchOptimiser, batchopt_opt_level
+
+# stands in for tools/batchopt, extension "hang" blocks and "crash" exits
+FAKE_BATCHOPT = """#!{python}
+import sys, time
+print("probe noise")
+print("@batchopt READY", sys.argv[-1], flush=True)
+for line in sys.stdin:
+    extension, output = line.rstrip("\\n").split("\\t")
+    if extension == "hang":
+        time.sleep(60)
+    if extension == "crash":
+        sys.exit(1)
+    if extension == "missing":
+        print("@batchopt FAIL loading extension failed", flush=True)
+        continue
+    with open(output, "w") as out:
+        out.write(extension)
+    print("@batchopt OK", len(extension), flush=True)
+"""
+
+
+class TestBatchOptimiser(unittest.TestCase):
+    def setUp(self) -> None:
+        self.tmp_dir = tempfile.TemporaryDirectory()
+        self.dir = Path(self.tmp_dir.name)
+
+        self.batchopt_bin = self.dir / "batchopt"
+        self.batchopt_bin.write_text(FAKE_BATCHOPT.format(python=sys.executable))
+        self.batchopt_bin.chmod(self.batchopt_bin.stat().st_mode | stat.S_IEXEC)
+
+        self.optimiser = BatchOptimiser(self.batchopt_bin, self.dir / "ft.S.bc", "z")
+        self.output = self.dir / "opt_ft.S.bc"
+
+    def tearDown(self) -> None:
+        self.optimiser.close()
+        self.tmp_dir.cleanup()
+
+    def test_opt_level(self):
+        self.assertEqual(batchopt_opt_level("-Oz"), "z")
+        self.assertEqual(batchopt_opt_level(" -O2 "), "2")
+        self.assertIsNone(batchopt_opt_level("-Oz -fno-crash-diagnostics"))
+        self.assertIsNone(batchopt_opt_level(""))
+
+    def test_process_is_reused(self):
+        self.assertTrue(
+            self.optimiser.optimise(Path("libprobe1.so"), self.output, self.dir)
+        )
+        self.assertEqual(self.output.read_text(), "libprobe1.so")
+        pid = self.optimiser.process.pid
+
+        self.assertTrue(self.optimiser.optimise(None, self.output, self.dir))
+        self.assertEqual(self.output.read_text(), "-")
+        self.assertEqual(self.optimiser.process.pid, pid)
+
+        self.assertFalse(
+            self.optimiser.optimise(Path("missing"), self.output, self.dir)
+        )
+        self.assertEqual(self.optimiser.process.pid, pid)
+
+        # a different memory limit requires a new process
+        self.assertTrue(
+            self.optimiser.optimise(None, self.output, self.dir, memory_limit=4096)
+        )
+        self.assertNotEqual(self.optimiser.process.pid, pid)
+
+    def test_restart_after_failure(self):
+        self.assertFalse(self.optimiser.optimise(Path("crash"), self.output, self.dir))
+        self.assertIsNone(self.optimiser.process)
+
+        with self.assertRaises(TimeoutExpired):
+            self.optimiser.optimise(Path("hang"), self.output, self.dir, timeout=1)
+        self.assertIsNone(self.optimiser.process)
+
+        self.assertTrue(
+            self.optimiser.optimise(Path("libprobe2.so"), self.output, self.dir)
+        )
+        self.assertEqual(self.output.read_text(), "libprobe2.so")
+
+    def test_library_path(self):
+        self.optimiser.optimise(None, self.output, self.dir)
+        environ = Path("/proc") / str(self.optimiser.process.pid) / "environ"
+        if environ.exists():
+            env = environ.read_bytes().split(b"\0")
+            paths = [e for e in env if e.startswith(b"LD_LIBRARY_PATH=")]
+            expected = os.fsencode(f"LD_LIBRARY_PATH={self.dir}")
+            self.assertTrue(paths[0].startswith(expected))
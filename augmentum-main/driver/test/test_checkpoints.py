@@ -0,0 +1,78 @@
+# Copyright (c) 2021, Björn Franke
+#
+# This source code is licensed under the MIT license found in the
+# LICENSE file in the root directory of this source tree.
+
+import tempfile
+import unittest
+from pathlib import Path
+
+from augmentum.checkpoints import PriorCheckpoints
+from augmentum.function import Function, FunctionData
+from augmentum.priors import ProbeResult, build_priors
+from augmentum.type_descs import FunctionTypeDesc, i32_t
+
+from augmentum.benchmarks import ExecutionResult
+
+
+class TestPriorCheckpoints(unittest.TestCase):
+    def setUp(self) -> None:
+        self.tmp_dir = tempfile.TemporaryDirectory()
+        self.checkpoints = PriorCheckpoints(Path(self.tmp_dir.name))
+
+        fn_data = FunctionData(
+            "add.cpp",
+            "_Z3addii",
+            "@$ i32, i32, i32 $@",
+            "add(int, int)",
+            2,
+            "instrument",
+        )
+        fn_type = FunctionTypeDesc(i32_t, i32_t, i32_t)
+        self.fun = Function("add.cpp", "_Z3addii", fn_type, fn_data)
+        self.path = self.fun.get_paths()[0]
+        self.key = (self.fun.module, self.fun.name, str(self.path))
+
+    def tearDown(self) -> None:
+        self.tmp_dir.cleanup()
+
+    def probe_round(self, prior):
+        prior.select_next_probe()
+        result = ProbeResult(None, None)
+        result.compile_ok = ExecutionResult.SUCCESS
+        result.run_ok = ExecutionResult.SUCCESS
+        result.verify_ok = ExecutionResult.SUCCESS
+        prior.update(result)
+
+    def test_resume(self):
+        self.assertIsNone(self.checkpoints.load(*self.key, {"t1"}))
+
+        prior = build_priors(self.fun, self.path, False)
+        self.probe_round(prior)
+        self.checkpoints.save(*self.key, {"t1"}, prior, True)
+
+        restored, obj_improvement = self.checkpoints.load(*self.key, {"t1"})
+        self.assertTrue(obj_improvement)
+        self.assertEqual(len(restored.get_probe_log()), 1)
+        self.assertEqual(
+            str(restored.select_next_probe()), str(prior.select_next_probe())
+        )
+
+        # tests evaluated independently are kept apart
+        self.assertIsNone(self.checkpoints.load(*self.key, {"t1", "t2"}))
+        other = build_priors(self.fun, self.path, False)
+        self.checkpoints.save(*self.key, {"t2"}, other, False)
+        self.assertIsNotNone(self.checkpoints.load(*self.key, {"t1"}))
+
+        self.checkpoints.discard(*self.key)
+        self.assertIsNone(self.checkpoints.load(*self.key, {"t1"}))
+        self.assertIsNone(self.checkpoints.load(*self.key, {"t2"}))
+        self.checkpoints.discard(*self.key)
+
+    def test_corrupt_checkpoint(self):
+        self.checkpoints.task_file(*self.key).write_bytes(b"\x80\x05truncated")
+        self.assertIsNone(self.checkpoints.load(*self.key, {"t1"}))
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,45 @@
+# Copyright (c) 2021, Björn Franke
+#
+# This source code is licensed under the MIT license found in the
+# LICENSE file in the root directory of this source tree.
+
+import tempfile
+import unittest
+from pathlib import Path
+
+from augmentum.coveragecache import CoverageCache
+
+
+class TestCoverageCache(unittest.TestCase):
+    def setUp(self) -> None:
+        self.tmp_dir = tempfile.TemporaryDirectory()
+        self.cache_file = Path(self.tmp_dir.name) / "coverage.pickle"
+
+    def tearDown(self) -> None:
+        self.tmp_dir.cleanup()
+
+    def test_incremental_update(self):
+        cache = CoverageCache(self.cache_file, "build", "bench")
+        cache.update({"a.cpp": {"f", "g"}}, {"a.cpp": {"f": {"t1", "t2"}}})
+
+        reloaded = CoverageCache(self.cache_file, "build", "bench")
+        self.assertEqual(
+            reloaded.untraced({"a.cpp": {"f", "g", "h"}, "b.cpp": {"k"}}),
+            {"a.cpp": {"h"}, "b.cpp": {"k"}},
+        )
+        # g was traced but never executed and is therefore not selected
+        self.assertEqual(
+            reloaded.lookup({"a.cpp": {"f", "g"}}), {"a.cpp": {"f": {"t1", "t2"}}}
+        )
+
+        reloaded.update({"b.cpp": {"k"}}, {"b.cpp": {"k": {"t1"}}})
+        self.assertEqual(reloaded.untraced({"a.cpp": {"f"}, "b.cpp": {"k"}}), {})
+
+    def test_key_mismatch(self):
+        cache = CoverageCache(self.cache_file, "build", "bench")
+        cache.update({"a.cpp": {"f"}}, {"a.cpp": {"f": {"t1"}}})
+
+        other_build = CoverageCache(self.cache_file, "other_build", "bench")
+        self.assertEqual(other_build.untraced({"a.cpp": {"f"}}), {"a.cpp": {"f"}})
+        self.assertEqual(other_build.lookup({"a.cpp": {"f"}}), {})
+
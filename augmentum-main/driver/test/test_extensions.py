@@ -3,15 +3,31 @@
 # This source code is licensed under the MIT license found in the
 # LICENSE file in the root directory of this source tree.
 
+import os
 import subprocess
+import tempfile
 import unittest
+from pathlib import Path
+
+from augmentum.function import Function, FunctionData
+from augmentum.tunings import compile_tunings, write_tunings
+from augmentum.type_descs import (
+    FunctionTypeDesc,
+    PointerTypeDesc,
+    StructTypeDesc,
+    double_t,
+    i8_t,
+    i32_t,
+    i64_t,
+)
 
 
 class TestExtensions(unittest.TestCase):
-    def run_native_executable(self, exec: str):
+    def run_native_executable(self, exec: str, env=None):
         completedProc = subprocess.run(
             exec,
             shell=True,
+            env=env,
             stdout=subprocess.PIPE,
             stderr=subprocess.STDOUT,
             text=True,
@@ -43,3 +59,32 @@ class TestExtensions(unittest.TestCase):
 
     def test_explicit(self):
         self.run_native_executable("test/native/explicit")
+
+    def test_templated(self):
+        self.run_native_executable("test/native/templated")
+
+    def test_tunings(self):
+        # int64_t stats(Stats*) of test/native/tuned
+        struct_td = StructTypeDesc(
+            "tuned.cpp", "struct.Stats", False, False, i8_t, double_t, i32_t
+        )
+        fn_type = FunctionTypeDesc(i64_t, PointerTypeDesc(struct_td))
+        fn_data = FunctionData(
+            "tuned.cpp", "_Z5statsP5Stats", "", "NA", "120", "instrument"
+        )
+        fun = Function("tuned.cpp", "_Z5statsP5Stats", fn_type, fn_data)
+
+        rows = [
+            ("tuned.cpp", fun.name, "Z.T-i64", "Integer Range Prior", "0,14"),
+            ("tuned.cpp", fun.name, "Z.R.T-i32", "Integer Offset Prior", "0,2"),
+            ("tuned.cpp", fun.name, "A0.D.S1.T-f64", "Real Scale Prior", "0,2"),
+            ("tuned.cpp", fun.name, "A0.D.S2.T-i32", "Integer Offset Prior", "2,6"),
+        ]
+        tunings = compile_tunings(lambda m, f: fun, rows, Path("src"))
+        self.assertEqual(len(tunings), len(rows))
+
+        with tempfile.TemporaryDirectory() as tmp_dir:
+            tuning_file = Path(tmp_dir) / "tunings.bin"
+            write_tunings(tunings, tuning_file)
+            env = dict(os.environ, AUGMENTUM_TUNINGS=str(tuning_file))
+            self.run_native_executable("test/native/tuned", env)
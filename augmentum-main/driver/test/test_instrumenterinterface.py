@@ -0,0 +1,67 @@
+# Copyright (c) 2021, Björn Franke
+#
+# This source code is licensed under the MIT license found in the
+# LICENSE file in the root directory of this source tree.
+
+import csv
+import tempfile
+import unittest
+from pathlib import Path
+
+from augmentum.sysProgBuilders import InstrumenterInterface
+
+
+class TestInstrumenterInterface(unittest.TestCase):
+    def setUp(self) -> None:
+        self.tmp_dir = tempfile.TemporaryDirectory()
+        tmp = Path(self.tmp_dir.name)
+        self.interface = InstrumenterInterface(
+            tmp / "target_functions.csv", Path("/src"), tmp / "target_data.csv"
+        )
+
+    def tearDown(self) -> None:
+        self.tmp_dir.cleanup()
+
+    def read_rows(self, path: Path):
+        with open(path, "r") as sIn:
+            return list(csv.reader(sIn, delimiter=InstrumenterInterface.delimiter))
+
+    def test_data_targets(self):
+        self.interface.set_data_pt_targets(
+            {
+                "lib/Analysis/InlineCost.cpp": {
+                    ("global", "_ZL15InlineThreshold", ""),
+                    ("constant", "_ZN4llvm12getInlineCostEv", "225"),
+                }
+            }
+        )
+
+        rows = self.read_rows(self.interface.data_file)
+        self.assertEqual(rows[0], InstrumenterInterface.target_data_header)
+        self.assertEqual(
+            rows[1:],
+            [
+                [
+                    "/src/lib/Analysis/InlineCost.cpp",
+                    "constant",
+                    "_ZN4llvm12getInlineCostEv",
+                    "225",
+                ],
+                [
+                    "/src/lib/Analysis/InlineCost.cpp",
+                    "global",
+                    "_ZL15InlineThreshold",
+                    "",
+                ],
+            ],
+        )
+
+    def test_function_targets_unchanged(self):
+        self.interface.set_extension_pt_targets({"lib/a.cpp": {"_Z1fv"}})
+
+        rows = self.read_rows(self.interface.comm_file)
+        self.assertEqual(rows, [["MODULE", "FUNCTION"], ["/src/lib/a.cpp", "_Z1fv"]])
+
+
+if __name__ == "__main__":
+    unittest.main()
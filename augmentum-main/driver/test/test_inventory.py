@@ -0,0 +1,71 @@
+# Copyright (c) 2021, Björn Franke
+#
+# This source code is licensed under the MIT license found in the
+# LICENSE file in the root directory of this source tree.
+
+import pickle
+import tempfile
+import unittest
+from pathlib import Path
+
+from augmentum.function import Function, FunctionData, NamedStructData
+from augmentum.inventory import FunctionInventory, write_function_inventory
+
+
+class TestFunctionInventory(unittest.TestCase):
+    def setUp(self) -> None:
+        self.tmp_dir = tempfile.TemporaryDirectory()
+        self.inventory_file = Path(self.tmp_dir.name) / "inventory.bin"
+
+        functions = [
+            FunctionData("b.cpp", "_Z3bazv", "@$ f64 $@", "baz()", "3", "instrument"),
+            FunctionData(
+                "a.cpp",
+                "_Z3barP4Node",
+                "@$ void,@% a.cpp::class.Node %@* $@",
+                "bar(Node*)",
+                "5",
+                "instrument",
+            ),
+            FunctionData("a.cpp", "_Z3fooi", "@$ i32,i32 $@", "foo(int)", "10", "no"),
+        ]
+        node = NamedStructData(
+            "a.cpp",
+            "class.Node",
+            "{ i32, @% a.cpp::class.Node %@* }",
+            "%class.Node",
+            "named:true#packed:false#literal:false#opaque:false",
+        )
+        write_function_inventory(functions, {node.key: node}, self.inventory_file)
+
+    def tearDown(self) -> None:
+        self.tmp_dir.cleanup()
+
+    def test_iteration_order(self):
+        with FunctionInventory(self.inventory_file) as inventory:
+            self.assertEqual(len(inventory), 3)
+            self.assertEqual(
+                [(f.module, f.name) for f in inventory],
+                [("b.cpp", "_Z3bazv"), ("a.cpp", "_Z3barP4Node"), ("a.cpp", "_Z3fooi")],
+            )
+
+    def test_find(self):
+        with FunctionInventory(self.inventory_file) as inventory:
+            fn = inventory.find("a.cpp", "_Z3fooi")
+            self.assertIsNotNone(fn)
+            self.assertEqual(fn.function_stats.can_instrument, "no")
+            self.assertEqual(str(fn), "i32 _Z3fooi(i32)")
+
+            self.assertIsNone(inventory.find("a.cpp", "_Z3bazv"))
+            self.assertIsNone(inventory.find("c.cpp", "_Z3fooi"))
+
+    def test_named_struct_type(self):
+        with FunctionInventory(self.inventory_file) as inventory:
+            fn = inventory.find("a.cpp", "_Z3barP4Node")
+            self.assertEqual(str(fn), "void _Z3barP4Node(class.Node*)")
+            self.assertEqual(str(fn.get_paths()[0]), "A0.D.S0.T-i32")
+
+            # lazy functions are transferred as fully materialised functions
+            copy = pickle.loads(pickle.dumps(fn))
+            self.assertIs(type(copy), Function)
+            self.assertEqual(str(copy), str(fn))
@@ -0,0 +1,75 @@
+# Copyright (c) 2021, Björn Franke
+#
+# This source code is licensed under the MIT license found in the
+# LICENSE file in the root directory of this source tree.
+
+import os
+import subprocess
+import unittest
+
+from augmentum.memmonitor import MemoryAdmission, PeakRSSSampler, tree_rss
+
+MB = 1024 * 1024
+
+
+class TestMemoryAdmission(unittest.TestCase):
+    def test_initial_split(self):
+        admission = MemoryAdmission(400 * MB, 4)
+        self.assertEqual(admission.estimate("a.cpp", "f"), 100 * MB)
+        for _ in range(4):
+            self.assertIsNotNone(admission.try_admit("a.cpp", "f"))
+        self.assertIsNone(admission.try_admit("a.cpp", "f"))
+
+    def test_scale_with_measured_peaks(self):
+        admission = MemoryAdmission(400 * MB, 8)
+        projection = admission.try_admit("a.cpp", "f")
+        admission.finished("a.cpp", "f", projection, 160 * MB)
+
+        # a single task of f is projected to need 200 MB
+        self.assertEqual(admission.estimate("a.cpp", "f"), 200 * MB)
+        active = [admission.try_admit("a.cpp", "f") for _ in range(3)]
+        self.assertIsNone(active[-1])
+
+        # small functions run concurrently once measured
+        for projection in active[:-1]:
+            admission.finished("a.cpp", "f", projection, None)
+        projection = admission.try_admit("b.cpp", "g")
+        admission.finished("b.cpp", "g", projection, 8 * MB)
+        active = [admission.try_admit("b.cpp", "g") for _ in range(8)]
+        self.assertTrue(all([p is not None for p in active]))
+        self.assertIsNone(admission.try_admit("b.cpp", "g"))
+
+        # unknown functions assume the largest recent peak
+        self.assertEqual(admission.estimate("c.cpp", "h"), 200 * MB)
+
+    def test_progress(self):
+        admission = MemoryAdmission(100 * MB, 4)
+        projection = admission.try_admit("a.cpp", "f")
+        admission.finished("a.cpp", "f", projection, 1000 * MB)
+
+        # a task exceeding the budget still runs, but on its own
+        self.assertIsNotNone(admission.try_admit("a.cpp", "f", available=0))
+        self.assertIsNone(admission.try_admit("b.cpp", "g"))
+
+
+class TestPeakRSSSampler(unittest.TestCase):
+    def test_tree_rss(self):
+        own = tree_rss(os.getpid())
+        self.assertGreater(own, 0)
+
+        with subprocess.Popen(["sleep", "5"]) as child:
+            try:
+                self.assertGreater(tree_rss(os.getpid()), own)
+            finally:
+                child.kill()
+
+    def test_peak(self):
+        with PeakRSSSampler(interval=0.01) as sampler:
+            subprocess.run(
+                ["python3", "-c", "b = bytearray(64 * 1024 * 1024)"], check=True
+            )
+        self.assertGreaterEqual(sampler.peak, 64 * MB)
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,78 @@
+# Copyright (c) 2021, Björn Franke
+#
+# This source code is licensed under the MIT license found in the
+# LICENSE file in the root directory of this source tree.
+
+import unittest
+
+from augmentum.function import Function, FunctionData, Module
+from augmentum.pathranking import PathRanker, path_features, path_steps
+from augmentum.type_descs import FunctionTypeDesc, PointerTypeDesc, i32_t
+
+
+def make_function(m_name: str, fn_name: str, fn_type: FunctionTypeDesc) -> Function:
+    fn_data = FunctionData(m_name, fn_name, "", "NA", "120", "instrument")
+    return Function(m_name, fn_name, fn_type, fn_data)
+
+
+class TestPathRanking(unittest.TestCase):
+    def setUp(self) -> None:
+        # int f(int, int*)
+        self.fun = make_function(
+            "a.cpp", "_Z1fiPi", FunctionTypeDesc(i32_t, i32_t, PointerTypeDesc(i32_t))
+        )
+        self.module = Module("a.cpp")
+        self.module.functions[self.fun.name] = self.fun
+        self.modules = {"a.cpp": self.module}
+        self.paths = {str(p): p for p in self.fun.get_paths()}
+
+    def test_features(self):
+        self.assertEqual(
+            path_steps("A0.D.S1.T-%struct.pair*"), (["A0", "D", "S1"], "%struct.pair*")
+        )
+
+        features = path_features(self.fun, "A1.D.T-i32")
+        self.assertIn("root:A1", features)
+        self.assertIn("shape:A.D", features)
+        self.assertIn("leaf:i32", features)
+        self.assertEqual(features["pcount:2"], 1.0)
+
+    def test_rank(self):
+        targets = {"a.cpp": {self.fun.name: dict(self.paths)}}
+
+        # untrained ranking keeps the original order
+        ranked = [str(p) for _, _, p in PathRanker().rank(self.modules, targets)]
+        self.assertEqual(ranked, list(self.paths))
+
+        # return values improved in another function, pointer arguments never did
+        ranker = PathRanker()
+        other = make_function(
+            "b.cpp", "_Z1gPi", FunctionTypeDesc(i32_t, PointerTypeDesc(i32_t))
+        )
+        for _ in range(20):
+            ranker.learn_result(other, "Z.T-i32", True, True)
+            ranker.learn_result(other, "A0.D.T-i32", False, False)
+
+        ranked = [str(p) for _, _, p in ranker.rank(self.modules, targets)]
+        self.assertEqual(ranked[0], "Z.T-i32")
+        self.assertGreater(
+            ranker.score(self.fun, "Z.T-i32"), ranker.score(self.fun, "A1.D.T-i32")
+        )
+
+    def test_bootstrap(self):
+        ranker = PathRanker()
+        ranker.bootstrap(
+            self.modules,
+            [
+                ("a.cpp", self.fun.name, "Z.T-i32", "1", True),
+                ("a.cpp", self.fun.name, "A0.T-i32", "0", False),
+                ("gone.cpp", "_Z1hv", "Z.T-i32", "1", True),
+            ],
+        )
+        # rows of functions no longer known are skipped
+        self.assertEqual(ranker.observed, 2)
+        self.assertEqual(ranker.promising, 1)
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,63 @@
+# Copyright (c) 2021, Björn Franke
+#
+# This source code is licensed under the MIT license found in the
+# LICENSE file in the root directory of this source tree.
+
+import pickle
+import unittest
+
+from augmentum.function import Function, FunctionData
+from augmentum.paths import PathContext, decode_path
+from augmentum.type_descs import (
+    FunctionTypeDesc,
+    PointerTypeDesc,
+    StructTypeDesc,
+    i8_t,
+    i16_t,
+    i32_t,
+)
+
+
+class TestPathEnumeration(unittest.TestCase):
+    def setUp(self) -> None:
+        self.struct_td = StructTypeDesc("mymod.cpp", "MyStruct", False, False, i8_t)
+        self.fn_type = FunctionTypeDesc(
+            i16_t, i32_t, PointerTypeDesc(self.struct_td), PointerTypeDesc(i8_t)
+        )
+
+    def make_function(self, name: str, demangled: str) -> Function:
+        return Function(
+            "mymod.cpp",
+            name,
+            self.fn_type,
+            FunctionData("mymod.cpp", name, "", demangled, "1", "instrument"),
+        )
+
+    def test_paths(self):
+        fn = self.make_function("_Z3fooiP8MyStructPa", "NA")
+        self.assertEqual(
+            [str(p) for p in fn.get_paths()],
+            ["Z.T-i16", "Z.L.T-i8", "Z.R.T-i8", "A1.D.S0.T-i8", "A2.D.T-i8"],
+        )
+        self.assertEqual([str(p.type) for p in fn.get_paths()][-1], "i8")
+
+    def test_const_args_filtered(self):
+        fn = self.make_function(
+            "_Z3fooiPK8MyStructPa", "foo(int, MyStruct const*, signed char*)"
+        )
+        self.assertEqual(
+            [str(p) for p in fn.get_paths()],
+            ["Z.T-i16", "Z.L.T-i8", "Z.R.T-i8", "A2.D.T-i8"],
+        )
+
+    def test_codes_shared_by_signature(self):
+        codes = list(self.fn_type.path_codes(PathContext.FUNCTION))
+        self.assertEqual(
+            [str(decode_path(self.fn_type, c)) for c in codes],
+            [str(p) for p in self.make_function("_Z3barv", "NA").get_paths()],
+        )
+        # enumerated codes are memoised by the type and dropped when pickled
+        self.assertIsNotNone(self.fn_type._FunctionTypeDesc__path_codes)
+        copy = pickle.loads(pickle.dumps(self.fn_type))
+        self.assertIsNone(copy._FunctionTypeDesc__path_codes)
+        self.assertEqual(list(copy.path_codes(PathContext.FUNCTION)), codes)
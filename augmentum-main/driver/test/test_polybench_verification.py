@@ -0,0 +1,43 @@
+# Copyright (c) 2021, Björn Franke
+#
+# This source code is licensed under the MIT license found in the
+# LICENSE file in the root directory of this source tree.
+
+import unittest
+
+from augmentum.benchmark_polybench_verification import (
+    POLYBENCH_OUT,
+    Polybench_Verifier,
+    polybench_digest,
+    polybench_digest_output,
+)
+
+# output of gemm built with POLYBENCH_DUMP_DIGEST for the reference problem size
+GEMM_DIGESTS = """==BEGIN DUMP_DIGESTS==
+digest: C 25309 d22bbf28ef3cd4bb
+==END   DUMP_DIGESTS==
+"""
+
+
+class TestPolybenchDigests(unittest.TestCase):
+    def test_fnv1a(self):
+        self.assertEqual(polybench_digest(""), "0 cbf29ce484222325")
+        self.assertEqual(polybench_digest("a"), "1 af63dc4c8601ec8c")
+
+    def test_digest_output(self):
+        self.assertEqual(polybench_digest_output("gemm"), GEMM_DIGESTS)
+
+        # one digest line per dumped array
+        regular = POLYBENCH_OUT["fdtd-2d"]["REGULAR"]
+        digests = polybench_digest_output("fdtd-2d")
+        self.assertEqual(regular.count("begin dump:"), digests.count("digest:"))
+
+    def test_verify(self):
+        verifier = Polybench_Verifier(digest=True)
+        self.assertTrue(verifier.verify("gemm", "some output\n" + GEMM_DIGESTS))
+        self.assertFalse(verifier.verify("gemm", GEMM_DIGESTS.replace("d22b", "d22c")))
+        self.assertFalse(verifier.verify("gemm", POLYBENCH_OUT["gemm"]["REGULAR"]))
+
+        self.assertTrue(
+            Polybench_Verifier().verify("gemm", POLYBENCH_OUT["gemm"]["REGULAR"])
+        )
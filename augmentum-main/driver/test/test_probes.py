@@ -4,14 +4,24 @@
 # LICENSE file in the root directory of this source tree.
 
 import unittest
-
-from augmentum.probes import get_struct_definitions_from_fntype
+from pathlib import Path
+
+from augmentum.function import Function, FunctionData
+from augmentum.probes import (
+    CombinedProbe,
+    NullProbe,
+    OffsetProbe,
+    StaticProbe,
+    get_struct_definitions_from_fntype,
+)
 from augmentum.type_descs import (
     ArrayTypeDesc,
     FunctionTypeDesc,
+    PointerTypeDesc,
     StructTypeDesc,
     i8_t,
     i32_t,
+    i64_t,
     void_t,
 )
 
@@ -264,3 +274,45 @@ struct  __augmentum__struct_0 { // MyStructA
             expected_code.strip(),
             "Generated code not as expected.",
         )
+
+
+class TestCombinedProbe(unittest.TestCase):
+    def setUp(self) -> None:
+        # int64_t f(int32_t*)
+        fn_type = FunctionTypeDesc(i64_t, PointerTypeDesc(i32_t))
+        fn_data = FunctionData("a.cpp", "_Z1fPi", "", "NA", "120", "instrument")
+        self.fun = Function("a.cpp", "_Z1fPi", fn_type, fn_data)
+        # int32_t g()
+        fn_type = FunctionTypeDesc(i32_t)
+        fn_data = FunctionData("b.cpp", "_Z1gv", "", "NA", "120", "instrument")
+        self.other = Function("b.cpp", "_Z1gv", fn_type, fn_data)
+
+        f_paths = {str(p): p for p in self.fun.get_paths()}
+        g_paths = {str(p): p for p in self.other.get_paths()}
+        self.probe = CombinedProbe(
+            [
+                StaticProbe(self.fun, f_paths["A0.D.T-i32"], "Prior", 7),
+                OffsetProbe(self.fun, f_paths["Z.T-i64"], "Prior", 5),
+                NullProbe(self.other, g_paths["Z.T-i32"], "Prior"),
+            ]
+        )
+
+    def test_extension_code(self):
+        code = self.probe.extension_code(Path("/tmp/probe.log"), Path("/src"))
+
+        # one listener finds all targets, targets of one function are chained
+        self.assertEqual(code.count("struct ProbeListener"), 1)
+        for i in range(3):
+            self.assertIn(f"namespace target_{i} {{", code)
+            self.assertIn(f"region->add({i}, ", code)
+        self.assertIn(
+            '{{"/src/a.cpp", "_Z1fPi"}, {{(Fn) &target_0::modified_function', code
+        )
+        self.assertIn('{{"/src/b.cpp", "_Z1gv"}, {{(Fn) &target_2::', code)
+
+    def test_split_exec_log(self):
+        exec_log = [["1", "40", "45", "2"], ["0", "3", "7", "1"]]
+        self.assertEqual(
+            self.probe.split_exec_log(exec_log),
+            [[["3", "7", "1"]], [["40", "45", "2"]], []],
+        )
@@ -0,0 +1,127 @@
+# Copyright (c) 2021, Björn Franke
+#
+# This source code is licensed under the MIT license found in the
+# LICENSE file in the root directory of this source tree.
+
+import os
+import tempfile
+import unittest
+from pathlib import Path
+
+from augmentum.scratch import ScratchSpace, TreeCloner, clone_tree
+
+
+class TestScratchSpace(unittest.TestCase):
+    def setUp(self) -> None:
+        self.tmp_dir = tempfile.TemporaryDirectory()
+        tmp = Path(self.tmp_dir.name)
+        self.persistent_dir = tmp / "worker"
+        self.persistent_dir.mkdir()
+        self.scratch = ScratchSpace(tmp / "scratch", self.persistent_dir)
+        self.scratch.setup()
+
+    def tearDown(self) -> None:
+        self.scratch.close()
+        self.tmp_dir.cleanup()
+
+    def test_recycle(self):
+        with self.scratch.probe_dir() as probe_wd:
+            (probe_wd / "sub").mkdir()
+            (probe_wd / "sub" / "extension.cpp").write_text("int x;")
+            (probe_wd / "probe.log").write_bytes(b"\0" * 8192)
+        first = probe_wd
+
+        with self.scratch.probe_dir() as probe_wd:
+            self.assertEqual(probe_wd, first)
+            self.assertEqual(list(probe_wd.iterdir()), [])
+        self.assertGreaterEqual(self.scratch.largest_probe, 8192)
+
+    def test_keep(self):
+        with self.scratch.probe_dir(keep=True) as probe_wd:
+            (probe_wd / "probe.log").write_text("log")
+
+        self.assertFalse(probe_wd.exists())
+        kept = list(self.persistent_dir.glob("probe_out*"))
+        self.assertEqual(len(kept), 1)
+        self.assertEqual((kept[0] / "probe.log").read_text(), "log")
+
+    def test_capacity_fallback(self):
+        self.scratch.capacity = 4096
+        with self.scratch.probe_dir() as probe_wd:
+            (probe_wd / "probe.log").write_bytes(b"\0" * 8192)
+
+        with self.scratch.probe_dir() as probe_wd:
+            self.assertEqual(probe_wd.parent, self.persistent_dir)
+        self.assertFalse(probe_wd.exists())
+
+    def test_running_count(self):
+        (self.scratch.benchmark_dir / "bench.x").write_bytes(b"\0" * 8192)
+        self.scratch.add_benchmark_copies()
+        benchmark_size = self.scratch.used
+        self.assertGreaterEqual(benchmark_size, 8192)
+
+        with self.scratch.probe_dir() as probe_wd:
+            (probe_wd / "probe.log").write_bytes(b"\0" * 8192)
+        self.assertEqual(self.scratch.used, benchmark_size)
+
+        with self.scratch.probe_dir() as probe_wd:
+            self.assertEqual(
+                self.scratch.used, benchmark_size + self.scratch.largest_probe
+            )
+        self.assertEqual(self.scratch.used, benchmark_size)
+
+        # benchmark copies leave no room for another probe
+        self.scratch.capacity = benchmark_size + self.scratch.largest_probe - 1
+        with self.scratch.probe_dir() as probe_wd:
+            self.assertEqual(probe_wd.parent, self.persistent_dir)
+        self.assertEqual(self.scratch.used, benchmark_size)
+
+
+class TestCloneTree(unittest.TestCase):
+    def setUp(self) -> None:
+        self.tmp_dir = tempfile.TemporaryDirectory()
+        self.src = Path(self.tmp_dir.name) / "src"
+        (self.src / "config").mkdir(parents=True)
+        (self.src / "config" / "make.def").write_text("CC = cc\n")
+        (self.src / "input.dat").write_text("42\n")
+        (self.src / "input.dat").chmod(0o444)
+        (self.src / "link").symlink_to("input.dat")
+
+    def tearDown(self) -> None:
+        self.tmp_dir.cleanup()
+
+    def test_clone(self):
+        dst = Path(self.tmp_dir.name) / "dst"
+        clone_tree(self.src, dst)
+
+        self.assertEqual((dst / "input.dat").read_text(), "42\n")
+        self.assertTrue((dst / "link").is_symlink())
+
+        # writes to writable files never reach the original
+        (dst / "config" / "make.def").write_text("CC = clang\n")
+        self.assertEqual((self.src / "config" / "make.def").read_text(), "CC = cc\n")
+
+        # metadata changes of read-only files never reach the original either
+        (dst / "input.dat").chmod(0o644)
+        self.assertEqual((self.src / "input.dat").stat().st_mode & 0o777, 0o444)
+
+    @unittest.skipIf(os.geteuid() == 0, "root never hardlinks")
+    def test_hardlink_opt_in(self):
+        dst = Path(self.tmp_dir.name) / "dst"
+        clone_tree(self.src, dst, hardlink=True)
+
+        self.assertEqual(
+            (dst / "input.dat").stat().st_ino, (self.src / "input.dat").stat().st_ino
+        )
+
+    def test_no_hardlinks(self):
+        cloner = TreeCloner(hardlink=False, reflink=False)
+        dst = Path(self.tmp_dir.name) / "dst"
+        cloner(str(self.src / "input.dat"), str(dst))
+
+        self.assertEqual(cloner.copied, 1)
+        self.assertNotEqual(dst.stat().st_ino, (self.src / "input.dat").stat().st_ino)
+
+
+if __name__ == "__main__":
+    unittest.main()
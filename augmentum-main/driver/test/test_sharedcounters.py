@@ -0,0 +1,107 @@
+# Copyright (c) 2021, Björn Franke
+#
+# This source code is licensed under the MIT license found in the
+# LICENSE file in the root directory of this source tree.
+
+import struct
+import subprocess
+import unittest
+from multiprocessing import shared_memory
+from pathlib import Path
+
+from augmentum.sharedcounters import (
+    HEADER,
+    KIND_DOUBLE,
+    KIND_FLOAT,
+    KIND_SIGNED,
+    MAGIC,
+    SLOT,
+    SLOT_READY,
+    SharedCounterRegion,
+    decode_value,
+    shared_counter_name,
+)
+
+
+def bits(fmt: str, value) -> int:
+    packed = struct.pack("<" + fmt, value)
+    return int.from_bytes(packed, "little")
+
+
+class TestSharedCounterRegion(unittest.TestCase):
+    def setUp(self) -> None:
+        self.name = shared_counter_name(Path(f"/tmp/test_sharedcounters/{id(self)}"))
+        self.region = SharedCounterRegion(self.name, capacity=8)
+
+    def tearDown(self) -> None:
+        self.region.close()
+
+    def write_slot(self, index: int, kind: int, first: int, second: int, count: int):
+        # stands in for an extension writing into the region
+        writer = shared_memory.SharedMemory(self.name)
+        SLOT.pack_into(
+            writer.buf,
+            HEADER.size + index * SLOT.size,
+            SLOT_READY,
+            kind,
+            0,
+            first,
+            second,
+            count,
+        )
+        writer.close()
+
+    def test_layout(self):
+        self.assertEqual(HEADER.size, 64)
+        self.assertEqual(SLOT.size, 48)
+        magic, _, capacity, used = HEADER.unpack_from(self.region.shm.buf, 0)
+        self.assertEqual(magic.to_bytes(8, "little"), b"AUGCTNR1")
+        self.assertEqual((magic, capacity, used), (MAGIC, 8, 0))
+
+    def test_decode(self):
+        self.assertEqual(decode_value(KIND_SIGNED, bits("q", -3)), "-3")
+        self.assertEqual(decode_value(KIND_FLOAT, bits("f", 0.1)), "0.1")
+        self.assertEqual(decode_value(KIND_DOUBLE, bits("d", 1e-7)), "1e-07")
+        self.assertEqual(decode_value(KIND_DOUBLE, bits("d", 2.5)), "2.5")
+
+    def test_entries_and_reset(self):
+        self.assertEqual(list(self.region.entries()), [])
+        self.write_slot(5, KIND_SIGNED, bits("q", -1), 4, 3)
+        self.write_slot(2, KIND_DOUBLE, bits("d", 0.5), bits("d", 1.0), 7)
+        self.assertEqual(
+            list(self.region.log_entries()), [("0.5", "1", "7"), ("-1", "4", "3")]
+        )
+
+        self.region.reset()
+        self.assertEqual(list(self.region.entries()), [])
+
+    def test_replaces_stale_region(self):
+        self.write_slot(0, KIND_SIGNED, 1, 2, 3)
+        # the region of an earlier run that was not closed
+        stale = self.region.shm
+        self.region.shm = None
+        try:
+            with SharedCounterRegion(self.name, capacity=8) as region:
+                self.assertEqual(list(region.entries()), [])
+        finally:
+            stale.close()
+
+    def test_native_writer(self):
+        # values added by libaugmentum, see extensions/test/value-writer.cpp
+        with SharedCounterRegion(self.name + "_native", capacity=64) as region:
+            subprocess.run(
+                ["test/native/value-writer", "counters", region.name], check=True
+            )
+            self.assertEqual(
+                sorted(region.log_entries(with_point=True)),
+                [
+                    ("0", "-1", "-7", "3"),
+                    ("1", "-300", "2", "1"),
+                    ("2", "-1", "-7", "3"),
+                    ("3", "-5", "5", "2"),
+                    ("4", "255", "1", "1"),
+                    ("5", "4294967295", "0", "1"),
+                    ("6", "-0.5", "2", "4"),
+                    ("7", "-2.5", "0.25", "5"),
+                ],
+            )
@@ -0,0 +1,73 @@
+# Copyright (c) 2021, Björn Franke
+#
+# This source code is licensed under the MIT license found in the
+# LICENSE file in the root directory of this source tree.
+
+import itertools
+import unittest
+
+from augmentum.targetfilter import TargetFilter
+
+FILTER_SPEC = """type;module;function;path;comment
+BLOCK_REX;;;".+T-f32";"Block all paths that have a float type"
+BLOCK_REX;"^lib\\/Vectorize.+";;;"Block all functions and paths from folder"
+BLOCK;lib/Analysis/LoopInfo.cpp;_Z3foov;Z.L.T-i8;"Block this specific target"
+ALLOW;lib/Utils/LoopUtils.cpp;_Z3barv;Z.T-i1;"Allow this specific channel"
+ALLOW;lib/Analysis/LoopInfo.cpp;;;"Allow all functions and paths from this module"
+ALLOW;;_Z3bazv;;"Allow all paths for this function from all modules"
+ALLOW_REX;lib/Utils/LoopUtils.cpp;_Z3barv;"Z\\.S0(\\.L|\\.R)*\\.T-i(32|16|8)";"Paths"
+"""
+
+MODULES = [
+    "lib/Analysis/LoopInfo.cpp",
+    "lib/Utils/LoopUtils.cpp",
+    "lib/Vectorize/SLP.cpp",
+    "lib/Other.cpp",
+]
+FUNCTIONS = ["_Z3foov", "_Z3barv", "_Z3bazv"]
+PATHS = ["Z.L.T-i8", "Z.T-i1", "Z.S0.L.R.T-i16", "Z.S0.T-i64", "A0.T-f32", "Z.T-i32"]
+
+
+def reference_should_evaluate(
+    tfilter: TargetFilter, module: str, function: str, path: str
+) -> bool:
+    """Straight forward evaluation of all filter entries one at a time."""
+    if any(e.match(module, function, path) for e in tfilter.block_list):
+        return False
+    if len(tfilter.allow_list) == 0:
+        return True
+    return any(e.match(module, function, path) for e in tfilter.allow_list)
+
+
+class TestTargetFilter(unittest.TestCase):
+    def check_against_reference(self, spec: str):
+        tfilter = TargetFilter(spec.splitlines())
+        for m, f in itertools.product(MODULES, FUNCTIONS):
+            expected = [p for p in PATHS if reference_should_evaluate(tfilter, m, f, p)]
+            self.assertEqual(tfilter.filter_paths(m, f, PATHS), expected, f"{m} {f}")
+            for p in PATHS:
+                self.assertEqual(tfilter.should_evaluate(m, f, p), p in expected)
+
+    def test_block_and_allow(self):
+        self.check_against_reference(FILTER_SPEC)
+
+        tfilter = TargetFilter(FILTER_SPEC.splitlines())
+        self.assertEqual(
+            tfilter.filter_paths("lib/Utils/LoopUtils.cpp", "_Z3barv", PATHS),
+            ["Z.T-i1", "Z.S0.L.R.T-i16"],
+        )
+        self.assertEqual(
+            tfilter.filter_paths("lib/Vectorize/SLP.cpp", "_Z3bazv", PATHS), []
+        )
+
+    def test_block_only(self):
+        block_only = "\n".join(
+            line for line in FILTER_SPEC.splitlines() if not line.startswith("ALLOW")
+        )
+        self.check_against_reference(block_only)
+
+        tfilter = TargetFilter(block_only.splitlines())
+        self.assertEqual(
+            tfilter.filter_paths("lib/Other.cpp", "_Z3foov", PATHS),
+            [p for p in PATHS if p != "A0.T-f32"],
+        )
@@ -0,0 +1,100 @@
+# Copyright (c) 2021, Björn Franke
+#
+# This source code is licensed under the MIT license found in the
+# LICENSE file in the root directory of this source tree.
+
+import socket
+import struct
+import subprocess
+import threading
+import unittest
+from pathlib import Path
+
+from augmentum.sharedcounters import KIND_DOUBLE, KIND_SIGNED
+from augmentum.telemetry import (
+    EVENT_ATTACH,
+    EVENT_TRACE,
+    EVENT_VALUE_COUNT,
+    FRAME_HEADER,
+    MAGIC,
+    VALUE_COUNT,
+    VERSION,
+    TelemetryCollector,
+    telemetry_name,
+)
+
+
+def frame(type: int, payload: bytes = b"", pid: int = 42) -> bytes:
+    return FRAME_HEADER.pack(MAGIC, VERSION, type, pid, len(payload)) + payload
+
+
+class TestTelemetryCollector(unittest.TestCase):
+    def setUp(self) -> None:
+        self.name = telemetry_name(Path(f"/tmp/test_telemetry/{id(self)}"))
+        self.received = threading.Semaphore(0)
+        self.collector = TelemetryCollector(
+            self.name, lambda _: self.received.release()
+        )
+        # stands in for an instrumented process
+        self.sender = socket.socket(socket.AF_UNIX, socket.SOCK_DGRAM)
+        self.sender.connect("\0" + self.name)
+
+    def tearDown(self) -> None:
+        self.sender.close()
+        self.collector.close()
+
+    def test_log_entries(self):
+        self.sender.send(frame(EVENT_ATTACH))
+        value = struct.unpack("<Q", struct.pack("<d", 0.25))[0]
+        self.sender.send(
+            frame(EVENT_VALUE_COUNT, VALUE_COUNT.pack(KIND_DOUBLE, 0, value, value, 3))
+        )
+        self.sender.send(
+            frame(EVENT_VALUE_COUNT, VALUE_COUNT.pack(KIND_SIGNED, 0, 2**64 - 1, 5, 1))
+        )
+        self.sender.send(frame(EVENT_TRACE, b"lib/Foo.cpp\0_Z3foov\0"))
+
+        self.assertTrue(self.received.acquire(timeout=5))
+        self.assertEqual(self.collector.processes, {42})
+
+        events = self.collector.take_events()
+        self.assertEqual(
+            [e.log_entry() for e in events],
+            [("0.25", "0.25", "3"), ("-1", "5", "1"), ("lib/Foo.cpp", "_Z3foov")],
+        )
+        self.assertEqual(self.collector.take_events(), [])
+
+    def test_native_writer(self):
+        # values sent by libaugmentum, see extensions/test/value-writer.cpp
+        subprocess.run(["test/native/value-writer", "telemetry", self.name], check=True)
+
+        events = self.collector.take_events()
+        self.assertEqual(
+            sorted(e.log_entry(with_point=True) for e in events),
+            [
+                ("0", "-1", "-7", "3"),
+                ("1", "-300", "2", "1"),
+                ("2", "-1", "-7", "3"),
+                ("3", "-5", "5", "2"),
+                ("4", "255", "1", "1"),
+                ("5", "4294967295", "0", "1"),
+                ("6", "-0.5", "2", "4"),
+                ("7", "-2.5", "0.25", "5"),
+            ],
+        )
+
+    def test_malformed_frames_dropped(self):
+        self.sender.send(b"nonsense")
+        self.sender.send(frame(EVENT_VALUE_COUNT, b"short"))
+        self.sender.send(frame(EVENT_TRACE, b"unterminated"))
+        self.sender.send(frame(EVENT_ATTACH, pid=7))
+
+        self.assertTrue(self.received.acquire(timeout=5))
+        self.assertEqual(self.collector.dropped, 3)
+        self.assertEqual(self.collector.take_events(), [])
+        self.assertEqual(self.collector.dropped, 0)
+
+    def test_no_collector(self):
+        self.collector.close()
+        with self.assertRaises(ConnectionRefusedError):
+            self.sender.send(frame(EVENT_ATTACH))
@@ -0,0 +1,105 @@
+# Copyright (c) 2021, Björn Franke
+#
+# This source code is licensed under the MIT license found in the
+# LICENSE file in the root directory of this source tree.
+
+import tempfile
+import unittest
+from pathlib import Path
+
+from augmentum.function import Function, FunctionData
+from augmentum.tunings import (
+    ACTION_ADD,
+    ACTION_SCALE,
+    ACTION_SET,
+    LEAF_FLOAT,
+    LEAF_INT,
+    ROOT_ARG,
+    ROOT_RESULT,
+    STEP_DEREF,
+    STEP_ELEM,
+    STEP_RIGHT,
+    compile_tunings,
+    read_tuning_targets,
+    read_tunings,
+    struct_layout,
+    write_tunings,
+)
+from augmentum.type_descs import (
+    FunctionTypeDesc,
+    PointerTypeDesc,
+    StructTypeDesc,
+    double_t,
+    i8_t,
+    i32_t,
+    i64_t,
+)
+
+
+class TestTunings(unittest.TestCase):
+    def setUp(self) -> None:
+        # struct S { int8_t a; double b; int32_t c; }
+        self.struct_td = StructTypeDesc(
+            "a.cpp", "S", False, False, i8_t, double_t, i32_t
+        )
+        # int64_t f(S*)
+        fn_type = FunctionTypeDesc(i64_t, PointerTypeDesc(self.struct_td))
+        fn_data = FunctionData("a.cpp", "_Z1fP1S", "", "NA", "120", "instrument")
+        self.fun = Function("a.cpp", "_Z1fP1S", fn_type, fn_data)
+
+    def find(self, module: str, name: str):
+        if (module, name) == (self.fun.module, self.fun.name):
+            return self.fun
+        return None
+
+    def test_layout(self):
+        self.assertEqual(struct_layout(self.struct_td), ([0, 8, 16], 24, 8))
+        packed = StructTypeDesc("a.cpp", "P", False, True, i8_t, double_t, i32_t)
+        self.assertEqual(struct_layout(packed), ([0, 1, 9], 13, 1))
+
+    def test_compile(self):
+        rows = [
+            ("a.cpp", "_Z1fP1S", "Z.R.T-i32", "Integer Offset Prior", "2,6"),
+            ("a.cpp", "_Z1fP1S", "A0.D.S1.T-f64", "Real Scale Prior", "0.5,0.5"),
+            ("a.cpp", "_Z1fP1S", "A0.D.S2.T-i32", "Integer Range Prior", "0,9", "7"),
+            # unknown function and path are skipped
+            ("a.cpp", "_Z1gv", "Z.T-i32", "Integer Range Prior", "0,1"),
+            ("a.cpp", "_Z1fP1S", "A0.D.S3.T-i32", "Integer Range Prior", "0,1"),
+        ]
+        tunings = compile_tunings(self.find, rows, Path("/src"))
+        self.assertEqual(len(tunings), 3)
+
+        ret, scale, static = tunings
+        self.assertEqual(ret.module, "/src/a.cpp")
+        self.assertEqual((ret.root, ret.leaf, ret.bits), (ROOT_RESULT, LEAF_INT, 32))
+        self.assertEqual(ret.steps, ((STEP_RIGHT, 0, 4),))
+        self.assertEqual((ret.action, ret.value), (ACTION_ADD, 2))
+
+        self.assertEqual((scale.root, scale.arg_index), (ROOT_ARG, 0))
+        self.assertEqual(scale.steps, ((STEP_DEREF, 0, 0), (STEP_ELEM, 1, 8)))
+        self.assertEqual((scale.leaf, scale.bits), (LEAF_FLOAT, 64))
+        self.assertEqual((scale.action, scale.value), (ACTION_SCALE, 1.0))
+
+        self.assertEqual(static.steps[-1], (STEP_ELEM, 2, 16))
+        self.assertEqual((static.action, static.value), (ACTION_SET, 7))
+
+        with tempfile.TemporaryDirectory() as tmp_dir:
+            file = Path(tmp_dir) / "tunings.bin"
+            write_tunings(tunings, file)
+            self.assertEqual(read_tunings(file), tunings)
+
+    def test_read_targets(self):
+        with tempfile.TemporaryDirectory() as tmp_dir:
+            file = Path(tmp_dir) / "ALL_tuning_targets.csv"
+            file.write_text(
+                "module,function,path,prior,data\n"
+                'a.cpp,_Z1fP1S,Z.T-i64,Integer Range Prior,"0,4"\n'
+            )
+            rows = list(read_tuning_targets(file))
+        self.assertEqual(
+            rows, [["a.cpp", "_Z1fP1S", "Z.T-i64", "Integer Range Prior", "0,4"]]
+        )
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,125 @@
+# Copyright (c) 2021, Björn Franke
+#
+# This source code is licensed under the MIT license found in the
+# LICENSE file in the root directory of this source tree.
+
+import multiprocessing as mp
+import os
+import pickle
+import tempfile
+import time
+import unittest
+from pathlib import Path
+from unittest import mock
+
+from augmentum.workqueue import RECORD_HEADER, SharedWorkQueue, task_digest
+
+TASKS = [("a.cpp", f"_Z1fv{i}", "R") for i in range(50)]
+
+
+def evaluate_tasks(queue_dir: Path):
+    """Claim and finish tasks like a cooperating driver would."""
+    queue = SharedWorkQueue(queue_dir)
+    for task in TASKS:
+        if queue.try_claim(*task):
+            queue.complete(*task, (task, os.getpid()))
+    queue.close()
+
+
+class TestSharedWorkQueue(unittest.TestCase):
+    def setUp(self) -> None:
+        self.tmp_dir = tempfile.TemporaryDirectory()
+        self.queue_dir = Path(self.tmp_dir.name)
+
+    def tearDown(self) -> None:
+        self.tmp_dir.cleanup()
+
+    def test_cooperating_processes(self):
+        procs = [
+            mp.Process(target=evaluate_tasks, args=(self.queue_dir,)) for _ in range(4)
+        ]
+        for p in procs:
+            p.start()
+        for p in procs:
+            p.join()
+            self.assertEqual(p.exitcode, 0)
+
+        main = SharedWorkQueue(self.queue_dir)
+        records = main.read_results()
+        # every task was evaluated exactly once
+        self.assertEqual(sorted([task for task, _ in records]), sorted(TASKS))
+        self.assertEqual(main.done_tasks(), {task_digest(*t) for t in TASKS})
+        self.assertEqual(list((self.queue_dir / "leases").iterdir()), [])
+
+        # shards are only read once, appended records are picked up later
+        self.assertEqual(main.read_results(), [])
+        other = SharedWorkQueue(self.queue_dir)
+        other.owner = "other_host_1"
+        other.shard_file = other.result_dir / "other_host_1.shard"
+        other.complete("b.cpp", "g", "R", "late")
+        self.assertEqual(main.read_results(), ["late"])
+
+    def test_partial_record(self):
+        queue = SharedWorkQueue(self.queue_dir)
+        queue.complete(*TASKS[0], "first")
+
+        # a record another driver is still writing is read once complete
+        payload = pickle.dumps("second")
+        record = RECORD_HEADER.pack(len(payload)) + payload
+        with queue.shard_file.open("ab") as shard:
+            shard.write(record[:5])
+        self.assertEqual(queue.read_results(), ["first"])
+
+        with queue.shard_file.open("ab") as shard:
+            shard.write(record[5:])
+        self.assertEqual(queue.read_results(), ["second"])
+
+    def test_lease(self):
+        first = SharedWorkQueue(self.queue_dir)
+        second = SharedWorkQueue(self.queue_dir)
+        second.owner = "other_host_1"
+
+        self.assertTrue(first.try_claim(*TASKS[0]))
+        self.assertFalse(second.try_claim(*TASKS[0]))
+
+        # leases without heartbeat expire and can be taken over
+        lease = first.lease_file(task_digest(*TASKS[0]))
+        os.utime(lease, (0, 0))
+        self.assertTrue(second.try_claim(*TASKS[0]))
+        self.assertEqual(lease.read_text().strip(), "other_host_1")
+
+        self.assertTrue(first.heartbeat(force=True))
+        second.close()
+        self.assertFalse(lease.exists())
+        self.assertTrue(first.try_claim(*TASKS[0]))
+
+    def test_lease_clock_skew(self):
+        first = SharedWorkQueue(self.queue_dir)
+        second = SharedWorkQueue(self.queue_dir)
+        second.owner = "other_host_1"
+        self.assertTrue(first.try_claim(*TASKS[0]))
+
+        # a host clock running ahead does not expire live leases
+        with mock.patch("time.time", return_value=time.time() + 3600):
+            self.assertFalse(second.try_claim(*TASKS[0]))
+
+    def test_heartbeat_thread(self):
+        first = SharedWorkQueue(self.queue_dir, lease_timeout=0.4)
+        second = SharedWorkQueue(self.queue_dir, lease_timeout=0.4)
+        second.owner = "other_host_1"
+        self.assertTrue(first.try_claim(*TASKS[0]))
+
+        # leases stay fresh while the owner is busy elsewhere
+        first.start_heartbeat()
+        lease = first.lease_file(task_digest(*TASKS[0]))
+        os.utime(lease, (0, 0))
+        time.sleep(0.5)
+        self.assertFalse(second.try_claim(*TASKS[0]))
+
+        first.close()
+        self.assertIsNone(first.heartbeat_thread)
+        self.assertTrue(second.try_claim(*TASKS[0]))
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,166 @@
+/* Copyright (c) 2021, Björn Franke
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "aggregator.h"
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+
+namespace augmentum {
+
+namespace {
+const size_t INITIAL_CAPACITY = 64;  // power of two
+const size_t THREAD_CACHE_SIZE = 8;  // power of two
+
+std::atomic<uint64_t> next_aggregator_id(1);
+
+struct PairHash {
+  size_t operator()(const std::pair<uint64_t, uint64_t>& p) const {
+    uint64_t h = p.first * 0x9e3779b97f4a7c15ULL;
+    h ^= p.second + 0x632be59bd9b4e019ULL + (h << 6) + (h >> 2);
+    h ^= h >> 29;
+    h *= 0xbf58476d1ce4e5b9ULL;
+    return h ^ (h >> 32);
+  }
+};
+
+/**
+ * Tables recently used by this thread, indexed by aggregator id.
+ * Ids are never reused, so entries of destroyed aggregators can never match
+ * again. Trivially destructible on purpose, see ValueAggregator.
+ */
+struct CachedTable {
+  uint64_t aggregator_id;
+  ValueAggregator::Table* table;
+};
+thread_local CachedTable thread_cache[THREAD_CACHE_SIZE];
+}  // namespace
+
+/**
+ * Open addressing table with linear probing, written by a single thread.
+ * A count of zero marks an empty slot.
+ */
+struct ValueAggregator::Table {
+  struct Slot {
+    uint64_t first;
+    uint64_t second;
+    uint64_t count;
+  };
+
+  explicit Table(std::thread::id owner)
+      : owner(owner), slots(new Slot[INITIAL_CAPACITY]()), mask(INITIAL_CAPACITY - 1), used(0) {}
+
+  void add(uint64_t first, uint64_t second, uint64_t count) {
+    size_t i = PairHash()(std::make_pair(first, second)) & mask;
+    while (slots[i].count != 0) {
+      if (slots[i].first == first && slots[i].second == second) {
+        slots[i].count += count;
+        return;
+      }
+      i = (i + 1) & mask;
+    }
+    slots[i] = {first, second, count};
+    if (++used * 2 > mask + 1) {
+      grow();
+    }
+  }
+
+  void grow() {
+    std::unique_ptr<Slot[]> old(slots.release());
+    size_t old_capacity = mask + 1;
+    slots.reset(new Slot[old_capacity * 2]());
+    mask = old_capacity * 2 - 1;
+    used = 0;
+    for (size_t i = 0; i < old_capacity; ++i) {
+      if (old[i].count != 0) {
+        add(old[i].first, old[i].second, old[i].count);
+      }
+    }
+  }
+
+  void clear() {
+    if (used == 0) {
+      return;
+    }
+    for (size_t i = 0; i <= mask; ++i) {
+      slots[i].count = 0;
+    }
+    used = 0;
+  }
+
+  const std::thread::id owner;
+  std::unique_ptr<Slot[]> slots;
+  size_t mask;
+  size_t used;
+};
+
+ValueAggregator::ValueAggregator() : id(next_aggregator_id++) {}
+
+ValueAggregator::~ValueAggregator() {
+  for (Table* table : tables) {
+    delete table;
+  }
+}
+
+void ValueAggregator::record(uint64_t first, uint64_t second) {
+  CachedTable& cached = thread_cache[id & (THREAD_CACHE_SIZE - 1)];
+  Table* table = cached.aggregator_id == id ? cached.table : thread_table();
+  table->add(first, second, 1);
+}
+
+ValueAggregator::Table* ValueAggregator::thread_table() {
+  // slow path, taken on the first record of a thread or after cache eviction
+  std::thread::id self = std::this_thread::get_id();
+  Table* table = nullptr;
+  {
+    const std::lock_guard<std::mutex> lock(tables_mutex);
+    for (Table* t : tables) {
+      if (t->owner == self) {
+        table = t;
+        break;
+      }
+    }
+    if (table == nullptr) {
+      table = new Table(self);
+      tables.push_back(table);
+    }
+  }
+  thread_cache[id & (THREAD_CACHE_SIZE - 1)] = {id, table};
+  return table;
+}
+
+void ValueAggregator::drain(const Sink& sink) {
+  const std::lock_guard<std::mutex> lock(tables_mutex);
+  if (tables.size() == 1) {
+    Table& table = *tables.front();
+    for (size_t i = 0; i <= table.mask; ++i) {
+      if (table.slots[i].count != 0) {
+        sink(table.slots[i].first, table.slots[i].second, table.slots[i].count);
+      }
+    }
+    table.clear();
+    return;
+  }
+
+  std::unordered_map<std::pair<uint64_t, uint64_t>, uint64_t, PairHash> merged;
+  for (Table* table : tables) {
+    for (size_t i = 0; i <= table->mask; ++i) {
+      if (table->slots[i].count != 0) {
+        merged[std::make_pair(table->slots[i].first, table->slots[i].second)] +=
+            table->slots[i].count;
+      }
+    }
+    table->clear();
+  }
+  for (auto& [key, count] : merged) {
+    sink(key.first, key.second, count);
+  }
+}
+
+}  // namespace augmentum
@@ -0,0 +1,104 @@
+/* Copyright (c) 2021, Björn Franke
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#ifndef __AUGMENTUM_AGGREGATOR__
+#define __AUGMENTUM_AGGREGATOR__
+
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <type_traits>
+#include <vector>
+
+namespace augmentum {
+
+/**
+ * Counts how often pairs of 64 bit values are recorded.
+ * Every thread records into its own small open addressing table, so recording
+ * takes no lock and never contends with other threads. The tables are owned by
+ * the aggregator and only merged when `drain` is called, which is meant to
+ * happen rarely, e.g. when an extension point is unregistered.
+ * `drain` must not run concurrently with `record` on the same aggregator.
+ * The per thread state is kept in the augmentum library and needs no
+ * destruction at thread exit, which keeps extensions using an aggregator
+ * unloadable.
+ */
+struct ValueAggregator {
+  typedef std::function<void(uint64_t, uint64_t, uint64_t)> Sink;
+  struct Table;
+
+  ValueAggregator();
+  ~ValueAggregator();
+  ValueAggregator(const ValueAggregator&) = delete;
+  ValueAggregator& operator=(const ValueAggregator&) = delete;
+
+  /**
+   * Count one occurrence of the given pair.
+   */
+  void record(uint64_t first, uint64_t second);
+  /**
+   * Merge the counts of all threads, pass every pair with its count to sink
+   * and reset all counts.
+   */
+  void drain(const Sink& sink);
+
+ private:
+  Table* thread_table();
+
+  const uint64_t id;
+  std::mutex tables_mutex;  // protects tables
+  std::vector<Table*> tables;
+};
+
+/**
+ * Bit pattern of a scalar value of at most 64 bits. Signed integers are sign
+ * extended, so readers can decode them as 64 bit integers, others are zero
+ * extended.
+ */
+template <typename T>
+uint64_t to_value_bits(T value) {
+  static_assert(std::is_trivially_copyable<T>::value && sizeof(T) <= sizeof(uint64_t),
+                "Only scalar values of at most 64 bits are supported");
+  if constexpr (std::is_integral<T>::value && std::is_signed<T>::value) {
+    return static_cast<uint64_t>(static_cast<int64_t>(value));
+  }
+  uint64_t bits = 0;
+  std::memcpy(&bits, &value, sizeof(T));
+  return bits;
+}
+
+template <typename T>
+T from_value_bits(uint64_t bits) {
+  T value;
+  std::memcpy(&value, &bits, sizeof(T));
+  return value;
+}
+
+/**
+ * Typed front end of the ValueAggregator for scalar probe values.
+ * Values are compared by their bit pattern.
+ */
+template <typename T>
+struct ValueCounter {
+  void record(T first, T second) {
+    aggregator.record(to_value_bits(first), to_value_bits(second));
+  }
+
+  template <typename F>
+  void drain(F sink) {
+    aggregator.drain([&sink](uint64_t first, uint64_t second, uint64_t count) {
+      sink(from_value_bits<T>(first), from_value_bits<T>(second), count);
+    });
+  }
+
+ private:
+  ValueAggregator aggregator;
+};
+
+}  // namespace augmentum
+
+#endif
@@ -6,6 +6,12 @@
 
 #include "augmentum.h"
 
+#include <dlfcn.h>
+
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
 #include <vector>
 
 using namespace augmentum;
@@ -119,6 +125,29 @@ std::vector<Listener*>& listeners() {
   return list;
 }
 
+/**
+ * An extension library loaded by reload_extension and the listeners it added.
+ */
+struct LoadedExtension {
+  std::string path;
+  void* handle = nullptr;
+  std::vector<Listener*> listeners;
+};
+
+LoadedExtension& loaded_extension() {
+  static auto* extension = new LoadedExtension();
+  return *extension;
+}
+
+std::mutex reload_mutex;  // serialises reload_extension and unload_extension
+
+/**
+ * While an extension library is loaded by reload_extension, the listeners it
+ * adds are collected here instead of being notified of existing extension
+ * points, together with whether they asked for that notification.
+ */
+std::vector<std::pair<Listener*, bool>>* deferred_listeners = nullptr;
+
 /**
  * The extension points that have been registered.
  */
@@ -126,6 +155,24 @@ std::unordered_map<std::string, FnExtensionPoint*>& registry() {
   static auto* reg = new std::unordered_map<std::string, FnExtensionPoint*>();
   return *reg;
 };
+/**
+ * The data extension points that have been registered.
+ */
+std::unordered_map<std::string, DataExtensionPoint*>& data_registry() {
+  static auto* reg = new std::unordered_map<std::string, DataExtensionPoint*>();
+  return *reg;
+};
+/**
+ * Notify a listener of all extension points registered so far.
+ */
+void notify_registered(Listener& listener) {
+  for (auto& [k, v] : registry()) {
+    listener.on_extension_point_register(*v);
+  }
+  for (auto& [k, v] : data_registry()) {
+    listener.on_data_extension_point_register(*v);
+  }
+}
 /**
  * At the end of the program, make sure to unregister all the extension points.
  */
@@ -140,6 +187,16 @@ __attribute__((destructor)) void empty_registry() {
   }
   registry().clear();
   delete &registry();
+  for (auto& [s, pt] : data_registry()) {
+    for (auto listener : listeners()) {
+      listener->on_data_extension_point_unregister(*pt);
+    }
+    pt->reset();
+    delete pt;
+    pt = nullptr;
+  }
+  data_registry().clear();
+  delete &data_registry();
   // TODO: delete all types?
 }
 
@@ -166,10 +223,10 @@ AdviceId augmentum::get_unique_advice_id() {
 
 void Listener::add(bool notify_existing_extension_points) {
   listeners().push_back(this);
-  if (notify_existing_extension_points) {
-    for (auto& [k, v] : registry()) {
-      on_extension_point_register(*v);
-    }
+  if (deferred_listeners != nullptr) {
+    deferred_listeners->emplace_back(this, notify_existing_extension_points);
+  } else if (notify_existing_extension_points) {
+    notify_registered(*this);
   }
   added = true;
 }
@@ -186,13 +243,78 @@ void Listener::remove(bool notify_existing_extension_points) {
       for (auto kv : registry()) {
         on_extension_point_unregister(*kv.second);
       }
+      for (auto kv : data_registry()) {
+        on_data_extension_point_unregister(*kv.second);
+      }
     }
   }
   added = false;
 }
 
+static void unload_loaded_extension() {
+  LoadedExtension& extension = loaded_extension();
+  if (extension.handle == nullptr) {
+    return;
+  }
+  // remove explicitly, the library may stay resident after closing it
+  for (Listener* listener : extension.listeners) {
+    auto& active = listeners();
+    if (std::find(active.begin(), active.end(), listener) != active.end()) {
+      listener->remove();
+    }
+  }
+  dlclose(extension.handle);
+  extension = LoadedExtension();
+}
+
+void augmentum::reload_extension(const std::string& path) {
+  const std::lock_guard<std::mutex> lock(reload_mutex);
+  if (loaded_extension().path == path) {
+    // the library would not be initialised again while it is still open
+    unload_loaded_extension();
+  }
+  // opening a library which is still resident runs no constructors, so its
+  // listeners would never be added
+  void* resident = dlopen(path.c_str(), RTLD_NOW | RTLD_NOLOAD);
+  if (resident != nullptr) {
+    dlclose(resident);
+    throw std::runtime_error("Extension is still resident and cannot be loaded again: " + path);
+  }
+
+  std::vector<std::pair<Listener*, bool>> added;
+  deferred_listeners = &added;
+  void* handle = dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+  deferred_listeners = nullptr;
+  if (handle == nullptr) {
+    const char* error = dlerror();
+    throw std::runtime_error("Loading extension failed: " + std::string(error ? error : path));
+  }
+
+  unload_loaded_extension();
+
+  LoadedExtension& extension = loaded_extension();
+  extension.path = path;
+  extension.handle = handle;
+  for (auto& [listener, notify] : added) {
+    extension.listeners.push_back(listener);
+    if (notify) {
+      notify_registered(*listener);
+    }
+  }
+}
+
+void augmentum::unload_extension() {
+  const std::lock_guard<std::mutex> lock(reload_mutex);
+  unload_loaded_extension();
+}
+
 void FnExtensionPoint::register_extension_point(FnExtensionPoint& pt) {
-  registry()[key_for_pt(pt)] = &pt;
+  // coalesced extension points of different shared libraries have the same key
+  auto key = key_for_pt(pt);
+  for (int copy = 1; registry().count(key) != 0; ++copy) {
+    key = key_for_pt(pt) + "#" + std::to_string(copy);
+  }
+  registry()[key] = &pt;
   for (auto listener : listeners()) {
     listener->on_extension_point_register(pt);
   }
@@ -203,7 +325,68 @@ void FnExtensionPoint::unregister_extension_point(FnExtensionPoint& pt) {
     listener->on_extension_point_unregister(pt);
   }
   pt.reset();
-  registry().erase(key_for_pt(pt));
+  for (auto it = registry().begin(); it != registry().end(); ++it) {
+    if (it->second == &pt) {
+      registry().erase(it);
+      break;
+    }
+  }
+}
+
+DataExtensionPoint::DataExtensionPoint(std::string module_name, std::string name,
+                                       TypeDesc* type_desc, void* slot, size_t size, bool indirect)
+    : module_name(module_name),
+      name(name),
+      type_desc(type_desc),
+      slot(slot),
+      size(size),
+      indirect(indirect),
+      value(size) {
+  if (indirect) {
+    original_address = *static_cast<void**>(slot);
+  } else {
+    std::memcpy(value.data(), slot, size);
+  }
+}
+
+DataExtensionPoint* DataExtensionPoint::get(const std::string& module_name,
+                                            const std::string& name) {
+  auto it = data_registry().find(module_name + "::" + name);
+  return it == data_registry().end() ? nullptr : it->second;
+}
+
+void DataExtensionPoint::register_extension_point(DataExtensionPoint& pt) {
+  data_registry()[pt.get_module_name() + "::" + pt.get_name()] = &pt;
+  for (auto listener : listeners()) {
+    listener->on_data_extension_point_register(pt);
+  }
+}
+
+void DataExtensionPoint::read(void* result) const {
+  const void* current = indirect ? *static_cast<void* const*>(slot) : slot;
+  std::memcpy(result, current, size);
+}
+
+void DataExtensionPoint::override(const void* new_value) {
+  if (indirect) {
+    std::memcpy(value.data(), new_value, size);
+    *static_cast<void**>(slot) = value.data();
+  } else {
+    std::memcpy(slot, new_value, size);
+  }
+  overridden = true;
+}
+
+void DataExtensionPoint::reset() {
+  if (!overridden) {
+    return;
+  }
+  if (indirect) {
+    *static_cast<void**>(slot) = original_address;
+  } else {
+    std::memcpy(slot, value.data(), size);
+  }
+  overridden = false;
 }
 
 void FnExtensionPoint::reset() {
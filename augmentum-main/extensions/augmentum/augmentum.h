@@ -11,6 +11,7 @@
 #include <functional>
 #include <iostream>
 #include <list>
+#include <stdexcept>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -19,6 +20,7 @@
 
 namespace augmentum {
 struct FnExtensionPoint;
+struct DataExtensionPoint;
 struct Listener;
 
 typedef void (*Fn)();
@@ -248,6 +250,111 @@ struct FnExtensionPoint {
   static void empty_registry();
 };
 
+/**
+ * Extension Points for data
+ * The instrumenter will create one of these for every global and immediate
+ * constant selected in its data target file. Instrumented loads of the value go
+ * through a slot, so overriding it costs readers a load instead of a function
+ * extension. This is meant for thresholds of heuristics, like the storage of
+ * `cl::opt`s or the constants they are compared against.
+ * Globals are named by their symbol, followed by "+<offset>" for values at an
+ * offset into the global. Their slot points to the global, so that writes to
+ * it, e.g. when parsing options, are seen until the value is overridden.
+ * Immediates are named "<function>:<value>" and their slot holds the value.
+ * Like extending, overriding is not synchronised with the loads of other
+ * threads.
+ */
+struct DataExtensionPoint {
+  /**
+   * Get an extension point.
+   */
+  static DataExtensionPoint* get(const std::string& module_name, const std::string& name);
+  /**
+   * Get the type of the value.
+   */
+  const TypeDesc& get_type() const { return *type_desc; }
+  /**
+   * Get the name of the extension point.
+   */
+  const std::string get_name() const { return name; }
+  /**
+   * Get the name of the module whose loads go through this extension point.
+   */
+  const std::string get_module_name() const { return module_name; }
+  /**
+   * Get the size of the value in bytes.
+   */
+  size_t get_size() const { return size; }
+  /**
+   * Check if the value has been overridden.
+   */
+  bool is_overridden() const { return overridden; }
+  /**
+   * Copy the value currently seen by instrumented loads to `value`, which must
+   * have space for `get_size()` bytes.
+   */
+  void read(void* value) const;
+  /**
+   * Override the value seen by instrumented loads with `get_size()` bytes from
+   * `value`.
+   */
+  void override(const void* value);
+  /**
+   * Return to the original value.
+   */
+  void reset();
+
+  /**
+   * Typed access to the value. Throws std::invalid_argument if the size of T
+   * does not match.
+   */
+  template <typename T>
+  T get() const {
+    check_size(sizeof(T));
+    T value;
+    read(&value);
+    return value;
+  }
+  template <typename T>
+  void set(T value) {
+    check_size(sizeof(T));
+    override(&value);
+  }
+
+  /**
+   * Cast to a string, getting the name
+   */
+  operator std::string() const { return get_name(); }
+
+ private:
+  friend struct Internal;
+
+  // Only Internal can create these.
+  DataExtensionPoint(std::string module_name, std::string name, TypeDesc* type_desc, void* slot,
+                     size_t size, bool indirect);
+
+  std::string module_name;
+  std::string name;
+  TypeDesc* type_desc;
+  void* slot;
+  size_t size;
+  // the slot holds the address of the value rather than the value
+  bool indirect;
+  bool overridden = false;
+  // the original address for indirect slots
+  void* original_address = nullptr;
+  // the original value for direct slots or the overriding one for indirect slots
+  std::vector<char> value;
+
+  void check_size(size_t expected) const {
+    if (expected != size) {
+      throw std::invalid_argument("Size mismatch accessing data extension point " + name);
+    }
+  }
+
+  static void register_extension_point(DataExtensionPoint& pt);
+};
+
 /**
  * A listener to various lifecycle events for extension points becoming
  * available.
@@ -267,12 +374,21 @@ struct Listener {
    * Called when an extension point is unregistered.
    */
   virtual void on_extension_point_unregister(FnExtensionPoint& pt) {}
+  /**
+   * Called when a data extension point is registered.
+   */
+  virtual void on_data_extension_point_register(DataExtensionPoint& pt) {}
+  /**
+   * Called when a data extension point is unregistered.
+   */
+  virtual void on_data_extension_point_unregister(DataExtensionPoint& pt) {}
 
   /**
    * Add this listener to listen for events.
    * If `notify_existing_extension_points` is true, then a registration
    * event will be notified for each already registered extension point.
-   * I.e. `on_extension_point_register` will be called for each point.
+   * I.e. `on_extension_point_register` will be called for each point and
+   * `on_data_extension_point_register` for each data point.
    */
   void add(bool notify_existing_extension_points = true);
   /**
@@ -332,5 +448,28 @@ struct ListenerLifeCycle {
  * case.
  */
 extern AdviceId get_unique_advice_id();
+
+/**
+ * Load the extension library at the given path in place of the extension
+ * loaded by a previous call.
+ * This allows a long lived process, like a fork server or an in-process
+ * harness, to switch probes without restarting. The listeners added while the
+ * new library is loaded are only notified of the registered extension points
+ * after all listeners of the previous extension have been removed. So no
+ * extension point ever sees the advice of both. The previous library is closed
+ * afterwards.
+ * Throws std::runtime_error if the library cannot be loaded or is still
+ * resident from an earlier load, e.g. because of unique symbols. In that case
+ * the previous extension stays in place, unless it was loaded from the same
+ * path. A library is unloaded before it is loaded again from the same path.
+ * Like extending, this is not synchronised with calls of extended functions.
+ * Do not reload while other threads may run code of the previous extension.
+ */
+extern void reload_extension(const std::string& path);
+/**
+ * Remove the listeners of the extension loaded by `reload_extension` and close
+ * its library. Has no effect if no extension is loaded.
+ */
+extern void unload_extension();
 }  // namespace augmentum
 #endif
@@ -0,0 +1,47 @@
+/* Copyright (c) 2021, Björn Franke
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+/*
+ * Common prefix for probe extensions generated by the driver.
+ *
+ * Every generated extension includes this header first. The driver compiles
+ * it once into a precompiled header so that the standard library and
+ * augmentum headers are not parsed again for each probe.
+ */
+
+#ifndef __AUGMENTUM_PROBE__
+#define __AUGMENTUM_PROBE__
+
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "aggregator.h"
+#include "augmentum.h"
+#include "shared_counters.h"
+#include "telemetry.h"
+
+template <typename A, typename B>
+struct std::hash<std::pair<A, B>> {
+  size_t operator()(const std::pair<A, B>& p) const {
+    size_t h1 = std::hash<A>()(p.first);
+    size_t h2 = std::hash<B>()(p.second);
+    return h1 ^ (h2 << 1);
+  }
+};
+
+#endif
@@ -0,0 +1,296 @@
+/* Copyright (c) 2021, Björn Franke
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Extension points for code which is not built with the instrumentation pass.
+// The templates below generate what the pass generates for a function - the
+// extended and reflect thunks and the function type descriptor - from its C++
+// signature, and register the point through the same internal API.
+//
+// static int add__original__(int a, int b) { return a + b; }
+// AUGMENTUM_EXTENSION_POINT(add__original__);
+// int add(int a, int b) { return AUGMENTUM_CALL(add__original__)(a, b); }
+//
+// A point registers itself on the first call through AUGMENTUM_CALL, so unused
+// points cost nothing at startup. Points are registered with the module name
+// AUGMENTUM_MODULE_NAME, which defaults to __FILE__ and may be defined before
+// including this header.
+#ifndef __AUGMENTUM_EXTENSION_POINT__
+#define __AUGMENTUM_EXTENSION_POINT__
+
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+#include "internal.h"
+
+#ifndef AUGMENTUM_MODULE_NAME
+#define AUGMENTUM_MODULE_NAME __FILE__
+#endif
+
+namespace augmentum {
+
+template <typename T>
+inline constexpr bool not_described = false;
+
+/**
+ * Describes the C++ type T to augmentum. Structs are described with
+ * AUGMENTUM_STRUCT_TYPE or AUGMENTUM_ANON_STRUCT_TYPE, types which should be
+ * passed as unknown with AUGMENTUM_UNKNOWN_TYPE.
+ */
+template <typename T, typename Enable = void>
+struct TypeDescOf {
+  static TypeDesc* get(const char*) {
+    static_assert(not_described<T>,
+                  "No type description for this type, use AUGMENTUM_STRUCT_TYPE, "
+                  "AUGMENTUM_ANON_STRUCT_TYPE or AUGMENTUM_UNKNOWN_TYPE");
+    return nullptr;
+  }
+};
+
+template <typename T>
+TypeDesc* type_desc_of(const char* module) {
+  return TypeDescOf<std::remove_cv_t<T>>::get(module);
+}
+
+template <>
+struct TypeDescOf<void> {
+  static TypeDesc* get(const char*) { return Internal::get_void_type(); }
+};
+
+template <>
+struct TypeDescOf<bool> {
+  static TypeDesc* get(const char*) { return Internal::get_i1_type(); }
+};
+
+template <typename T>
+struct TypeDescOf<T, std::enable_if_t<std::is_integral_v<T> && !std::is_same_v<T, bool>>> {
+  static TypeDesc* get(const char*) {
+    static_assert(sizeof(T) <= 8, "No integer type of this size");
+    if constexpr (sizeof(T) == 1) {
+      return Internal::get_i8_type();
+    } else if constexpr (sizeof(T) == 2) {
+      return Internal::get_i16_type();
+    } else if constexpr (sizeof(T) == 4) {
+      return Internal::get_i32_type();
+    } else {
+      return Internal::get_i64_type();
+    }
+  }
+};
+
+template <typename T>
+struct TypeDescOf<T, std::enable_if_t<std::is_enum_v<T>>> {
+  static TypeDesc* get(const char* module) {
+    return type_desc_of<std::underlying_type_t<T>>(module);
+  }
+};
+
+template <>
+struct TypeDescOf<float> {
+  static TypeDesc* get(const char*) { return Internal::get_float_type(); }
+};
+
+template <>
+struct TypeDescOf<double> {
+  static TypeDesc* get(const char*) { return Internal::get_double_type(); }
+};
+
+template <typename T>
+struct TypeDescOf<T*> {
+  static TypeDesc* get(const char* module) {
+    // void pointers are i8 pointers in LLVM
+    if constexpr (std::is_void_v<std::remove_cv_t<T>>) {
+      return Internal::get_ptr_type(Internal::get_i8_type());
+    } else {
+      return Internal::get_ptr_type(type_desc_of<T>(module));
+    }
+  }
+};
+
+template <typename T, std::size_t N>
+struct TypeDescOf<T[N]> {
+  static TypeDesc* get(const char* module) {
+    return Internal::get_array_type(type_desc_of<T>(module), N);
+  }
+};
+
+template <typename R, typename... Args>
+struct TypeDescOf<R(Args...)> {
+  static TypeDesc* get(const char* module) {
+    return Internal::get_function_type(type_desc_of<R>(module), sizeof...(Args),
+                                       type_desc_of<Args>(module)...);
+  }
+};
+
+/**
+ * Describes a named struct T with the given element types.
+ */
+template <typename T, typename... Elems>
+struct NamedStructTypeDesc {
+  static TypeDesc* get(const char* module, const char* name) {
+    TypeDesc* type = Internal::get_forward_struct_type(module, name);
+    // elements may point back to the struct, which is then left forward
+    static thread_local bool describing = false;
+    if (!describing) {
+      describing = true;
+      Internal::set_struct_elem_types(type, sizeof...(Elems), type_desc_of<Elems>(module)...);
+      describing = false;
+    }
+    return type;
+  }
+};
+
+/**
+ * Describes an anonymous struct with the given element types.
+ */
+template <typename... Elems>
+struct AnonStructTypeDesc {
+  static TypeDesc* get(const char* module) {
+    return Internal::get_anon_struct_type(sizeof...(Elems), type_desc_of<Elems>(module)...);
+  }
+};
+
+/**
+ * The extension point of the function F, named by Names::module() and
+ * Names::name(). Calls through call() are dispatched to F until an extension
+ * extends the point.
+ */
+template <typename Names, typename Sig, Sig* F>
+struct ExtensionPointOf;
+
+template <typename Names, typename R, typename... Args, R (*F)(Args...)>
+struct ExtensionPointOf<Names, R(Args...), F> {
+  static_assert(!std::is_reference_v<R> && !(std::is_reference_v<Args> || ...),
+                "Extension points cannot pass references, use pointers instead");
+  static_assert(std::is_void_v<R> || std::is_default_constructible_v<R>,
+                "Extension points need a default constructible return type");
+
+  using FnPtr = R (*)(Args...);
+
+  static R call(Args... args) { return fn(std::forward<Args>(args)...); }
+
+  /**
+   * Register the extension point if that has not happened yet.
+   */
+  static FnExtensionPoint* get() {
+    static FnExtensionPoint* registered = register_point();
+    return registered;
+  }
+
+ private:
+  static R first_call(Args... args) {
+    get();
+    return fn(std::forward<Args>(args)...);
+  }
+
+  static FnExtensionPoint* register_point() {
+    fn = F;
+    const char* module = Names::module();
+    pt = Internal::create_extension_point(
+        module, Names::name(), type_desc_of<R(Args...)>(module), reinterpret_cast<Fn*>(&fn),
+        reinterpret_cast<Fn>(F), reinterpret_cast<Fn>(&extended), &reflect);
+    return pt;
+  }
+
+  static R extended(Args... args) {
+    void* arg_values[sizeof...(Args) + 1] = {static_cast<void*>(&args)..., nullptr};
+    if constexpr (std::is_void_v<R>) {
+      Internal::eval(pt, nullptr, arg_values);
+    } else {
+      R r{};
+      Internal::eval(pt, &r, arg_values);
+      return r;
+    }
+  }
+
+  static void reflect(RetVal ret_value, ArgVals arg_values) {
+    reflect(ret_value, arg_values, std::index_sequence_for<Args...>{});
+  }
+
+  template <std::size_t... I>
+  static void reflect(RetVal ret_value, ArgVals arg_values, std::index_sequence<I...>) {
+    (void)arg_values;
+    if constexpr (std::is_void_v<R>) {
+      F(*static_cast<Args*>(arg_values[I])...);
+    } else {
+      *static_cast<R*>(ret_value) = F(*static_cast<Args*>(arg_values[I])...);
+    }
+  }
+
+  // dispatches to first_call until the point is registered, then to F or extended
+  static inline FnPtr fn = &first_call;
+  static inline FnExtensionPoint* pt = nullptr;
+};
+
+}  // namespace augmentum
+
+/**
+ * Declare the extension point fn##__extension_point__ of the function fn,
+ * registered with the given name, e.g. the mangled name of the function it
+ * stands for. fn must not be overloaded.
+ */
+#define AUGMENTUM_NAMED_EXTENSION_POINT(fn, fn_name)                \
+  struct fn##__names__ {                                            \
+    static const char* module() { return AUGMENTUM_MODULE_NAME; }   \
+    static const char* name() { return fn_name; }                   \
+  };                                                                \
+  using fn##__extension_point__ =                                   \
+      augmentum::ExtensionPointOf<fn##__names__, decltype(fn), &fn>
+
+/**
+ * Declare the extension point of the function fn, registered with its name.
+ */
+#define AUGMENTUM_EXTENSION_POINT(fn) AUGMENTUM_NAMED_EXTENSION_POINT(fn, #fn)
+
+/**
+ * Call fn through its extension point.
+ */
+#define AUGMENTUM_CALL(fn) fn##__extension_point__::call
+
+/**
+ * Describe the named struct type to augmentum by its element types. Has to be
+ * used in the global namespace.
+ */
+#define AUGMENTUM_STRUCT_TYPE(type, ...)                                                 \
+  namespace augmentum {                                                                  \
+  template <>                                                                            \
+  struct TypeDescOf<type> {                                                              \
+    static TypeDesc* get(const char* module) {                                           \
+      return NamedStructTypeDesc<type, __VA_ARGS__>::get(module, "struct." #type);       \
+    }                                                                                    \
+  };                                                                                     \
+  }
+
+/**
+ * Describe the struct type to augmentum as an anonymous struct of its element
+ * types. Has to be used in the global namespace.
+ */
+#define AUGMENTUM_ANON_STRUCT_TYPE(type, ...)                                            \
+  namespace augmentum {                                                                  \
+  template <>                                                                            \
+  struct TypeDescOf<type> {                                                              \
+    static TypeDesc* get(const char* module) {                                           \
+      return AnonStructTypeDesc<__VA_ARGS__>::get(module);                               \
+    }                                                                                    \
+  };                                                                                     \
+  }
+
+/**
+ * Describe the type to augmentum as unknown, identified by the given signature,
+ * e.g. its LLVM type "[50 x i8]". Has to be used in the global namespace.
+ */
+#define AUGMENTUM_UNKNOWN_TYPE(type, signature)                                          \
+  namespace augmentum {                                                                  \
+  template <>                                                                            \
+  struct TypeDescOf<type> {                                                              \
+    static TypeDesc* get(const char* module) {                                           \
+      return Internal::get_unknown_type(module, signature);                              \
+    }                                                                                    \
+  };                                                                                     \
+  }
+
+#endif
@@ -90,4 +90,13 @@ FnExtensionPoint* Internal::create_extension_point(const char* module, const cha
 void Internal::eval(FnExtensionPoint* pt, RetVal ret, ArgVals args) {
   FnExtensionPoint::eval(*pt, ret, args);
 }
+
+DataExtensionPoint* Internal::create_data_extension_point(const char* module, const char* name,
+                                                          TypeDesc* type, void* slot, size_t size,
+                                                          bool indirect) {
+  DataExtensionPoint* pt = new DataExtensionPoint(module, name, type, slot, size, indirect);
+  DataExtensionPoint::register_extension_point(*pt);
+  // Unregistering will be handled by empty_registry in augmentum.cpp
+  return pt;
+}
 }  // namespace augmentum
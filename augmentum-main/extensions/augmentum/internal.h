@@ -20,6 +20,7 @@ typedef void** ArgVals;
 typedef void (*Fn)();
 typedef void (*ReflectFn)(RetVal, ArgVals);
 struct FnExtensionPoint;
+struct DataExtensionPoint;
 
 struct Internal {
   static void debug_print(const char* message);
@@ -44,6 +45,9 @@ struct Internal {
                                                   TypeDesc* type, Fn* fn, Fn original, Fn extended,
                                                   ReflectFn reflect);
   static void eval(FnExtensionPoint* pt, RetVal, ArgVals);
+  static DataExtensionPoint* create_data_extension_point(const char* module, const char* name,
+                                                         TypeDesc* type, void* slot,
+                                                         std::size_t size, bool indirect);
 };
 }  // namespace augmentum
 
@@ -0,0 +1,111 @@
+/* Copyright (c) 2021, Björn Franke
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "shared_counters.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace augmentum {
+
+namespace {
+const uint64_t SLOT_EMPTY = 0;
+const uint64_t SLOT_WRITING = 1;
+const uint64_t SLOT_READY = 2;
+
+// a writer that died while filling in a slot must not block everyone else
+const int MAX_WRITING_SPINS = 1 << 20;
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free,
+              "Shared counters require address free 64 bit atomics");
+static_assert(sizeof(SharedCounterRegion::Header) == 64, "Header layout is shared with the driver");
+static_assert(sizeof(SharedCounterRegion::Slot) == 48, "Slot layout is shared with the driver");
+
+uint64_t hash_key(uint64_t kind, uint64_t point, uint64_t first, uint64_t second) {
+  uint64_t h = 0xcbf29ce484222325ULL;
+  for (uint64_t v : {kind, point, first, second}) {
+    h = (h ^ v) * 0x100000001b3ULL;
+    h ^= h >> 31;
+  }
+  return h;
+}
+}  // namespace
+
+std::unique_ptr<SharedCounterRegion> SharedCounterRegion::attach(const std::string& name) {
+  std::string shm_name = name.empty() || name[0] != '/' ? "/" + name : name;
+
+  int fd = shm_open(shm_name.c_str(), O_RDWR, 0);
+  if (fd < 0) {
+    return nullptr;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(Header))) {
+    close(fd);
+    return nullptr;
+  }
+  void* addr = mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (addr == MAP_FAILED) {
+    return nullptr;
+  }
+
+  Header* header = static_cast<Header*>(addr);
+  uint64_t capacity = header->capacity;
+  if (header->magic != MAGIC || header->version != VERSION || capacity == 0 ||
+      (capacity & (capacity - 1)) != 0 ||
+      sizeof(Header) + capacity * sizeof(Slot) > static_cast<uint64_t>(st.st_size)) {
+    munmap(addr, st.st_size);
+    return nullptr;
+  }
+
+  return std::unique_ptr<SharedCounterRegion>(new SharedCounterRegion(header, st.st_size));
+}
+
+SharedCounterRegion::~SharedCounterRegion() { munmap(header, size); }
+
+bool SharedCounterRegion::add(ValueKind kind, uint64_t point, uint64_t first, uint64_t second,
+                              uint64_t count) {
+  const uint64_t k = static_cast<uint64_t>(kind);
+  const uint64_t mask = header->capacity - 1;
+  uint64_t i = hash_key(k, point, first, second) & mask;
+
+  for (uint64_t probe = 0; probe <= mask; ++probe, i = (i + 1) & mask) {
+    Slot& slot = slots[i];
+    uint64_t state = slot.state.load(std::memory_order_acquire);
+
+    if (state == SLOT_EMPTY) {
+      // keep probe sequences short, new keys are rejected at three quarters load
+      if (header->used.load(std::memory_order_relaxed) * 4 >= header->capacity * 3) {
+        return false;
+      }
+      if (slot.state.compare_exchange_strong(state, SLOT_WRITING, std::memory_order_acquire)) {
+        slot.kind = k;
+        slot.point = point;
+        slot.first = first;
+        slot.second = second;
+        slot.state.store(SLOT_READY, std::memory_order_release);
+        header->used.fetch_add(1, std::memory_order_relaxed);
+        slot.count.fetch_add(count, std::memory_order_relaxed);
+        return true;
+      }
+    }
+
+    for (int spins = 0; state == SLOT_WRITING && spins < MAX_WRITING_SPINS; ++spins) {
+      state = slot.state.load(std::memory_order_acquire);
+    }
+
+    if (state == SLOT_READY && slot.kind == k && slot.point == point && slot.first == first &&
+        slot.second == second) {
+      slot.count.fetch_add(count, std::memory_order_relaxed);
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // namespace augmentum
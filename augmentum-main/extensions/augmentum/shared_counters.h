@@ -0,0 +1,98 @@
+/* Copyright (c) 2021, Björn Franke
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#ifndef __AUGMENTUM_SHARED_COUNTERS__
+#define __AUGMENTUM_SHARED_COUNTERS__
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <type_traits>
+
+#include "aggregator.h"
+
+namespace augmentum {
+
+/**
+ * How the bits of counted values are interpreted by the reader of a region.
+ */
+enum class ValueKind : uint64_t { Signed = 1, Unsigned = 2, Float = 3, Double = 4 };
+
+template <typename T>
+constexpr ValueKind value_kind() {
+  if (std::is_floating_point<T>::value) {
+    return sizeof(T) == sizeof(float) ? ValueKind::Float : ValueKind::Double;
+  }
+  return std::is_signed<T>::value ? ValueKind::Signed : ValueKind::Unsigned;
+}
+
+/**
+ * Named shared memory region of counters for pairs of values, keyed by an
+ * extension point chosen by the writer.
+ * The region is created and read by the driver, see
+ * driver/augmentum/sharedcounters.py for the matching layout. Any number of
+ * processes attached to it add their counts with atomic operations only, so
+ * all compiler processes of a build aggregate into a single result.
+ * Once the region is full, `add` fails for new keys and writers are expected
+ * to fall back to their own logs.
+ */
+struct SharedCounterRegion {
+  static const uint64_t MAGIC = 0x31524e5443475541ULL;  // "AUGCTNR1"
+  static const uint64_t VERSION = 1;
+
+  struct Header {
+    uint64_t magic;
+    uint64_t version;
+    uint64_t capacity;  // number of slots, power of two
+    std::atomic<uint64_t> used;
+    uint64_t reserved[4];
+  };
+
+  struct Slot {
+    std::atomic<uint64_t> state;
+    uint64_t kind;
+    uint64_t point;
+    uint64_t first;
+    uint64_t second;
+    std::atomic<uint64_t> count;
+  };
+
+  /**
+   * Attach to the region with the given name, it stays mapped for the lifetime
+   * of the returned object.
+   * Returns nullptr if no valid region of that name exists.
+   */
+  static std::unique_ptr<SharedCounterRegion> attach(const std::string& name);
+
+  ~SharedCounterRegion();
+  SharedCounterRegion(const SharedCounterRegion&) = delete;
+  SharedCounterRegion& operator=(const SharedCounterRegion&) = delete;
+
+  /**
+   * Add count to the counter of the given point and value pair.
+   * Returns false if the pair could not be stored because the region is full.
+   */
+  bool add(ValueKind kind, uint64_t point, uint64_t first, uint64_t second, uint64_t count);
+
+  template <typename T>
+  bool add(uint64_t point, T first, T second, uint64_t count) {
+    return add(value_kind<T>(), point, to_value_bits(first), to_value_bits(second), count);
+  }
+
+ private:
+  SharedCounterRegion(Header* header, size_t size)
+      : header(header), slots(reinterpret_cast<Slot*>(header + 1)), size(size) {}
+
+  Header* header;
+  Slot* slots;
+  size_t size;
+};
+
+}  // namespace augmentum
+
+#endif
@@ -0,0 +1,102 @@
+/* Copyright (c) 2021, Björn Franke
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "telemetry.h"
+
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <vector>
+
+namespace augmentum {
+
+namespace {
+const int SEND_TIMEOUT_SECS = 1;
+
+static_assert(sizeof(TelemetryChannel::FrameHeader) == 16,
+              "Frame layout is shared with the driver");
+
+struct ValueCountPayload {
+  uint64_t kind;
+  uint64_t point;
+  uint64_t first;
+  uint64_t second;
+  uint64_t count;
+};
+}  // namespace
+
+std::unique_ptr<TelemetryChannel> TelemetryChannel::connect(const std::string& name) {
+  sockaddr_un addr;
+  // abstract socket names start with a null byte and are not null terminated
+  if (name.empty() || name.size() + 1 > sizeof(addr.sun_path)) {
+    return nullptr;
+  }
+  std::memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  std::memcpy(addr.sun_path + 1, name.data(), name.size());
+  socklen_t addr_len = offsetof(sockaddr_un, sun_path) + 1 + name.size();
+
+  int fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+  if (fd < 0) {
+    return nullptr;
+  }
+  timeval timeout = {SEND_TIMEOUT_SECS, 0};
+  if (setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout)) != 0 ||
+      ::connect(fd, reinterpret_cast<sockaddr*>(&addr), addr_len) != 0) {
+    close(fd);
+    return nullptr;
+  }
+
+  std::unique_ptr<TelemetryChannel> channel(new TelemetryChannel(fd));
+  if (!channel->send(EventType::Attach, nullptr, 0)) {
+    return nullptr;
+  }
+  return channel;
+}
+
+TelemetryChannel::~TelemetryChannel() { close(fd); }
+
+bool TelemetryChannel::value_count(ValueKind kind, uint64_t point, uint64_t first,
+                                   uint64_t second, uint64_t count) {
+  ValueCountPayload payload = {static_cast<uint64_t>(kind), point, first, second, count};
+  return send(EventType::ValueCount, &payload, sizeof(payload));
+}
+
+bool TelemetryChannel::trace(const std::string& module_name, const std::string& name) {
+  // module and function name, each null terminated
+  std::vector<char> payload(module_name.begin(), module_name.end());
+  payload.push_back('\0');
+  payload.insert(payload.end(), name.begin(), name.end());
+  payload.push_back('\0');
+  return send(EventType::Trace, payload.data(), payload.size());
+}
+
+bool TelemetryChannel::send(EventType type, const void* payload, size_t length) {
+  if (broken.load(std::memory_order_relaxed)) {
+    return false;
+  }
+
+  FrameHeader header = {MAGIC, VERSION, static_cast<uint16_t>(type),
+                        static_cast<uint32_t>(getpid()), static_cast<uint32_t>(length)};
+  iovec parts[2] = {{&header, sizeof(header)}, {const_cast<void*>(payload), length}};
+
+  ssize_t sent;
+  do {
+    sent = writev(fd, parts, length > 0 ? 2 : 1);
+  } while (sent < 0 && errno == EINTR);
+  if (sent != static_cast<ssize_t>(sizeof(header) + length)) {
+    broken.store(true, std::memory_order_relaxed);
+    return false;
+  }
+  return true;
+}
+
+}  // namespace augmentum
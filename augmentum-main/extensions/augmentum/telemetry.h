@@ -0,0 +1,86 @@
+/* Copyright (c) 2021, Björn Franke
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#ifndef __AUGMENTUM_TELEMETRY__
+#define __AUGMENTUM_TELEMETRY__
+
+#include <cstddef>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "aggregator.h"
+#include "shared_counters.h"
+
+namespace augmentum {
+
+/**
+ * Streaming channel from an instrumented process to a local collector.
+ * Events are sent as framed binary datagrams over a Unix domain socket in the
+ * abstract namespace, so nothing touches the file system. The collector is
+ * implemented in driver/augmentum/telemetry.py, which also documents the frame
+ * layout.
+ * Sending blocks while the collector is busy, but at most for a second. If an
+ * event could not be delivered the send methods return false and callers are
+ * expected to fall back to their own logs. After the first failed send the
+ * channel is broken and all further sends fail immediately, so a stalled
+ * collector delays the process only once.
+ */
+struct TelemetryChannel {
+  static const uint32_t MAGIC = 0x54475541;  // "AUGT"
+  static const uint16_t VERSION = 1;
+
+  enum class EventType : uint16_t { Attach = 1, ValueCount = 2, Trace = 3 };
+
+  struct FrameHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t type;
+    uint32_t pid;
+    uint32_t length;  // of the payload following the header
+  };
+
+  /**
+   * Connect to the collector listening on the given name and announce this
+   * process with an attach event.
+   * Returns nullptr if there is no such collector.
+   */
+  static std::unique_ptr<TelemetryChannel> connect(const std::string& name);
+
+  ~TelemetryChannel();
+  TelemetryChannel(const TelemetryChannel&) = delete;
+  TelemetryChannel& operator=(const TelemetryChannel&) = delete;
+
+  /**
+   * Send the count of a pair of values seen at an extension point.
+   */
+  bool value_count(ValueKind kind, uint64_t point, uint64_t first, uint64_t second,
+                   uint64_t count);
+
+  template <typename T>
+  bool value_count(uint64_t point, T first, T second, uint64_t count) {
+    return value_count(value_kind<T>(), point, to_value_bits(first), to_value_bits(second),
+                       count);
+  }
+
+  /**
+   * Send that the function of the given module has been executed.
+   */
+  bool trace(const std::string& module_name, const std::string& name);
+
+ private:
+  explicit TelemetryChannel(int fd) : fd(fd) {}
+
+  bool send(EventType type, const void* payload, size_t length);
+
+  int fd;
+  std::atomic<bool> broken{false};
+};
+
+}  // namespace augmentum
+
+#endif
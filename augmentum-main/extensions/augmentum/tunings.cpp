@@ -0,0 +1,332 @@
+/* Copyright (c) 2021, Björn Franke
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "tunings.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <stdexcept>
+
+namespace augmentum {
+
+namespace {
+// Module name under which coalesced extension points are registered, has to
+// match COALESCED_MODULE_NAME in driver/augmentum/probes.py
+const char* const COALESCED_MODULE_NAME = "<linkonce_odr>";
+
+struct Reader {
+  const std::vector<char>& data;
+  size_t pos = 0;
+
+  template <typename T>
+  T read() {
+    if (pos + sizeof(T) > data.size()) {
+      throw std::runtime_error("Tuning file is truncated");
+    }
+    T value;
+    std::memcpy(&value, data.data() + pos, sizeof(T));
+    pos += sizeof(T);
+    return value;
+  }
+
+  std::string read_string() {
+    uint16_t length = read<uint16_t>();
+    if (pos + length > data.size()) {
+      throw std::runtime_error("Tuning file is truncated");
+    }
+    std::string s(data.data() + pos, length);
+    pos += length;
+    return s;
+  }
+
+  void skip(size_t n) {
+    if (pos + n > data.size()) {
+      throw std::runtime_error("Tuning file is truncated");
+    }
+    pos += n;
+  }
+};
+
+template <typename E>
+E read_enum(Reader& reader, E first, E last) {
+  uint8_t value = reader.read<uint8_t>();
+  if (value < static_cast<uint8_t>(first) || value > static_cast<uint8_t>(last)) {
+    throw std::runtime_error("Tuning file has an invalid field value " + std::to_string(value));
+  }
+  return static_cast<E>(value);
+}
+
+bool valid_bits(Tuning::Leaf leaf, uint8_t bits) {
+  if (leaf == Tuning::Leaf::Float) {
+    return bits == 32 || bits == 64;
+  }
+  return bits == 1 || bits == 8 || bits == 16 || bits == 32 || bits == 64;
+}
+
+template <typename T, typename V>
+void apply_value(void* address, Tuning::Action action, V value) {
+  T current;
+  std::memcpy(&current, address, sizeof(T));
+  switch (action) {
+    case Tuning::Action::Set:
+      current = static_cast<T>(value);
+      break;
+    case Tuning::Action::Add:
+      current = static_cast<T>(current + value);
+      break;
+    case Tuning::Action::Scale:
+      current = static_cast<T>(current * value);
+      break;
+  }
+  std::memcpy(address, &current, sizeof(T));
+}
+}  // namespace
+
+void Tuning::prepare() {
+  accesses.assign(1, 0);
+  for (const Step& step : steps) {
+    if (step.op == StepOp::Deref) {
+      accesses.push_back(0);
+    } else {
+      accesses.back() += step.offset;
+    }
+  }
+}
+
+bool Tuning::matches(const FnExtensionPoint& pt) const {
+  const TypeDesc* type;
+  if (root == Root::Result) {
+    type = pt.get_return_type();
+  } else {
+    if (arg_index >= pt.get_num_args()) {
+      return false;
+    }
+    type = pt.get_arg_type(arg_index);
+  }
+
+  for (const Step& step : steps) {
+    switch (step.op) {
+      case StepOp::Deref:
+        if (type->get_discriminator() != TypeDesc::POINTER) {
+          return false;
+        }
+        type = static_cast<const PointerTypeDesc*>(type)->get_element_type();
+        break;
+      case StepOp::Elem: {
+        if (type->get_discriminator() != TypeDesc::STRUCT) {
+          return false;
+        }
+        auto struct_type = static_cast<const StructTypeDesc*>(type);
+        if (struct_type->is_forward() || step.index >= struct_type->get_num_elems()) {
+          return false;
+        }
+        type = struct_type->get_elem_type(step.index);
+        break;
+      }
+      case StepOp::Left:
+      case StepOp::Right: {
+        if (type->get_discriminator() != TypeDesc::INT) {
+          return false;
+        }
+        size_t half = static_cast<const IntTypeDesc*>(type)->get_bits() / 2;
+        if (half == 8) {
+          type = IntTypeDesc::get_i8();
+        } else if (half == 16) {
+          type = IntTypeDesc::get_i16();
+        } else if (half == 32) {
+          type = IntTypeDesc::get_i32();
+        } else {
+          return false;
+        }
+        break;
+      }
+      default:
+        return false;
+    }
+  }
+
+  if (type->get_discriminator() == TypeDesc::INT) {
+    size_t type_bits = static_cast<const IntTypeDesc*>(type)->get_bits();
+    // a float may sit in an i32
+    return type_bits == bits && (leaf == Leaf::Int || bits == 32);
+  }
+  if (type->get_discriminator() == TypeDesc::FLOAT) {
+    return leaf == Leaf::Float && static_cast<const FloatTypeDesc*>(type)->get_bits() == bits;
+  }
+  return false;
+}
+
+void Tuning::apply(RetVal ret_value, ArgVals arg_values) const {
+  char* address = static_cast<char*>(root == Root::Result ? ret_value : arg_values[arg_index]);
+  for (size_t i = 0; i + 1 < accesses.size(); ++i) {
+    address = *reinterpret_cast<char**>(address + accesses[i]);
+    if (address == nullptr) {
+      return;
+    }
+  }
+  address += accesses.back();
+
+  if (leaf == Leaf::Float || action == Action::Scale) {
+    double value;
+    std::memcpy(&value, &value_bits, sizeof(value));
+    apply_typed(address, value);
+  } else {
+    int64_t value;
+    std::memcpy(&value, &value_bits, sizeof(value));
+    apply_typed(address, value);
+  }
+}
+
+template <typename V>
+void Tuning::apply_typed(void* address, V value) const {
+  if (leaf == Leaf::Float) {
+    if (bits == 32) {
+      apply_value<float>(address, action, value);
+    } else {
+      apply_value<double>(address, action, value);
+    }
+    return;
+  }
+
+  switch (bits) {
+    case 1:
+      apply_value<bool>(address, action, value);
+      break;
+    case 8:
+      apply_value<int8_t>(address, action, value);
+      break;
+    case 16:
+      apply_value<int16_t>(address, action, value);
+      break;
+    case 32:
+      apply_value<int32_t>(address, action, value);
+      break;
+    case 64:
+      apply_value<int64_t>(address, action, value);
+      break;
+  }
+}
+
+TuningTable TuningTable::load(const std::string& file) {
+  std::ifstream in(file, std::ios::binary);
+  if (!in.good()) {
+    throw std::runtime_error("Reading tuning file failed: " + file);
+  }
+  std::vector<char> data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+  Reader reader{data};
+  if (reader.read<uint64_t>() != Tuning::MAGIC || reader.read<uint32_t>() != Tuning::VERSION) {
+    throw std::runtime_error("Not a tuning file of this version: " + file);
+  }
+  uint32_t count = reader.read<uint32_t>();
+
+  TuningTable table;
+  for (uint32_t i = 0; i < count; ++i) {
+    Tuning tuning;
+    tuning.module_name = reader.read_string();
+    tuning.name = reader.read_string();
+    tuning.path = reader.read_string();
+    tuning.root = read_enum(reader, Tuning::Root::Result, Tuning::Root::Arg);
+    tuning.leaf = read_enum(reader, Tuning::Leaf::Int, Tuning::Leaf::Float);
+    tuning.bits = reader.read<uint8_t>();
+    tuning.action = read_enum(reader, Tuning::Action::Set, Tuning::Action::Scale);
+    tuning.arg_index = reader.read<uint32_t>();
+    tuning.value_bits = reader.read<uint64_t>();
+    if (!valid_bits(tuning.leaf, tuning.bits)) {
+      throw std::runtime_error("Tuning file has an invalid leaf size: " + file);
+    }
+
+    uint16_t num_steps = reader.read<uint16_t>();
+    for (uint16_t s = 0; s < num_steps; ++s) {
+      Tuning::Step step;
+      step.op = read_enum(reader, Tuning::StepOp::Deref, Tuning::StepOp::Right);
+      reader.skip(3);
+      step.index = reader.read<uint32_t>();
+      step.offset = reader.read<uint32_t>();
+      tuning.steps.push_back(step);
+    }
+    tuning.prepare();
+    table.by_name.emplace(tuning.name, table.tunings.size());
+    // not reserved up front, the count is not trusted before entries are read
+    table.tunings.push_back(std::move(tuning));
+  }
+  return table;
+}
+
+namespace {
+/**
+ * Extends every extension point with tunings by a single after advice which
+ * applies all of them in the order of the tuning file.
+ */
+struct TuningListener : Listener {
+  TuningTable table;
+  AdviceId id = get_unique_advice_id();
+
+  TuningListener(TuningTable table) : table(std::move(table)) {}
+
+  void on_extension_point_register(FnExtensionPoint& pt) override {
+    std::vector<const Tuning*> active;
+    auto range = table.by_name.equal_range(pt.get_name());
+    for (auto it = range.first; it != range.second; ++it) {
+      const Tuning& tuning = table.tunings[it->second];
+      if (pt.get_module_name() != tuning.module_name &&
+          pt.get_module_name() != COALESCED_MODULE_NAME) {
+        continue;
+      }
+      if (!tuning.matches(pt)) {
+        std::cerr << "augmentum: ignoring tuning of " << tuning.module_name << " " << tuning.name
+                  << " " << tuning.path << ", path does not match " << pt.get_signature()
+                  << std::endl;
+        continue;
+      }
+      active.push_back(&tuning);
+    }
+    if (active.empty()) {
+      return;
+    }
+
+    pt.extend_after(
+        [active](FnExtensionPoint&, RetVal ret_value, ArgVals arg_values) {
+          for (const Tuning* tuning : active) {
+            tuning->apply(ret_value, arg_values);
+          }
+        },
+        id);
+  }
+
+  void on_extension_point_unregister(FnExtensionPoint& pt) override { pt.remove(id); }
+};
+
+/**
+ * Applies the tunings of the file named by the environment variable
+ * AUGMENTUM_TUNINGS, if set, to every extension point as it is registered.
+ * This deploys an evaluated configuration without building an extension.
+ */
+struct __attribute__((visibility("hidden"))) TuningMain {
+  // Leaked on purpose, like the registry. Removing the listener at exit would
+  // touch the registry after empty_registry deleted it, which also sends the
+  // listener its unregister events.
+  ListenerLifeCycle<TuningListener>* listener = nullptr;
+
+  TuningMain(const char* file) {
+    if (file == nullptr || *file == '\0') {
+      return;
+    }
+    try {
+      listener = new ListenerLifeCycle<TuningListener>(TuningTable::load(file));
+    } catch (const std::exception& e) {
+      std::cerr << "augmentum: " << e.what() << std::endl;
+    }
+  }
+};
+
+TuningMain tuning_main(std::getenv("AUGMENTUM_TUNINGS"));
+}  // namespace
+
+}  // namespace augmentum
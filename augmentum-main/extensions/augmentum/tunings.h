@@ -0,0 +1,89 @@
+/* Copyright (c) 2021, Björn Franke
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#ifndef __AUGMENTUM_TUNINGS__
+#define __AUGMENTUM_TUNINGS__
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "augmentum.h"
+
+namespace augmentum {
+
+/**
+ * A tuning applies a value to one path of a function, e.g. sets the return
+ * value or scales a field of a struct an argument points to.
+ * Tunings are compiled by driver/augmentum/tunings.py from a table of tuning
+ * targets, which also documents the file layout. Compiling resolves each path
+ * to the byte offsets it takes through the function's types, so applying a
+ * tuning is a few pointer additions and loads followed by a typed store.
+ */
+struct Tuning {
+  static const uint64_t MAGIC = 0x31454E5554475541;  // "AUGTUNE1"
+  static const uint32_t VERSION = 1;
+
+  enum class Root : uint8_t { Result = 0, Arg = 1 };
+  enum class StepOp : uint8_t { Deref = 0, Elem = 1, Left = 2, Right = 3 };
+  enum class Leaf : uint8_t { Int = 1, Float = 2 };
+  enum class Action : uint8_t { Set = 0, Add = 1, Scale = 2 };
+
+  struct Step {
+    StepOp op;
+    uint32_t index;   // of the struct element
+    uint32_t offset;  // in bytes, added to the address of the enclosing value
+  };
+
+  std::string module_name;
+  std::string name;
+  std::string path;
+
+  Root root;
+  uint32_t arg_index;
+  std::vector<Step> steps;
+  Leaf leaf;
+  uint8_t bits;
+  Action action;
+  // double for float leaves and scale factors, int64_t otherwise
+  uint64_t value_bits;
+
+  /**
+   * Check that the path is valid for the type of the given extension point.
+   */
+  bool matches(const FnExtensionPoint& pt) const;
+  /**
+   * Apply the tuning to the return value or arguments of a call.
+   */
+  void apply(RetVal ret_value, ArgVals arg_values) const;
+
+ private:
+  friend struct TuningTable;
+  // offsets between dereferences, ending with the offset of the leaf
+  std::vector<uint32_t> accesses;
+  void prepare();
+  template <typename V>
+  void apply_typed(void* address, V value) const;
+};
+
+/**
+ * Tunings read from a compiled tuning file, indexed by function name.
+ */
+struct TuningTable {
+  /**
+   * Read compiled tunings. Throws std::runtime_error if the file is not a
+   * valid tuning file.
+   */
+  static TuningTable load(const std::string& file);
+
+  std::vector<Tuning> tunings;
+  std::unordered_multimap<std::string, size_t> by_name;
+};
+
+}  // namespace augmentum
+
+#endif
@@ -7,17 +7,23 @@
 /**
  * Instrumentation pass for LLVM.
  */
+#include <algorithm>
 #include <filesystem>
 #include <fstream>
 #include <string>
 #include <unordered_map>
 #include <vector>
 
+#include "data_targets.h"
 #include "instrumentation_stats.h"
+#include "llvm/ADT/Triple.h"
+#include "llvm/Analysis/ProfileSummaryInfo.h"
 #include "llvm/IR/Constants.h"
 #include "llvm/IR/Function.h"
 #include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/Instructions.h"
 #include "llvm/IR/LegacyPassManager.h"
+#include "llvm/IR/MDBuilder.h"
 #include "llvm/IR/Module.h"
 #include "llvm/Pass.h"
 #include "llvm/Support/CommandLine.h"
@@ -78,6 +84,52 @@ static cl::opt<std::string> TargetFunctions(
     "target-functions", cl::desc("Specify a csv file where target functions are listed that should "
                                  " be instrumented."));
 
+/**
+ * Command line option to specify a file where target globals and immediate
+ * constants can be found, which should be given data extension points.
+ */
+static cl::opt<std::string> TargetData(
+    "target-data", cl::desc("Specify a csv file where globals and constants are listed whose "
+                            "loads should be routed through data extension points."));
+
+/**
+ * Command line option to share a single extension point between all copies of
+ * linkonce_odr and weak_odr functions, e.g. inline functions and template
+ * instantiations defined in headers. Otherwise every module gets its own
+ * extension point for its copy.
+ */
+static cl::opt<bool> CoalesceODR(
+    "augmentum-coalesce-odr",
+    cl::desc("Share one extension point between the copies of linkonce_odr and weak_odr "
+             "functions emitted by different modules."),
+    cl::init(false));
+
+/**
+ * Module name under which coalesced extension points are registered, they do
+ * not belong to a single module. Has to match COALESCED_MODULE_NAME in
+ * driver/augmentum/probes.py.
+ */
+static constexpr const char* coalesced_module_name = "<linkonce_odr>";
+
+/**
+ * Sections of the dispatch table, holding the fn pointers loaded by every
+ * call of an instrumented function. The linker gathers them into a dense
+ * table per binary, apart from the extension point pointers, which are only
+ * loaded by extended calls. Fn pointers of hot functions, according to the
+ * profile if there is one, get a table of their own.
+ */
+static constexpr const char* dispatch_section = "augmentum_dispatch";
+static constexpr const char* dispatch_hot_section = "augmentum_dispatch_hot";
+static constexpr const char* extension_points_section = "augmentum_extension_points";
+static const unsigned cache_line_size = 64;
+
+/**
+ * Branch weights for the direct call of the original, the values clang's
+ * __builtin_expect lowers to by default.
+ */
+static const uint32_t likely_branch_weight = 2000;
+static const uint32_t unlikely_branch_weight = 1;
+
 /**
  * This id is used to indicate a reason for the
  * instrumentation decision.
@@ -111,8 +163,11 @@ static CanInstrumentID can_be_instrumented(const Function& function) {
  * to instrument. Then it gets this class to do the work per function.
  */
 struct AugmentumFunction {
-  AugmentumFunction(Function& function, ShouldInstrument& should_instrument)
-      : function(function), should_instrument(should_instrument) {}
+  friend struct AugmentumData;
+
+  AugmentumFunction(Function& function, ShouldInstrument& should_instrument,
+                    ProfileSummaryInfo* psi = nullptr)
+      : function(function), should_instrument(should_instrument), psi(psi) {}
 
   /**
    * Transform the function if needed.
@@ -142,7 +197,15 @@ struct AugmentumFunction {
  private:
   Function& function;
   ShouldInstrument& should_instrument;
+  ProfileSummaryInfo* psi;
   Module& module = *function.getParent();
+  /**
+   * All copies of an ODR function are equivalent, so the linker may keep the
+   * generated globals of any of them. Copies without the ODR guarantee may
+   * differ and are never coalesced.
+   */
+  const bool coalesced =
+      CoalesceODR && (function.hasLinkOnceODRLinkage() || function.hasWeakODRLinkage());
   LLVMContext& ctx = module.getContext();
   Function* original = nullptr;
   Function* extended = nullptr;
@@ -269,29 +332,91 @@ struct AugmentumFunction {
   }
 
   /**
-   * Add call attributes to a call of the fn pointer or the original if
-   * required.
+   * Set the linkage of a global generated for the function.
+   * Globals are private to the module, unless the function is coalesced. Then
+   * they are linkonce_odr in a comdat of their own, so the linker keeps one
+   * copy of each and all modules share the same extension point and fn pointer,
+   * even if only some copies of the function itself survive.
    */
-  void add_call_attributes(CallInst* call) {
-    for (int argIdx = 0; argIdx < function.arg_size(); ++argIdx) {
-      Argument* arg = function.getArg(argIdx);
-      if (arg->hasAttribute(Attribute::ByVal)) {
-        call->addParamAttr(argIdx, arg->getAttribute(Attribute::ByVal));
+  void set_generated_linkage(GlobalObject* global) {
+    if (!coalesced) {
+      global->setLinkage(GlobalValue::PrivateLinkage);
+      return;
+    }
+    global->setLinkage(GlobalValue::LinkOnceODRLinkage);
+    global->setVisibility(function.getVisibility());
+    if (Triple(module.getTargetTriple()).supportsCOMDAT()) {
+      global->setComdat(module.getOrInsertComdat(global->getName()));
+    }
+  }
+
+  /**
+   * Get the return and parameter attributes of the function.
+   * For anything the fn pointer may point to, only parameter attributes
+   * describing the values passed and the ABI are kept, e.g. nonnull, noalias,
+   * dereferenceable, zeroext or byval. Attributes promising how the original
+   * implementation uses its arguments, e.g. nocapture or readonly, need not
+   * hold for extensions. Of the return attributes only the ABI ones are kept,
+   * see get_abi_return_attributes.
+   */
+  AttributeList get_signature_attributes(bool any_implementation) const {
+    AttributeList attrs = function.getAttributes();
+    AttributeSet ret_attrs = attrs.getRetAttributes();
+    if (any_implementation) {
+      for (unsigned argIdx = 0; argIdx < function.arg_size(); ++argIdx) {
+        for (auto kind : {Attribute::NoCapture, Attribute::ReadNone, Attribute::ReadOnly,
+                          Attribute::WriteOnly, Attribute::Returned, Attribute::NoFree}) {
+          attrs = attrs.removeParamAttribute(ctx, argIdx, kind);
+        }
       }
+      ret_attrs = get_abi_return_attributes();
+    }
+
+    std::vector<AttributeSet> param_attrs;
+    for (unsigned argIdx = 0; argIdx < function.arg_size(); ++argIdx) {
+      param_attrs.push_back(attrs.getParamAttributes(argIdx));
     }
+    return AttributeList::get(ctx, AttributeSet(), ret_attrs, param_attrs);
   }
 
   /**
-   * Add function attributes to a call of the fn pointer or the original if
-   * required.
+   * Get the return attributes of the function which describe the ABI, i.e.
+   * zeroext, signext and inreg. Others, e.g. nonnull or dereferenceable,
+   * promise properties of the value, which an extension produces and need not
+   * keep, e.g. a probe returning null.
    */
-  void add_function_attributes(Function* func) {
-    for (int argIdx = 0; argIdx < function.arg_size(); ++argIdx) {
-      Argument* arg = function.getArg(argIdx);
-      if (arg->hasAttribute(Attribute::ByVal)) {
-        func->addParamAttr(argIdx, arg->getAttribute(Attribute::ByVal));
+  AttributeSet get_abi_return_attributes() const {
+    AttributeSet ret_attrs = function.getAttributes().getRetAttributes();
+    AttrBuilder abi_attrs;
+    for (auto kind : {Attribute::ZExt, Attribute::SExt, Attribute::InReg}) {
+      if (ret_attrs.hasAttribute(kind)) {
+        abi_attrs.addAttribute(kind);
       }
     }
+    return AttributeSet::get(ctx, abi_attrs);
+  }
+
+  /**
+   * Add the return and parameter attributes of the function to a call of the
+   * original or the fn pointer, so the optimiser knows as much about the call
+   * as about a call of the uninstrumented function.
+   */
+  void add_call_attributes(CallInst* call, bool calls_original) {
+    call->setAttributes(get_signature_attributes(!calls_original));
+  }
+
+  /**
+   * Add the return and parameter attributes of the function to a function the
+   * fn pointer may point to.
+   */
+  void add_function_attributes(Function* func) {
+    AttributeList attrs = get_signature_attributes(true);
+    std::vector<AttributeSet> param_attrs;
+    for (unsigned argIdx = 0; argIdx < function.arg_size(); ++argIdx) {
+      param_attrs.push_back(attrs.getParamAttributes(argIdx));
+    }
+    func->setAttributes(AttributeList::get(ctx, func->getAttributes().getFnAttributes(),
+                                           attrs.getRetAttributes(), param_attrs));
   }
 
   /**
@@ -308,7 +433,7 @@ struct AugmentumFunction {
         get_type_by_name_or_create(symbol_struct_augmentum__extension_point)->getPointerTo();
     extension_point_ptr = dyn_cast<GlobalVariable>(
         module.getOrInsertGlobal(extension_point_ptr_id, extension_point_ptr_type));
-    extension_point_ptr->setLinkage(GlobalValue::PrivateLinkage);
+    set_generated_linkage(extension_point_ptr);
     auto fun_extention_point_nullptr = ConstantPointerNull::get(extension_point_ptr_type);
     extension_point_ptr->setInitializer(fun_extention_point_nullptr);
 
@@ -317,8 +442,15 @@ struct AugmentumFunction {
     std::string fn_ptr_id = global_name_fn_qualed("fn_ptr");
     auto fn_ptr_type = function.getFunctionType()->getPointerTo();
     fn_ptr = dyn_cast<GlobalVariable>(module.getOrInsertGlobal(fn_ptr_id, fn_ptr_type));
-    fn_ptr->setLinkage(GlobalValue::PrivateLinkage);
+    set_generated_linkage(fn_ptr);
     fn_ptr->setInitializer(original);
+
+    // section names of other object formats need a different syntax
+    if (Triple(module.getTargetTriple()).isOSBinFormatELF()) {
+      bool hot = psi != nullptr && psi->isFunctionEntryHot(&function);
+      fn_ptr->setSection(hot ? dispatch_hot_section : dispatch_section);
+      extension_point_ptr->setSection(extension_points_section);
+    }
   }
 
   /**
@@ -335,7 +467,7 @@ struct AugmentumFunction {
     ValueToValueMapTy vmap;
     original = CloneFunction(&function, vmap);
     original->setName(global_name_fn_qualed("original"));
-    original->setLinkage(GlobalValue::PrivateLinkage);
+    set_generated_linkage(original);
   }
 
   /**
@@ -363,7 +495,7 @@ struct AugmentumFunction {
     auto voidPtrPtrTy = voidPtrTy->getPointerTo();
     module.getOrInsertFunction(name, voidTy, voidPtrTy, voidPtrPtrTy);
     reflect = module.getFunction(name);
-    reflect->setLinkage(GlobalValue::PrivateLinkage);
+    set_generated_linkage(reflect);
 
     // Build some code!
     auto bb = BasicBlock::Create(ctx, "", reflect);
@@ -403,13 +535,13 @@ struct AugmentumFunction {
     // Call and store
     if (return_type == Type::getVoidTy(ctx)) {
       auto call = builder.CreateCall(function_type, original, arg_values);
-      add_call_attributes(call);
+      add_call_attributes(call, true);
       call->setTailCall();
     } else {
       auto return_value_ptr =
           builder.CreateBitCast(return_value_ptr_void, return_type->getPointerTo(), "retPT");
       auto call = builder.CreateCall(function_type, original, arg_values, "retT");
-      add_call_attributes(call);
+      add_call_attributes(call, true);
       call->setTailCall();
       auto store = builder.CreateStore(call, return_value_ptr);
     }
@@ -445,7 +577,7 @@ struct AugmentumFunction {
     auto name = global_name_fn_qualed("extended");
     module.getOrInsertFunction(name, function.getFunctionType());
     extended = module.getFunction(name);
-    extended->setLinkage(GlobalValue::PrivateLinkage);
+    set_generated_linkage(extended);
 
     // add required attributes to extend header from original function header
     add_function_attributes(extended);
@@ -539,19 +671,32 @@ struct AugmentumFunction {
    * The function will have all its code removed, then replaced with something
    * like this: ReturnType <function.name>(ArgType0 arg0, ArgType1 arg1, ...,
    * ArgTypeN argN) { ReturnType (*fn)(ArgType0, ArgType1, ..., ArgTypeN) =
-   * augmentum::<function.name>__extension_point__.fn; return fn(arg0, arg1,
-   * ..., argN);
+   * augmentum::<function.name>__extension_point__.fn;
+   *     if (fn == augmentum::<function.name>__original__)
+   *       return augmentum::<function.name>__original__(arg0, arg1, ..., argN);
+   *     return fn(arg0, arg1, ..., argN);
    *   }
+   * The stub is always inlined, so callers load and call fn themselves instead
+   * of calling twice. While the function is not extended, they call the
+   * original directly, which can then be inlined as well.
    */
   void rewrite_function() {
-    assert(fn_ptr);
+    assert(fn_ptr && original);
     FunctionType* function_type = function.getFunctionType();
 
     // Get rid of the existing code
     clear_function();
 
+    // optnone requires noinline, and explicit noinline is kept as well
+    if (!function.hasFnAttribute(Attribute::NoInline) &&
+        !function.hasFnAttribute(Attribute::OptimizeNone)) {
+      function.addFnAttr(Attribute::AlwaysInline);
+    }
+
     // Create code
     BasicBlock* bb = BasicBlock::Create(ctx, "", &function);
+    BasicBlock* direct_bb = BasicBlock::Create(ctx, "direct", &function);
+    BasicBlock* indirect_bb = BasicBlock::Create(ctx, "indirect", &function);
     IRBuilder<> builder(ctx);
     builder.SetInsertPoint(bb);
 
@@ -563,15 +708,37 @@ struct AugmentumFunction {
       args.push_back(&arg);
     }
 
-    CallInst* call = builder.CreateCall(function_type, fn, args);
-    add_call_attributes(call);
-    call->setTailCall();
+    // Heuristic, not propagated profile data: for a function the profile saw
+    // executed, assume it mostly runs unextended and bias the branch towards
+    // the original like __builtin_expect does. Functions without a profile or
+    // with a zero entry count are left unweighted.
+    MDNode* weights = nullptr;
+    auto entry_count = function.getEntryCount();
+    if (entry_count && entry_count->getCount() > 0) {
+      weights = MDBuilder(ctx).createBranchWeights(likely_branch_weight, unlikely_branch_weight);
+    }
+    auto is_original = builder.CreateICmpEQ(fn, original, "is_original");
+    builder.CreateCondBr(is_original, direct_bb, indirect_bb, weights);
+
+    for (auto [call_bb, callee] : {std::make_pair(direct_bb, static_cast<Value*>(original)),
+                                   std::make_pair(indirect_bb, static_cast<Value*>(fn))}) {
+      builder.SetInsertPoint(call_bb);
+      CallInst* call = builder.CreateCall(function_type, callee, args);
+      add_call_attributes(call, callee == original);
+      call->setTailCall();
 
-    // return the call result if this function has a return type
-    if (function_type->getReturnType() == Type::getVoidTy(ctx))
-      builder.CreateRetVoid();
-    else
-      builder.CreateRet(call);
+      // return the call result if this function has a return type
+      if (function_type->getReturnType() == Type::getVoidTy(ctx))
+        builder.CreateRetVoid();
+      else
+        builder.CreateRet(call);
+    }
+
+    // the function returns what fn returns, which may come from an extension
+    AttributeSet abi_ret_attrs = get_abi_return_attributes();
+    function.removeAttributes(AttributeList::ReturnIndex,
+                              AttrBuilder(function.getAttributes().getRetAttributes()));
+    function.addAttributes(AttributeList::ReturnIndex, AttrBuilder(abi_ret_attrs));
   }
 
   /**
@@ -916,6 +1083,9 @@ struct AugmentumFunction {
    *           reflect
    *       );
    *   }
+   * For coalesced functions the body is guarded by a check that extension_point
+   * is still null and the extension point is registered for the module
+   * <linkonce_odr>.
    */
   void make_init() {
     assert(extension_point_ptr && fn_ptr && reflect && original && extended);
@@ -934,9 +1104,23 @@ struct AugmentumFunction {
     // register global ctor
     appendToGlobalCtors(module, global_ctor, 0, nullptr);
 
+    // The ctor of every module with a copy of a coalesced function runs, only
+    // the first one creates the shared extension point
+    if (coalesced) {
+      auto create_bb = BasicBlock::Create(ctx, "create", global_ctor);
+      auto done_bb = BasicBlock::Create(ctx, "done", global_ctor);
+      auto existing = builder.CreateLoad(extension_point_ptr, "existing");
+      auto is_created = builder.CreateIsNotNull(existing);
+      builder.CreateCondBr(is_created, done_bb, create_bb);
+      builder.SetInsertPoint(done_bb);
+      builder.CreateRetVoid();
+      builder.SetInsertPoint(create_bb);
+    }
+
     // Module Name
-    auto module_name_global_name = global_name("module", "name");
-    auto module_name_data = ConstantDataArray::getString(ctx, module.getName(), true);
+    auto module_name_global_name = global_name("module", coalesced ? "coalesced" : "name");
+    auto module_name = coalesced ? StringRef(coalesced_module_name) : module.getName();
+    auto module_name_data = ConstantDataArray::getString(ctx, module_name, true);
     auto module_name_global = module.getNamedGlobal(module_name_global_name);
     if (module_name_global == nullptr) {
       module_name_global =
@@ -988,6 +1172,252 @@ struct AugmentumFunction {
   }
 };
 
+/**
+ * This class creates the data extension points of a module.
+ * Loads of the selected values are routed through slots, which the runtime
+ * reads and overrides:
+ *   - a load of a global (at a constant offset) loads its address from a slot,
+ *     initialised with the address of the global
+ *       %v = load i32, i32* @global
+ *     becomes
+ *       %address = load i32*, i32** @"augmentum::data__global__slot__"
+ *       %v = load i32, i32* %address
+ *   - an immediate operand of an icmp is loaded from a slot holding it
+ *       %c = icmp sgt i32 %x, 225
+ *     becomes
+ *       %constant = load i32, i32* @"augmentum::data__fn:225__slot__"
+ *       %c = icmp sgt i32 %x, %constant
+ * Only integers of up to 64 bits, floats, and doubles are supported. A single
+ * constructor registers all data extension points of the module.
+ * This has to run before functions are instrumented, so the clones of the
+ * original functions load from the slots, too.
+ */
+struct AugmentumData {
+  AugmentumData(Module& module, const DataTargets::ModuleTargets& targets)
+      : module(module), targets(targets) {}
+
+  /**
+   * Transform the module if needed.
+   *
+   * Returns true if module was transformed, false otherwise.
+   */
+  bool transform() {
+    route_global_loads();
+    route_constants();
+    if (points.empty()) {
+      return false;
+    }
+    make_init();
+    return true;
+  }
+
+ private:
+  struct DataPoint {
+    std::string name;
+    Type* type;
+    GlobalVariable* slot;
+    bool indirect;
+  };
+
+  Module& module;
+  const DataTargets::ModuleTargets& targets;
+  LLVMContext& ctx = module.getContext();
+  const DataLayout& layout = module.getDataLayout();
+  std::vector<DataPoint> points;
+  std::unordered_map<std::string, size_t> point_index;
+
+  static constexpr const char* symbol_Internal__create_data_extension_point =
+      "_ZN9augmentum8Internal27create_data_extension_pointEPKcS2_PNS_8TypeDescEPvmb";
+
+  static bool is_supported(Type* type) {
+    return type->isIntegerTy(1) || type->isIntegerTy(8) || type->isIntegerTy(16) ||
+           type->isIntegerTy(32) || type->isIntegerTy(64) || type->isFloatTy() ||
+           type->isDoubleTy();
+  }
+
+  /**
+   * Get the slot of the named data extension point, creating it with the
+   * given initialiser if needed.
+   * Returns nullptr if the point already exists for values of another type.
+   */
+  GlobalVariable* get_slot(const std::string& name, Type* type, Constant* initialiser,
+                           bool indirect) {
+    auto it = point_index.find(name);
+    if (it != point_index.end()) {
+      auto& pt = points[it->second];
+      if (pt.type != type) {
+        errs() << "WARNING: [Augmentum] Data extension point " << name
+               << " is loaded with different types, only the first is extended.\n";
+        return nullptr;
+      }
+      return pt.slot;
+    }
+
+    auto slot = new GlobalVariable(module, initialiser->getType(), false,
+                                   GlobalValue::PrivateLinkage, initialiser,
+                                   AugmentumFunction::global_name("data", name + "__slot"));
+    point_index[name] = points.size();
+    points.push_back({name, type, slot, indirect});
+    return slot;
+  }
+
+  /**
+   * Route loads from target globals through their slots.
+   */
+  void route_global_loads() {
+    if (targets.globals.empty()) {
+      return;
+    }
+    for (Function& function : module) {
+      for (BasicBlock& bb : function) {
+        for (Instruction& inst : bb) {
+          auto load = dyn_cast<LoadInst>(&inst);
+          if (load == nullptr || !load->isSimple() || !is_supported(load->getType())) {
+            continue;
+          }
+
+          auto pointer_type = load->getPointerOperandType();
+          APInt offset(layout.getIndexTypeSizeInBits(pointer_type), 0);
+          auto global = dyn_cast<GlobalVariable>(
+              load->getPointerOperand()->stripAndAccumulateInBoundsConstantOffsets(layout, offset));
+          if (global == nullptr || targets.globals.count(global->getName().str()) == 0) {
+            continue;
+          }
+
+          auto name = global->getName().str();
+          if (offset != 0) {
+            name += "+" + std::to_string(offset.getSExtValue());
+          }
+          auto byte_ptr_type = Type::getInt8PtrTy(ctx, global->getAddressSpace());
+          auto address = ConstantExpr::getPointerCast(
+              ConstantExpr::getGetElementPtr(Type::getInt8Ty(ctx),
+                                             ConstantExpr::getPointerCast(global, byte_ptr_type),
+                                             ConstantInt::get(ctx, offset)),
+              pointer_type);
+
+          auto slot = get_slot(name, load->getType(), address, true);
+          if (slot == nullptr) {
+            continue;
+          }
+          IRBuilder<> builder(load);
+          load->setOperand(load->getPointerOperandIndex(), builder.CreateLoad(slot, "address"));
+        }
+      }
+    }
+  }
+
+  /**
+   * Route target immediates compared by icmp instructions through their
+   * slots.
+   */
+  void route_constants() {
+    for (Function& function : module) {
+      auto target = targets.constants.find(function.getName().str());
+      if (target == targets.constants.end()) {
+        continue;
+      }
+      for (BasicBlock& bb : function) {
+        for (Instruction& inst : bb) {
+          auto cmp = dyn_cast<ICmpInst>(&inst);
+          if (cmp == nullptr) {
+            continue;
+          }
+          for (unsigned i = 0; i < 2; ++i) {
+            auto constant = dyn_cast<ConstantInt>(cmp->getOperand(i));
+            if (constant == nullptr || !is_supported(constant->getType()) ||
+                target->second.count(constant->getSExtValue()) == 0) {
+              continue;
+            }
+
+            auto name = function.getName().str() + ":" + std::to_string(constant->getSExtValue());
+            auto slot = get_slot(name, constant->getType(), constant, false);
+            if (slot == nullptr) {
+              continue;
+            }
+            IRBuilder<> builder(cmp);
+            cmp->setOperand(i, builder.CreateLoad(slot, "constant"));
+          }
+        }
+      }
+    }
+  }
+
+  /**
+   * Register the data extension points.
+   * We need to write this out:
+   *   __attribute__((constructor))
+   *   void augmentum::data__init__() {
+   *       Internal::create_data_extension_point(
+   *           module_name, name, type, slot, size, indirect);
+   *       ...
+   *   }
+   */
+  void make_init() {
+    auto name = AugmentumFunction::global_name("data", "init");
+    module.getOrInsertFunction(name, FunctionType::get(Type::getVoidTy(ctx), false));
+    auto global_ctor = module.getFunction(name);
+    global_ctor->setLinkage(GlobalValue::PrivateLinkage);
+
+    auto bb = BasicBlock::Create(ctx, "", global_ctor);
+    IRBuilder<> builder(ctx);
+    builder.SetInsertPoint(bb);
+
+    appendToGlobalCtors(module, global_ctor, 0, nullptr);
+
+    Type* typeDesc_ptr_type =
+        module.getTypeByName(AugmentumFunction::symbol_struct_augmentum__type_desc);
+    if (typeDesc_ptr_type == nullptr) {
+      typeDesc_ptr_type =
+          StructType::create(ctx, AugmentumFunction::symbol_struct_augmentum__type_desc);
+    }
+    typeDesc_ptr_type = typeDesc_ptr_type->getPointerTo();
+
+    auto void_ptr_type = Type::getInt8PtrTy(ctx);
+    auto size_type = layout.getIntPtrType(ctx);
+    auto create_data_extension_point =
+        module.getOrInsertFunction(symbol_Internal__create_data_extension_point,
+                                   void_ptr_type,       // return type
+                                   void_ptr_type,       // arg0 char* module_name
+                                   void_ptr_type,       // arg1 char* name
+                                   typeDesc_ptr_type,   // arg2 TypeDesc* type
+                                   void_ptr_type,       // arg3 void* slot
+                                   size_type,           // arg4 size_t size
+                                   Type::getInt1Ty(ctx) // arg5 bool indirect
+        );
+
+    auto module_name = builder.CreateGlobalStringPtr(module.getName(), "module_name");
+    for (auto& pt : points) {
+      const char* get_type_symbol;
+      if (pt.type->isFloatTy()) {
+        get_type_symbol = AugmentumFunction::symbol_Internal__get_float_type;
+      } else if (pt.type->isDoubleTy()) {
+        get_type_symbol = AugmentumFunction::symbol_Internal__get_double_type;
+      } else if (pt.type->isIntegerTy(1)) {
+        get_type_symbol = AugmentumFunction::symbol_Internal__get_i1_type;
+      } else if (pt.type->isIntegerTy(8)) {
+        get_type_symbol = AugmentumFunction::symbol_Internal__get_i8_type;
+      } else if (pt.type->isIntegerTy(16)) {
+        get_type_symbol = AugmentumFunction::symbol_Internal__get_i16_type;
+      } else if (pt.type->isIntegerTy(32)) {
+        get_type_symbol = AugmentumFunction::symbol_Internal__get_i32_type;
+      } else {
+        get_type_symbol = AugmentumFunction::symbol_Internal__get_i64_type;
+      }
+      auto get_type = module.getOrInsertFunction(get_type_symbol, typeDesc_ptr_type);
+      auto type_desc = builder.CreateCall(get_type.getFunctionType(), get_type.getCallee());
+
+      auto call = builder.CreateCall(
+          create_data_extension_point.getFunctionType(), create_data_extension_point.getCallee(),
+          {module_name, builder.CreateGlobalStringPtr(pt.name, "name"), type_desc,
+           builder.CreateBitCast(pt.slot, void_ptr_type),
+           ConstantInt::get(size_type, layout.getTypeAllocSize(pt.type)),
+           ConstantInt::getBool(ctx, pt.indirect)});
+      call->addParamAttr(5, Attribute::ZExt);
+    }
+    builder.CreateRetVoid();
+  }
+};
+
 /**
  * The pass
  */
@@ -999,13 +1429,22 @@ struct Augmentum : public ModulePass {
         record_stats(StatsDirectory != ""),
         emit_llvm(EmitIRDirectory != "") {
     should_instrument = get_should_instrument();
+    if (TargetData != "") {
+      data_targets = std::make_unique<DataTargets>(TargetData);
+    }
 
     if (DryRun) {
       stats.collect_full_stats();
     }
   }
 
+  void getAnalysisUsage(AnalysisUsage& usage) const override {
+    usage.addRequired<ProfileSummaryInfoWrapperPass>();
+  }
+
   bool runOnModule(Module& module) override {
+    psi = &getAnalysis<ProfileSummaryInfoWrapperPass>().getPSI();
+
     bool transformed;
     if (DryRun) {
       transformed = collect_function_stats(module);
@@ -1033,6 +1472,8 @@ struct Augmentum : public ModulePass {
   bool record_stats;
   bool emit_llvm;
   std::unique_ptr<ShouldInstrument> should_instrument;
+  std::unique_ptr<DataTargets> data_targets;
+  ProfileSummaryInfo* psi = nullptr;
 
   /**
    * Get the ShouldInstrument call back
@@ -1057,6 +1498,14 @@ struct Augmentum : public ModulePass {
   bool run_instrumentation(Module& module) {
     // errs() << "DEBUG: checking module " << module.getName() << "\n";
 
+    // data first, so that the clones of instrumented functions use the slots
+    bool transformed_data = false;
+    if (data_targets) {
+      if (auto targets = data_targets->module(module)) {
+        transformed_data = AugmentumData(module, *targets).transform();
+      }
+    }
+
     int transformed_functions = 0;
     if (should_instrument->module(module)) {
       // clone module functions before instrumentation
@@ -1072,7 +1521,7 @@ struct Augmentum : public ModulePass {
         // errs() << "DEBUG: checking function " << function_ptr->getName() <<
         // "\n";
 
-        AugmentumFunction auto_function(*function_ptr, *should_instrument);
+        AugmentumFunction auto_function(*function_ptr, *should_instrument, psi);
         if (auto_function.transform()) {
           transformed_functions++;
 
@@ -1082,7 +1531,44 @@ struct Augmentum : public ModulePass {
         }
       }
     }
-    return transformed_functions > 0;
+    if (transformed_functions > 0) {
+      layout_dispatch_table(module);
+    }
+    return transformed_data || transformed_functions > 0;
+  }
+
+  /**
+   * Order the fn pointers of the module in the dispatch table by the entry
+   * counts of their functions, hottest first, and align the first one of each
+   * section to a cache line.
+   */
+  void layout_dispatch_table(Module& module) {
+    std::vector<std::pair<GlobalVariable*, uint64_t>> slots;
+    for (GlobalVariable& global : module.globals()) {
+      if (global.getSection() != dispatch_section && global.getSection() != dispatch_hot_section) {
+        continue;
+      }
+      uint64_t count = 0;
+      if (auto original = dyn_cast<Function>(global.getInitializer())) {
+        if (auto entry_count = original->getEntryCount()) {
+          count = entry_count->getCount();
+        }
+      }
+      slots.emplace_back(&global, count);
+    }
+
+    std::stable_sort(slots.begin(), slots.end(),
+                     [](const auto& a, const auto& b) { return a.second > b.second; });
+    std::vector<std::string> sections;
+    for (auto& [slot, count] : slots) {
+      // globals are emitted in the order of the module's list
+      slot->removeFromParent();
+      module.getGlobalList().push_back(slot);
+      if (std::find(sections.begin(), sections.end(), slot->getSection()) == sections.end()) {
+        sections.push_back(slot->getSection().str());
+        slot->setAlignment(MaybeAlign(cache_line_size));
+      }
+    }
   }
 
   /**
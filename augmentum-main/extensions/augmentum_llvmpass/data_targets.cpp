@@ -0,0 +1,70 @@
+/* Copyright (c) 2021, Björn Franke
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "data_targets.h"
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "llvm/Support/raw_ostream.h"
+
+using namespace llvm;
+using namespace std;
+
+namespace augmentum {
+namespace llvmpass {
+
+void DataTargets::parse_targets(filesystem::path target_spec) {
+  if (!filesystem::exists(target_spec)) {
+    errs() << "WARNING: [Augmentum] Specified target data file not found: " << target_spec << "\n";
+    return;
+  }
+
+  ifstream in(target_spec.c_str(), ios::in);
+  if (!in.good()) {
+    errs() << "ERROR: [Augmentum] opening input stream to read target data failed."
+              " Path invalid: "
+           << target_spec << "\n";
+    return;
+  }
+
+  bool header = true;
+  string line;
+  while (getline(in, line)) {
+    if (header) {
+      header = false;
+      continue;
+    }
+    if (!line.empty() && line[line.size() - 1] == '\r') {
+      line.erase(line.size() - 1);
+    }
+
+    vector<string> tokens;
+    size_t start = 0;
+    size_t pos = 0;
+    while ((pos = line.find(delimiter, start)) != string::npos) {
+      tokens.push_back(line.substr(start, pos - start));
+      start = pos + delimiter.length();
+    }
+    tokens.push_back(line.substr(start));
+
+    if (tokens.size() >= 3 && tokens[1] == "global") {
+      targets[tokens[0]].globals.insert(tokens[2]);
+    } else if (tokens.size() >= 4 && tokens[1] == "constant") {
+      try {
+        targets[tokens[0]].constants[tokens[2]].insert(stoll(tokens[3]));
+      } catch (const logic_error&) {
+        errs() << "WARNING: [Augmentum] Invalid target constant: " << line << "\n";
+      }
+    } else if (!line.empty()) {
+      errs() << "WARNING: [Augmentum] Invalid target data: " << line << "\n";
+    }
+  }
+}
+}  // namespace llvmpass
+}  // namespace augmentum
@@ -0,0 +1,61 @@
+/* Copyright (c) 2021, Björn Franke
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#ifndef __AUGMENTUM__DATA_TARGETS__
+#define __AUGMENTUM__DATA_TARGETS__
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "llvm/IR/Module.h"
+
+using namespace llvm;
+
+namespace augmentum {
+namespace llvmpass {
+/**
+ * Globals and immediate constants whose loads are routed through data
+ * extension points. They are read from a target file with the columns
+ *   MODULE;KIND;NAME;VALUE
+ * where KIND is either "global", with NAME the symbol of the global and no
+ * VALUE, or "constant", with NAME the function whose icmp instructions compare
+ * against the integer VALUE.
+ */
+struct DataTargets {
+  struct ModuleTargets {
+    // symbols of target globals
+    std::unordered_set<std::string> globals;
+    // target immediates by the mangled name of the function comparing them
+    std::unordered_map<std::string, std::unordered_set<int64_t>> constants;
+  };
+
+  DataTargets(std::string target_spec) { parse_targets(target_spec); }
+
+  /**
+   * Get the targets of the given module, nullptr if it has none.
+   */
+  const ModuleTargets* module(Module& module) const {
+    auto it = targets.find(module.getName().str());
+    return it == targets.end() ? nullptr : &it->second;
+  }
+
+ private:
+  static const inline std::string delimiter = ";";
+
+  // targets by path of their module
+  std::unordered_map<std::string, ModuleTargets> targets;
+
+  /**
+   * Parse target globals and constants from given file path.
+   */
+  void parse_targets(std::filesystem::path target_spec);
+};
+}  // namespace llvmpass
+}  // namespace augmentum
+#endif
@@ -0,0 +1,143 @@
+/* Copyright (c) 2021, Björn Franke
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+// This file builds the extension points of explicit.cpp with the templates of
+// extension_point.h instead of writing them out by hand. It is compiled
+// without the instrumentation pass.
+#include <cstddef>
+
+#include "to-instrument.h"
+
+#define AUGMENTUM_MODULE_NAME "to-instrument.cpp"
+#include "extension_point.h"
+
+AUGMENTUM_ANON_STRUCT_TYPE(Result, long, double)
+AUGMENTUM_STRUCT_TYPE(Node, int, Node*)
+AUGMENTUM_STRUCT_TYPE(SomeStruct, const char*, size_t)
+AUGMENTUM_STRUCT_TYPE(Container, int, int[10])
+AUGMENTUM_UNKNOWN_TYPE(arrStruct, "[50 x i8]")
+
+/** ======================= Basic Example ========================== **/
+
+static int add__original__(int a, int b) { return a + b; }
+
+AUGMENTUM_NAMED_EXTENSION_POINT(add__original__, "_Z3addii");
+
+int add(int a, int b) { return AUGMENTUM_CALL(add__original__)(a, b); }
+
+/** ======================= Integer Types ========================== **/
+
+static long intTypeTest__original__(bool sign, char c, short s, int i) {
+  if (sign)
+    return c + s + i;
+  else
+    return c - s - i;
+}
+
+AUGMENTUM_NAMED_EXTENSION_POINT(intTypeTest__original__, "_Z11intTypeTestbcsi");
+
+long intTypeTest(bool sign, char c, short s, int i) {
+  return AUGMENTUM_CALL(intTypeTest__original__)(sign, c, s, i);
+}
+
+/** ======================= Double Types ========================== **/
+
+static double floatTypeTest__original__(float f, double d) { return f + d; }
+
+AUGMENTUM_NAMED_EXTENSION_POINT(floatTypeTest__original__, "_Z13floatTypeTestfd");
+
+double floatTypeTest(float f, double d) { return AUGMENTUM_CALL(floatTypeTest__original__)(f, d); }
+
+/** ======================= Pointer Types ========================== **/
+
+static int* pointerTypeTest__original__(int* ip, double* dp) {
+  if (ip)
+    (*ip)++;
+  if (dp)
+    (*dp)--;
+  return ip;
+}
+
+AUGMENTUM_NAMED_EXTENSION_POINT(pointerTypeTest__original__, "_Z15pointerTypeTestPiPd");
+
+int* pointerTypeTest(int* ip, double* dp) {
+  return AUGMENTUM_CALL(pointerTypeTest__original__)(ip, dp);
+}
+
+/** ======================= Void Types ========================== **/
+
+static void voidTypeTest__original__(int* ip) {
+  if (ip)
+    (*ip)++;
+}
+
+AUGMENTUM_NAMED_EXTENSION_POINT(voidTypeTest__original__, "_Z12voidTypeTestPi");
+
+void voidTypeTest(int* ip) { AUGMENTUM_CALL(voidTypeTest__original__)(ip); }
+
+/** ======================= Anon Struct Types ========================== **/
+
+static Result structTypeTest__original__(int a, int b) {
+  double res = a + b;
+  return {a, res};
+}
+
+AUGMENTUM_NAMED_EXTENSION_POINT(structTypeTest__original__, "_Z14structTypeTestii");
+
+Result structTypeTest(int a, int b) { return AUGMENTUM_CALL(structTypeTest__original__)(a, b); }
+
+/** ======================= Named / Forward Struct Types ========================== **/
+
+static Node* namedStructTypeTest__original__(Node* head, int data) {
+  if (!head)
+    return new Node(data);
+
+  Node* curr = head;
+  while (curr->next) {
+    curr = curr->next;
+  }
+  curr->next = new Node(data);
+  return curr->next;
+}
+
+AUGMENTUM_NAMED_EXTENSION_POINT(namedStructTypeTest__original__, "_Z19namedStructTypeTestP4Nodei");
+
+Node* namedStructTypeTest(Node* head, int data) {
+  return AUGMENTUM_CALL(namedStructTypeTest__original__)(head, data);
+}
+
+/** ======================= Unknown Type ========================== **/
+
+// arrStruct is passed as an unknown type
+static int unknownTypeTest__original__(arrStruct a) { return a.ptr[a.i]; }
+
+AUGMENTUM_NAMED_EXTENSION_POINT(unknownTypeTest__original__, "_Z15unknownTypeTest9arrStruct");
+
+int unknownTypeTest(arrStruct a) { return AUGMENTUM_CALL(unknownTypeTest__original__)(a); }
+
+/** ======================= ByVal Test ========================== **/
+
+static void byValTest__original__(int p0, int p1, int p2, int p3, int p4, int p5, SomeStruct s) {
+  std::cout << s.str() << (p0 + p1 + p2 + p3 + p4 + p5) << "\n";
+}
+
+AUGMENTUM_NAMED_EXTENSION_POINT(byValTest__original__, "_Z9byValTestiiiiii10SomeStruct");
+
+void byValTest(int p0, int p1, int p2, int p3, int p4, int p5, SomeStruct s) {
+  AUGMENTUM_CALL(byValTest__original__)(p0, p1, p2, p3, p4, p5, s);
+}
+
+/** ======================= Array Test ========================== **/
+
+static void arrayTypeTest__original__(Container* c) {
+  for (int i = 0; i < 10; i++) {
+    c->data[i] *= c->factor;
+  }
+}
+
+AUGMENTUM_NAMED_EXTENSION_POINT(arrayTypeTest__original__, "_Z13arrayTypeTestP9Container");
+
+void arrayTypeTest(Container* c) { AUGMENTUM_CALL(arrayTypeTest__original__)(c); }
@@ -0,0 +1,55 @@
+/* Copyright (c) 2021, Björn Franke
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+// Checks that libaugmentum applies the tunings compiled by
+// driver/augmentum/tunings.py. It has to be run with AUGMENTUM_TUNINGS naming
+// the tuning file written by test_tunings in driver/test/test_extensions.py.
+#include <stdio.h>
+
+#include <cassert>
+#include <cstdint>
+
+#define AUGMENTUM_MODULE_NAME "src/tuned.cpp"
+#include "extension_point.h"
+
+#define EPSILON 0.0001
+
+struct Stats {
+  int8_t a;
+  double b;
+  int32_t c;
+};
+
+AUGMENTUM_STRUCT_TYPE(Stats, int8_t, double, int32_t)
+
+static int64_t stats__original__(Stats* s) {
+  s->a += 1;
+  s->b += 1.5;
+  s->c += 10;
+  return s->a + s->c;
+}
+
+AUGMENTUM_NAMED_EXTENSION_POINT(stats__original__, "_Z5statsP5Stats");
+
+int64_t stats(Stats* s) { return AUGMENTUM_CALL(stats__original__)(s); }
+
+int main() {
+  Stats s = {1, 2.0, 3};
+  int64_t res = stats(&s);
+
+  printf("stats({1, 2.0, 3}) = %lld {%d, %f, %d}\n", static_cast<long long>(res), s.a, s.b,
+         s.c);
+
+  // set to 7, then 1 added to the upper half
+  assert(res == 7 + (int64_t(1) << 32));
+  // untuned
+  assert(s.a == 2);
+  // scaled by 2
+  assert(s.b > 7.0 - EPSILON && s.b < 7.0 + EPSILON);
+  // offset by 2
+  assert(s.c == 15);
+  return 0;
+}
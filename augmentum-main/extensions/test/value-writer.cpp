@@ -0,0 +1,57 @@
+/* Copyright (c) 2021, Björn Franke
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+// Writes probe values of all sizes the way probe extensions do, so that the
+// driver tests can check that they read what libaugmentum writes, see
+// driver/test/test_sharedcounters.py and driver/test/test_telemetry.py.
+//
+// value-writer counters <region name>
+// value-writer telemetry <collector name>
+#include <stdio.h>
+
+#include <cstdint>
+#include <cstring>
+
+#include "shared_counters.h"
+#include "telemetry.h"
+
+using namespace augmentum;
+
+template <typename Writer>
+bool write_values(Writer write) {
+  return write(0, int8_t(-1), int8_t(-7), 3) && write(1, int16_t(-300), int16_t(2), 1) &&
+         write(2, int32_t(-1), int32_t(-7), 3) && write(3, int64_t(-5), int64_t(5), 2) &&
+         write(4, uint8_t(255), uint8_t(1), 1) && write(5, uint32_t(4294967295u), 0u, 1) &&
+         write(6, -0.5f, 2.0f, 4) && write(7, -2.5, 0.25, 5);
+}
+
+int main(int argc, char* argv[]) {
+  if (argc != 3) {
+    fprintf(stderr, "Usage: %s counters|telemetry <name>\n", argv[0]);
+    return 2;
+  }
+
+  bool written = false;
+  if (std::strcmp(argv[1], "counters") == 0) {
+    auto region = SharedCounterRegion::attach(argv[2]);
+    written = region && write_values([&region](uint64_t point, auto first, auto second,
+                                               uint64_t count) {
+                return region->add(point, first, second, count);
+              });
+  } else if (std::strcmp(argv[1], "telemetry") == 0) {
+    auto channel = TelemetryChannel::connect(argv[2]);
+    written = channel && write_values([&channel](uint64_t point, auto first, auto second,
+                                                 uint64_t count) {
+                return channel->value_count(point, first, second, count);
+              });
+  }
+
+  if (!written) {
+    fprintf(stderr, "Could not write values to %s %s\n", argv[1], argv[2]);
+    return 1;
+  }
+  return 0;
+}
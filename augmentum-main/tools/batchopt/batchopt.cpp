@@ -0,0 +1,304 @@
+/* Copyright (c) 2021, Björn Franke
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+/**
+ * In-process batch optimiser for prebuilt bitcode.
+ *
+ * The input module is parsed once. Afterwards, jobs are read from stdin, one
+ * per line, each naming a probe extension and an output file separated by a
+ * tab ("-" for either means none). For each job the extension is loaded with
+ * augmentum::reload_extension, which lets its listener extend the extension
+ * points of the instrumented LLVM libraries this tool runs against. A clone of
+ * the module is then optimised and emitted, and the extension is unloaded
+ * again, which resets the extension points and flushes the probe log. The
+ * result of each job is reported as a single line on stdout starting with
+ * RESPONSE_PREFIX.
+ */
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+#include "augmentum.h"
+
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Triple.h"
+#include "llvm/Analysis/TargetLibraryInfo.h"
+#include "llvm/Analysis/TargetTransformInfo.h"
+#include "llvm/Bitcode/BitcodeWriterPass.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/LegacyPassManager.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/Verifier.h"
+#include "llvm/IRReader/IRReader.h"
+#include "llvm/Object/ObjectFile.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Host.h"
+#include "llvm/Support/InitLLVM.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/TargetRegistry.h"
+#include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Target/TargetMachine.h"
+#include "llvm/Transforms/IPO.h"
+#include "llvm/Transforms/IPO/AlwaysInliner.h"
+#include "llvm/Transforms/IPO/PassManagerBuilder.h"
+#include "llvm/Transforms/Utils/Cloning.h"
+
+using namespace llvm;
+
+namespace augmentum {
+namespace batchopt {
+
+static const char* RESPONSE_PREFIX = "@batchopt";
+
+static cl::opt<std::string> InputFilename(cl::Positional, cl::desc("<input bitcode file>"),
+                                          cl::Required);
+
+enum class EmitKind { Bitcode, Object, Size };
+
+static cl::opt<EmitKind> Emit(
+    "emit", cl::desc("What to produce for each job"),
+    cl::values(clEnumValN(EmitKind::Bitcode, "bc", "Optimised bitcode, as written by opt"),
+               clEnumValN(EmitKind::Object, "obj", "Object file"),
+               clEnumValN(EmitKind::Size, "size", "Object and text section sizes only")),
+    cl::init(EmitKind::Bitcode));
+
+static cl::opt<std::string> OptLevel("opt-level",
+                                     cl::desc("Optimisation level as for opt: 0, 1, 2, 3, s or z"),
+                                     cl::init("z"));
+
+static cl::opt<std::string> CodeModelName(
+    "code-model", cl::desc("Code model used for object emission: small, medium or large"),
+    cl::init("medium"));
+
+static bool parseOptLevel(const std::string& level, unsigned& opt, unsigned& size) {
+  if (level.size() != 1) {
+    return false;
+  }
+  switch (level[0]) {
+    case '0':
+    case '1':
+    case '2':
+    case '3':
+      opt = level[0] - '0';
+      size = 0;
+      return true;
+    case 's':
+      opt = 2;
+      size = 1;
+      return true;
+    case 'z':
+      opt = 2;
+      size = 2;
+      return true;
+    default:
+      return false;
+  }
+}
+
+static bool parseCodeModel(const std::string& name, CodeModel::Model& model) {
+  if (name == "small") {
+    model = CodeModel::Small;
+  } else if (name == "medium") {
+    model = CodeModel::Medium;
+  } else if (name == "large") {
+    model = CodeModel::Large;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+/**
+ * Optimises clones of a parsed module with the same pipeline opt uses for a
+ * given optimisation level.
+ */
+class BatchOptimiser {
+ public:
+  BatchOptimiser(std::unique_ptr<Module> module, std::unique_ptr<TargetMachine> tm,
+                 unsigned opt_level, unsigned size_level)
+      : module(std::move(module)),
+        tm(std::move(tm)),
+        opt_level(opt_level),
+        size_level(size_level) {}
+
+  /**
+   * Optimise a clone of the module and emit it into buffer.
+   * Returns an error message on failure and an empty string otherwise.
+   */
+  std::string run(EmitKind emit, SmallVectorImpl<char>& buffer) {
+    std::unique_ptr<Module> clone = CloneModule(*module);
+
+    legacy::FunctionPassManager fpm(clone.get());
+    legacy::PassManager mpm;
+    populate(*clone, fpm, mpm);
+
+    fpm.doInitialization();
+    for (Function& f : *clone) {
+      fpm.run(f);
+    }
+    fpm.doFinalization();
+
+    raw_svector_ostream out(buffer);
+    if (emit == EmitKind::Bitcode) {
+      mpm.add(createBitcodeWriterPass(out));
+    } else if (tm->addPassesToEmitFile(mpm, out, nullptr, CGFT_ObjectFile)) {
+      return "target does not support object emission";
+    }
+    mpm.run(*clone);
+    return "";
+  }
+
+ private:
+  void populate(Module& m, legacy::FunctionPassManager& fpm, legacy::PassManager& mpm) {
+    TargetLibraryInfoImpl tlii(Triple(m.getTargetTriple()));
+    mpm.add(new TargetLibraryInfoWrapperPass(tlii));
+    mpm.add(createTargetTransformInfoWrapperPass(tm->getTargetIRAnalysis()));
+    fpm.add(createTargetTransformInfoWrapperPass(tm->getTargetIRAnalysis()));
+
+    // mirrors AddOptimizationPasses of the opt tool
+    PassManagerBuilder builder;
+    builder.OptLevel = opt_level;
+    builder.SizeLevel = size_level;
+    if (opt_level > 1) {
+      builder.Inliner = createFunctionInliningPass(opt_level, size_level, false);
+    } else {
+      builder.Inliner = createAlwaysInlinerLegacyPass();
+    }
+    builder.DisableUnrollLoops = opt_level == 0;
+    builder.LoopVectorize = opt_level > 1 && size_level < 2;
+    builder.SLPVectorize = opt_level > 1 && size_level < 2;
+    tm->adjustPassManager(builder);
+
+    builder.populateFunctionPassManager(fpm);
+    builder.populateModulePassManager(mpm);
+    mpm.add(createVerifierPass());
+  }
+
+  std::unique_ptr<Module> module;
+  std::unique_ptr<TargetMachine> tm;
+  unsigned opt_level;
+  unsigned size_level;
+};
+
+/**
+ * Determine overall and text section size of an emitted object file.
+ */
+static std::string objectSizes(const SmallVectorImpl<char>& buffer) {
+  StringRef data(buffer.data(), buffer.size());
+  auto obj = object::ObjectFile::createObjectFile(MemoryBufferRef(data, "object"));
+  if (!obj) {
+    consumeError(obj.takeError());
+    return std::to_string(buffer.size()) + " -1";
+  }
+
+  uint64_t text_size = 0;
+  for (const object::SectionRef& section : (*obj)->sections()) {
+    if (section.isText()) {
+      text_size += section.getSize();
+    }
+  }
+  return std::to_string(buffer.size()) + " " + std::to_string(text_size);
+}
+
+static void respond(const std::string& status, const std::string& message) {
+  std::cout << RESPONSE_PREFIX << " " << status << " " << message << std::endl;
+}
+
+static int main(int argc, char** argv) {
+  InitLLVM init(argc, argv);
+  InitializeNativeTarget();
+  InitializeNativeTargetAsmPrinter();
+  cl::ParseCommandLineOptions(argc, argv, "augmentum batch optimiser\n");
+
+  unsigned opt_level = 0;
+  unsigned size_level = 0;
+  if (!parseOptLevel(OptLevel, opt_level, size_level)) {
+    errs() << "Invalid optimisation level: " << OptLevel << "\n";
+    return 1;
+  }
+  CodeModel::Model code_model;
+  if (!parseCodeModel(CodeModelName, code_model)) {
+    errs() << "Invalid code model: " << CodeModelName << "\n";
+    return 1;
+  }
+
+  LLVMContext context;
+  SMDiagnostic err;
+  std::unique_ptr<Module> module = parseIRFile(InputFilename, err, context);
+  if (!module) {
+    err.print(argv[0], errs());
+    return 1;
+  }
+
+  Triple triple(module->getTargetTriple());
+  if (triple.getTriple().empty()) {
+    triple.setTriple(sys::getDefaultTargetTriple());
+  }
+  std::string target_error;
+  const Target* target = TargetRegistry::lookupTarget(triple.getTriple(), target_error);
+  if (!target) {
+    errs() << target_error << "\n";
+    return 1;
+  }
+  std::unique_ptr<TargetMachine> tm(target->createTargetMachine(
+      triple.getTriple(), "", "", TargetOptions(), Reloc::PIC_, code_model,
+      opt_level > 2 ? CodeGenOpt::Aggressive : CodeGenOpt::Default));
+
+  BatchOptimiser optimiser(std::move(module), std::move(tm), opt_level, size_level);
+  respond("READY", InputFilename);
+
+  std::string line;
+  while (std::getline(std::cin, line)) {
+    if (line.empty()) {
+      continue;
+    }
+    size_t tab = line.find('\t');
+    std::string extension_path = line.substr(0, tab);
+    std::string output_path = tab == std::string::npos ? "-" : line.substr(tab + 1);
+
+    if (extension_path != "-") {
+      try {
+        augmentum::reload_extension(extension_path);
+      } catch (const std::runtime_error& e) {
+        respond("FAIL", e.what());
+        continue;
+      }
+    }
+
+    SmallVector<char, 0> buffer;
+    std::string error = optimiser.run(Emit, buffer);
+
+    if (error.empty() && output_path != "-") {
+      std::error_code ec;
+      raw_fd_ostream out(output_path, ec, sys::fs::OF_None);
+      if (ec) {
+        error = "writing " + output_path + " failed: " + ec.message();
+      } else {
+        out.write(buffer.data(), buffer.size());
+      }
+    }
+
+    // unload before responding so that the probe log is complete
+    augmentum::unload_extension();
+
+    if (!error.empty()) {
+      respond("FAIL", error);
+    } else if (Emit == EmitKind::Size) {
+      respond("OK", objectSizes(buffer));
+    } else {
+      respond("OK", std::to_string(buffer.size()));
+    }
+  }
+  return 0;
+}
+
+}  // namespace batchopt
+}  // namespace augmentum
+
+int main(int argc, char** argv) { return augmentum::batchopt::main(argc, argv); }
@@ -5,10 +5,21 @@
  */
 
 #define _GNU_SOURCE
+// the fortified inline wrappers of open and read would clash with ours
+#undef _FORTIFY_SOURCE
 
 #include <dlfcn.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
 #include <stdarg.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <time.h>
+#include <unistd.h>
 
 static void* (*real_malloc)(size_t) = NULL;
 // static void *(*real_calloc)(size_t, size_t) = NULL;
@@ -22,8 +33,19 @@ static int (*real_vfprintf)(FILE*, const char*, va_list) = NULL;
 static int (*real_vsprintf)(char*, const char*, va_list) = NULL;
 static int (*real_vprintf)(const char*, va_list) = NULL;
 
+static int (*real_open)(const char*, int, ...) = NULL;
+static int (*real_open64)(const char*, int, ...) = NULL;
+static ssize_t (*real_read)(int, void*, size_t) = NULL;
+static ssize_t (*real_write)(int, const void*, size_t) = NULL;
+static ssize_t (*real_pread)(int, void*, size_t, off_t) = NULL;
+static ssize_t (*real_pread64)(int, void*, size_t, off64_t) = NULL;
+static void* (*real_mmap)(void*, size_t, int, int, int, off_t) = NULL;
+static void* (*real_mmap64)(void*, size_t, int, int, int, off64_t) = NULL;
+static int (*real_close)(int) = NULL;
+
 static __thread int no_malloc_hook;
 static __thread int no_free_hook;
+static __thread int no_io_hook;
 
 static void mtrace_init(void) {
   real_malloc = dlsym(RTLD_NEXT, "malloc");
@@ -75,6 +97,51 @@ static void mtrace_init(void) {
   if (NULL == real_vprintf) {
     fprintf(stderr, "Error in `dlsym`: %s\n", dlerror());
   }
+
+  real_open = dlsym(RTLD_NEXT, "open");
+  if (NULL == real_open) {
+    fprintf(stderr, "Error in `dlsym`: %s\n", dlerror());
+  }
+
+  real_open64 = dlsym(RTLD_NEXT, "open64");
+  if (NULL == real_open64) {
+    fprintf(stderr, "Error in `dlsym`: %s\n", dlerror());
+  }
+
+  real_read = dlsym(RTLD_NEXT, "read");
+  if (NULL == real_read) {
+    fprintf(stderr, "Error in `dlsym`: %s\n", dlerror());
+  }
+
+  real_write = dlsym(RTLD_NEXT, "write");
+  if (NULL == real_write) {
+    fprintf(stderr, "Error in `dlsym`: %s\n", dlerror());
+  }
+
+  real_pread = dlsym(RTLD_NEXT, "pread");
+  if (NULL == real_pread) {
+    fprintf(stderr, "Error in `dlsym`: %s\n", dlerror());
+  }
+
+  real_pread64 = dlsym(RTLD_NEXT, "pread64");
+  if (NULL == real_pread64) {
+    fprintf(stderr, "Error in `dlsym`: %s\n", dlerror());
+  }
+
+  real_mmap = dlsym(RTLD_NEXT, "mmap");
+  if (NULL == real_mmap) {
+    fprintf(stderr, "Error in `dlsym`: %s\n", dlerror());
+  }
+
+  real_mmap64 = dlsym(RTLD_NEXT, "mmap64");
+  if (NULL == real_mmap64) {
+    fprintf(stderr, "Error in `dlsym`: %s\n", dlerror());
+  }
+
+  real_close = dlsym(RTLD_NEXT, "close");
+  if (NULL == real_close) {
+    fprintf(stderr, "Error in `dlsym`: %s\n", dlerror());
+  }
 }
 
 int fprintf(FILE* stream, const char* format, ...) {
@@ -234,3 +301,480 @@ int fclose(FILE* stream) {
   fprintf(stderr, "fclose(%p) = %d\n", s, err);
   return err;
 }
+
+// --------------------------------------------------------------------------------
+// File I/O interposition
+//
+// Calls, Bytes and time spent in open, read, write, pread, mmap and close are
+// aggregated per path in thread local tables. I/O on descriptors which were
+// not opened by path, e.g. standard streams and pipes, is aggregated per file
+// descriptor instead. A single summary over all threads is written when the
+// process exits, to stderr or appended to the file named by the environment
+// variable STLWRAPPER_IO_SUMMARY, where %p is replaced with the process id.
+
+#define IO_MAX_FDS 4096
+#define IO_MAX_PATHS 8192
+#define IO_PATH_ARENA_SIZE (1 << 20)
+// path collecting I/O of paths beyond the capacity of the path table
+#define IO_UNTRACKED_PATH 0
+
+#ifdef __OPEN_NEEDS_MODE
+#define IO_OPEN_NEEDS_MODE(flags) __OPEN_NEEDS_MODE(flags)
+#else
+#define IO_OPEN_NEEDS_MODE(flags) (((flags)&O_CREAT) != 0)
+#endif
+
+enum io_op {
+  IO_OPEN,
+  IO_OPEN_FAILED,
+  IO_READ,
+  IO_WRITE,
+  IO_PREAD,
+  IO_MMAP,
+  IO_CLOSE,
+  IO_OPS
+};
+
+static const char* io_op_names[IO_OPS] = {"open",  "open_failed", "read", "write",
+                                          "pread", "mmap",        "close"};
+
+struct io_stats {
+  unsigned long calls[IO_OPS];
+  unsigned long bytes[IO_OPS];
+  unsigned long nsecs[IO_OPS];
+};
+
+struct io_table {
+  struct io_stats paths[IO_MAX_PATHS];
+  struct io_stats fds[IO_MAX_FDS];
+  struct io_table* next;
+};
+
+// interned paths, names live in an arena which is never freed
+static const char* io_path_names[IO_MAX_PATHS] = {"<untracked paths>"};
+static int io_path_slots[2 * IO_MAX_PATHS];  // open addressing, path id + 1
+static int io_path_count = 1;
+static char io_path_arena[IO_PATH_ARENA_SIZE];
+static size_t io_path_arena_used = 0;
+
+// path id + 1 each descriptor was opened with, 0 if not opened by path
+static int io_fd_paths[IO_MAX_FDS];
+
+// tables of all threads, guarded by io_lock together with the path table
+static struct io_table* io_tables = NULL;
+static char io_lock = 0;
+static __thread struct io_table* io_thread_table = NULL;
+
+static unsigned long io_start_time = 0;
+
+static unsigned long io_now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000UL + ts.tv_nsec;
+}
+
+static void io_lock_acquire(void) {
+  while (__atomic_test_and_set(&io_lock, __ATOMIC_ACQUIRE)) {
+  }
+}
+
+static void io_lock_release(void) { __atomic_clear(&io_lock, __ATOMIC_RELEASE); }
+
+static int io_intern_path(const char* path) {
+  unsigned int hash = 2166136261u;  // FNV-1a
+  for (const char* c = path; *c != '\0'; ++c) {
+    hash = (hash ^ (unsigned char)*c) * 16777619u;
+  }
+
+  int id = IO_UNTRACKED_PATH;
+  io_lock_acquire();
+  for (unsigned int i = 0; i < 2 * IO_MAX_PATHS; ++i) {
+    int* slot = &io_path_slots[(hash + i) % (2 * IO_MAX_PATHS)];
+    if (*slot == 0) {
+      const size_t len = strlen(path) + 1;
+      if (io_path_count < IO_MAX_PATHS && io_path_arena_used + len <= IO_PATH_ARENA_SIZE) {
+        char* name = io_path_arena + io_path_arena_used;
+        memcpy(name, path, len);
+        io_path_arena_used += len;
+        id = io_path_count++;
+        io_path_names[id] = name;
+        *slot = id + 1;
+      }
+      break;
+    }
+    if (strcmp(io_path_names[*slot - 1], path) == 0) {
+      id = *slot - 1;
+      break;
+    }
+  }
+  io_lock_release();
+  return id;
+}
+
+static struct io_table* io_table(void) {
+  if (io_thread_table != NULL) {
+    return io_thread_table;
+  }
+
+  if (real_mmap == NULL) {
+    mtrace_init();
+  }
+  // allocated outside of malloc, pages are only touched once used
+  void* table = real_mmap(NULL, sizeof(struct io_table), PROT_READ | PROT_WRITE,
+                          MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (table == MAP_FAILED) {
+    return NULL;
+  }
+  io_thread_table = table;
+
+  io_lock_acquire();
+  io_thread_table->next = io_tables;
+  io_tables = io_thread_table;
+  io_lock_release();
+  return io_thread_table;
+}
+
+static int io_fd_path(int fd) {
+  if (fd < 0 || fd >= IO_MAX_FDS) {
+    return 0;
+  }
+  return __atomic_load_n(&io_fd_paths[fd], __ATOMIC_RELAXED);
+}
+
+static void io_record(int fd, int path, enum io_op op, ssize_t bytes, unsigned long start) {
+  const unsigned long nsecs = io_now() - start;
+  const int err = errno;
+
+  struct io_table* table = io_table();
+  if (table != NULL) {
+    struct io_stats* stats;
+    if (path > 0) {
+      stats = &table->paths[path - 1];
+    } else if (fd >= 0 && fd < IO_MAX_FDS) {
+      stats = &table->fds[fd];
+    } else {
+      stats = &table->paths[IO_UNTRACKED_PATH];
+    }
+
+    stats->calls[op] += 1;
+    if (bytes > 0) {
+      stats->bytes[op] += bytes;
+    }
+    stats->nsecs[op] += nsecs;
+  }
+
+  // callers inspect errno of the wrapped call
+  errno = err;
+}
+
+static int io_opened(const char* path, int fd, unsigned long start) {
+  const int id = io_intern_path(path) + 1;
+  if (fd >= 0 && fd < IO_MAX_FDS) {
+    __atomic_store_n(&io_fd_paths[fd], id, __ATOMIC_RELAXED);
+  }
+  // failed opens, e.g. of header search paths, are attributed to their path
+  io_record(fd, id, fd >= 0 ? IO_OPEN : IO_OPEN_FAILED, 0, start);
+  return fd;
+}
+
+int open(const char* path, int flags, ...) {
+  if (real_open == NULL) {
+    mtrace_init();
+  }
+
+  mode_t mode = 0;
+  if (IO_OPEN_NEEDS_MODE(flags)) {
+    va_list va;
+    va_start(va, flags);
+    mode = va_arg(va, mode_t);
+    va_end(va);
+  }
+
+  if (no_io_hook) {
+    return real_open(path, flags, mode);
+  }
+
+  const unsigned long start = io_now();
+  const int fd = real_open(path, flags, mode);
+  return io_opened(path, fd, start);
+}
+
+int open64(const char* path, int flags, ...) {
+  if (real_open64 == NULL) {
+    mtrace_init();
+  }
+
+  mode_t mode = 0;
+  if (IO_OPEN_NEEDS_MODE(flags)) {
+    va_list va;
+    va_start(va, flags);
+    mode = va_arg(va, mode_t);
+    va_end(va);
+  }
+
+  if (no_io_hook) {
+    return real_open64(path, flags, mode);
+  }
+
+  const unsigned long start = io_now();
+  const int fd = real_open64(path, flags, mode);
+  return io_opened(path, fd, start);
+}
+
+ssize_t read(int fd, void* buf, size_t count) {
+  if (real_read == NULL) {
+    mtrace_init();
+  }
+
+  if (no_io_hook) {
+    return real_read(fd, buf, count);
+  }
+
+  const unsigned long start = io_now();
+  const ssize_t ret = real_read(fd, buf, count);
+  io_record(fd, io_fd_path(fd), IO_READ, ret, start);
+  return ret;
+}
+
+ssize_t write(int fd, const void* buf, size_t count) {
+  if (real_write == NULL) {
+    mtrace_init();
+  }
+
+  if (no_io_hook) {
+    return real_write(fd, buf, count);
+  }
+
+  const unsigned long start = io_now();
+  const ssize_t ret = real_write(fd, buf, count);
+  io_record(fd, io_fd_path(fd), IO_WRITE, ret, start);
+  return ret;
+}
+
+ssize_t pread(int fd, void* buf, size_t count, off_t offset) {
+  if (real_pread == NULL) {
+    mtrace_init();
+  }
+
+  if (no_io_hook) {
+    return real_pread(fd, buf, count, offset);
+  }
+
+  const unsigned long start = io_now();
+  const ssize_t ret = real_pread(fd, buf, count, offset);
+  io_record(fd, io_fd_path(fd), IO_PREAD, ret, start);
+  return ret;
+}
+
+ssize_t pread64(int fd, void* buf, size_t count, off64_t offset) {
+  if (real_pread64 == NULL) {
+    mtrace_init();
+  }
+
+  if (no_io_hook) {
+    return real_pread64(fd, buf, count, offset);
+  }
+
+  const unsigned long start = io_now();
+  const ssize_t ret = real_pread64(fd, buf, count, offset);
+  io_record(fd, io_fd_path(fd), IO_PREAD, ret, start);
+  return ret;
+}
+
+// only the time to establish a file mapping is measured,
+// page faults when accessing it are not
+void* mmap(void* addr, size_t length, int prot, int flags, int fd, off_t offset) {
+  if (real_mmap == NULL) {
+    mtrace_init();
+  }
+
+  // anonymous mappings are memory allocations rather than file I/O
+  if (no_io_hook || fd < 0 || (flags & MAP_ANONYMOUS)) {
+    return real_mmap(addr, length, prot, flags, fd, offset);
+  }
+
+  const unsigned long start = io_now();
+  void* ret = real_mmap(addr, length, prot, flags, fd, offset);
+  io_record(fd, io_fd_path(fd), IO_MMAP, ret == MAP_FAILED ? 0 : length, start);
+  return ret;
+}
+
+void* mmap64(void* addr, size_t length, int prot, int flags, int fd, off64_t offset) {
+  if (real_mmap64 == NULL) {
+    mtrace_init();
+  }
+
+  if (no_io_hook || fd < 0 || (flags & MAP_ANONYMOUS)) {
+    return real_mmap64(addr, length, prot, flags, fd, offset);
+  }
+
+  const unsigned long start = io_now();
+  void* ret = real_mmap64(addr, length, prot, flags, fd, offset);
+  io_record(fd, io_fd_path(fd), IO_MMAP, ret == MAP_FAILED ? 0 : length, start);
+  return ret;
+}
+
+int close(int fd) {
+  if (real_close == NULL) {
+    mtrace_init();
+  }
+
+  // forget the path before the descriptor can be reused by another thread
+  int path = 0;
+  if (fd >= 0 && fd < IO_MAX_FDS) {
+    path = __atomic_exchange_n(&io_fd_paths[fd], 0, __ATOMIC_RELAXED);
+  }
+
+  if (no_io_hook) {
+    return real_close(fd);
+  }
+
+  const unsigned long start = io_now();
+  const int err = real_close(fd);
+  io_record(fd, path, IO_CLOSE, 0, start);
+  return err;
+}
+
+struct io_summary_entry {
+  const char* kind;
+  int index;
+  const struct io_stats* stats;
+  unsigned long nsecs;
+};
+
+static int io_compare_entries(const void* a, const void* b) {
+  const unsigned long na = ((const struct io_summary_entry*)a)->nsecs;
+  const unsigned long nb = ((const struct io_summary_entry*)b)->nsecs;
+  return (na < nb) - (na > nb);
+}
+
+static void io_summary_file(const char* pattern, char* file, size_t size) {
+  size_t n = 0;
+  for (const char* c = pattern; *c != '\0' && n + 1 < size; ++c) {
+    if (c[0] == '%' && c[1] == 'p') {
+      const int len = snprintf(file + n, size - n, "%d", getpid());
+      n = len > 0 && n + len < size ? n + len : size - 1;
+      ++c;
+    } else {
+      file[n++] = *c;
+    }
+  }
+  file[n] = '\0';
+}
+
+static void io_write_stats(int out, const char* kind, const char* name,
+                           const struct io_stats* stats) {
+  for (int op = 0; op < IO_OPS; ++op) {
+    if (stats->calls[op] > 0) {
+      dprintf(out, "%d;%s;%s;%s;%lu;%lu;%lu\n", getpid(), kind, name, io_op_names[op],
+              stats->calls[op], stats->bytes[op], stats->nsecs[op]);
+    }
+  }
+}
+
+// fork must not copy io_lock while another thread holds it
+static void io_fork_prepare(void) { io_lock_acquire(); }
+
+static void io_fork_parent(void) { io_lock_release(); }
+
+// a forked child starts counting afresh, its parent reports what happened before
+static void io_fork_child(void) {
+  for (struct io_table* table = io_tables; table != NULL;) {
+    struct io_table* next = table->next;
+    munmap(table, sizeof(struct io_table));
+    table = next;
+  }
+  io_tables = NULL;
+  io_thread_table = NULL;
+  io_start_time = io_now();
+  io_lock_release();
+}
+
+__attribute__((constructor)) static void io_init(void) {
+  io_start_time = io_now();
+  pthread_atfork(io_fork_prepare, io_fork_parent, io_fork_child);
+}
+
+__attribute__((destructor)) static void io_summary(void) {
+  if (io_tables == NULL) {
+    return;
+  }
+  no_io_hook = no_malloc_hook = no_free_hook = 1;
+
+  // merge tables of all threads, threads still running are read as they are
+  static struct io_stats paths[IO_MAX_PATHS];
+  static struct io_stats fds[IO_MAX_FDS];
+  static struct io_summary_entry entries[IO_MAX_PATHS + IO_MAX_FDS];
+  struct io_stats total = {0};
+
+  io_lock_acquire();
+  for (const struct io_table* table = io_tables; table != NULL; table = table->next) {
+    for (int i = 0; i < IO_MAX_PATHS + IO_MAX_FDS; ++i) {
+      const struct io_stats* src =
+          i < IO_MAX_PATHS ? &table->paths[i] : &table->fds[i - IO_MAX_PATHS];
+      struct io_stats* dst = i < IO_MAX_PATHS ? &paths[i] : &fds[i - IO_MAX_PATHS];
+      for (int op = 0; op < IO_OPS; ++op) {
+        dst->calls[op] += src->calls[op];
+        dst->bytes[op] += src->bytes[op];
+        dst->nsecs[op] += src->nsecs[op];
+        total.calls[op] += src->calls[op];
+        total.bytes[op] += src->bytes[op];
+        total.nsecs[op] += src->nsecs[op];
+      }
+    }
+  }
+  const int path_count = io_path_count;
+  io_lock_release();
+
+  // list paths and descriptors by the time spent on their I/O
+  int count = 0;
+  for (int i = 0; i < IO_MAX_PATHS + IO_MAX_FDS; ++i) {
+    if (i < IO_MAX_PATHS && i >= path_count) {
+      continue;
+    }
+    struct io_summary_entry* entry = &entries[count];
+    entry->kind = i < IO_MAX_PATHS ? "path" : "fd";
+    entry->index = i < IO_MAX_PATHS ? i : i - IO_MAX_PATHS;
+    entry->stats = i < IO_MAX_PATHS ? &paths[i] : &fds[i - IO_MAX_PATHS];
+    entry->nsecs = 0;
+    unsigned long calls = 0;
+    for (int op = 0; op < IO_OPS; ++op) {
+      entry->nsecs += entry->stats->nsecs[op];
+      calls += entry->stats->calls[op];
+    }
+    if (calls > 0) {
+      ++count;
+    }
+  }
+  qsort(entries, count, sizeof(struct io_summary_entry), io_compare_entries);
+
+  int out = STDERR_FILENO;
+  const char* pattern = getenv("STLWRAPPER_IO_SUMMARY");
+  if (pattern != NULL) {
+    char file[4096];
+    io_summary_file(pattern, file, sizeof(file));
+    out = real_open(file, O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (out < 0) {
+      fprintf(stderr, "Error opening I/O summary %s\n", file);
+      out = STDERR_FILENO;
+    }
+  }
+
+  dprintf(out, "pid;kind;name;op;calls;bytes;nsecs\n");
+  dprintf(out, "%d;process;%s;elapsed;1;0;%lu\n", getpid(), program_invocation_short_name,
+          io_now() - io_start_time);
+  io_write_stats(out, "total", "*", &total);
+  for (int i = 0; i < count; ++i) {
+    char fd_name[16];
+    const char* name = io_path_names[entries[i].index];
+    if (entries[i].kind[0] == 'f') {
+      snprintf(fd_name, sizeof(fd_name), "%d", entries[i].index);
+      name = fd_name;
+    }
+    io_write_stats(out, entries[i].kind, name, entries[i].stats);
+  }
+
+  if (out != STDERR_FILENO) {
+    real_close(out);
+  }
+}